@@ -542,9 +542,12 @@ if (typeof morphdom === "undefined" && typeof window !== "undefined") {
 
 (function () {
   "use strict";
-  // We need to connect to the WebSocket server started by the dev server
-  // But we don't want to hardcode the URL, so we use the same port as the server
-  const WS_URL = "{{ livereload_ws_url }}";
+  // The dev server upgrades this path on its own port, so the socket goes
+  // wherever the page came from (including through a proxy or tunnel)
+  const WS_URL =
+    (window.location.protocol === "https:" ? "wss://" : "ws://") +
+    window.location.host +
+    "/__livereload";
   let ws;
   let reconnectAttempts = 0;
   const MAX_RECONNECT_ATTEMPTS = 10;
@@ -557,18 +560,32 @@ if (typeof morphdom === "undefined" && typeof window !== "undefined") {
     ws.onopen = function () {
       console.log("[LiveReload] Connected");
       reconnectAttempts = 0;
+      // Tell the server which page this is, so it only notifies us about
+      // changes that affect it
+      ws.send(
+        JSON.stringify({
+          type: "hello",
+          url: decodeURIComponent(window.location.pathname),
+        })
+      );
     };
 
     ws.onmessage = async (event) => {
       try {
+        const received = performance.now();
         const data = JSON.parse(event.data);
         if (
           data.type === "reload" ||
           data.type == "template" ||
           data.type == "content"
         ) {
-          const response = await fetch(window.location.href);
-          const html = await response.text();
+          // Registered pages get their new HTML in the message itself
+          let html = data.html;
+          if (typeof html !== "string") {
+            const response = await fetch(window.location.href);
+            html = await response.text();
+          }
+          const fetched = performance.now();
           const parser = new DOMParser();
           const newDoc = parser.parseFromString(html, "text/html");
 
@@ -584,26 +601,40 @@ if (typeof morphdom === "undefined" && typeof window !== "undefined") {
           });
 
           morphdom(document.body, newDoc.body);
-        } else if (data.type == "css") {
-          if (window._cssReloading) return;
-          window._cssReloading = true;
 
+          // Lets the dev server time the whole edit-to-paint path
+          if (ws.readyState === WebSocket.OPEN) {
+            ws.send(
+              JSON.stringify({
+                type: "painted",
+                version: data.version,
+                fetch: fetched - received,
+                patch: performance.now() - fetched,
+              })
+            );
+          }
+        } else if (data.type == "css") {
           const links = Array.from(
             document.querySelectorAll('link[rel="stylesheet"]')
           );
-          const timestamp = Date.now();
+          const paths = data.paths || [];
+          const changed = links.filter((link) =>
+            paths.includes(new URL(link.href, window.location.origin).pathname)
+          );
 
-          links.forEach((link) => {
-            // Just update the href directly with cache buster
+          // A stylesheet we can't match (e.g. pulled in by @import) could
+          // affect any of them
+          (changed.length ? changed : links).forEach((link) => {
             const url = new URL(link.href, window.location.origin);
-            url.searchParams.set("t", timestamp);
-            link.href = url.toString();
-          });
+            url.searchParams.set("t", Date.now());
 
-          // Reset flag after a short delay
-          setTimeout(() => {
-            window._cssReloading = false;
-          }, 100);
+            // Swap in a copy once it has loaded, so the page never renders
+            // unstyled; the DOM and scroll position are left alone
+            const next = link.cloneNode();
+            next.href = url.toString();
+            next.onload = next.onerror = () => link.remove();
+            link.after(next);
+          });
         } else {
           window.location.reload();
         }
@@ -1 +1 @@
-!function(e,t){"object"==typeof exports&&"undefined"!=typeof module?module.exports=t():"function"==typeof define&&define.amd?define(t):(e=e||self).morphdom=t()}(this,(function(){"use strict";var e;var t="http://www.w3.org/1999/xhtml",n="undefined"==typeof document?void 0:document,o=!!n&&"content"in n.createElement("template"),r=!!n&&n.createRange&&"createContextualFragment"in n.createRange();function i(t){return t=t.trim(),o?function(e){var t=n.createElement("template");return t.innerHTML=e,t.content.childNodes[0]}(t):r?function(t){return e||(e=n.createRange()).selectNode(n.body),e.createContextualFragment(t).childNodes[0]}(t):function(e){var t=n.createElement("body");return t.innerHTML=e,t.childNodes[0]}(t)}function a(e,t){var n,o,r=e.nodeName,i=t.nodeName;return r===i||(n=r.charCodeAt(0),o=i.charCodeAt(0),n<=90&&o>=97?r===i.toUpperCase():o<=90&&n>=97&&i===r.toUpperCase())}function d(e,t,n){e[n]!==t[n]&&(e[n]=t[n],e[n]?e.setAttribute(n,""):e.removeAttribute(n))}var l={OPTION:function(e,t){var n=e.parentNode;if(n){var o=n.nodeName.toUpperCase();"OPTGROUP"===o&&(o=(n=n.parentNode)&&n.nodeName.toUpperCase()),"SELECT"!==o||n.hasAttribute("multiple")||(e.hasAttribute("selected")&&!t.selected&&(e.setAttribute("selected","selected"),e.removeAttribute("selected")),n.selectedIndex=-1)}d(e,t,"selected")},INPUT:function(e,t){d(e,t,"checked"),d(e,t,"disabled"),e.value!==t.value&&(e.value=t.value),t.hasAttribute("value")||e.removeAttribute("value")},TEXTAREA:function(e,t){var n=t.value;e.value!==n&&(e.value=n);var o=e.firstChild;if(o){var r=o.nodeValue;if(r==n||!n&&r==e.placeholder)return;o.nodeValue=n}},SELECT:function(e,t){if(!t.hasAttribute("multiple")){for(var n,o,r=-1,i=0,a=e.firstChild;a;)if("OPTGROUP"===(o=a.nodeName&&a.nodeName.toUpperCase()))(a=(n=a).firstChild)||(a=n.nextSibling,n=null);else{if("OPTION"===o){if(a.hasAttribute("selected")){r=i;break}i++}!(a=a.nextSibling)&&n&&(a=n.nextSibling,n=null)}e.selectedIndex=r}}};function u(){}function c(e){if(e)return e.getAttribute&&e.getAttribute("id")||e.id}var f=function(e){return function(o,r,d){if(d||(d={}),"string"==typeof r)if("#document"===o.nodeName||"HTML"===o.nodeName||"BODY"===o.nodeName){var f=r;(r=n.createElement("html")).innerHTML=f}else r=i(r);else 11===r.nodeType&&(r=r.firstElementChild);var s=d.getNodeKey||c,m=d.onBeforeNodeAdded||u,p=d.onNodeAdded||u,h=d.onBeforeElUpdated||u,v=d.onElUpdated||u,N=d.onBeforeNodeDiscarded||u,b=d.onNodeDiscarded||u,g=d.onBeforeElChildrenUpdated||u,y=d.skipFromChildren||u,C=d.addChild||function(e,t){return e.appendChild(t)},A=!0===d.childrenOnly,w=Object.create(null),T=[];function S(e){T.push(e)}function E(e,t){if(1===e.nodeType)for(var n=e.firstChild;n;){var o=void 0;t&&(o=s(n))?S(o):(b(n),n.firstChild&&E(n,t)),n=n.nextSibling}}function x(e,t,n){!1!==N(e)&&(t&&t.removeChild(e),b(e),E(e,n))}function R(e){if(1===e.nodeType||11===e.nodeType)for(var t=e.firstChild;t;){var n=s(t);n&&(w[n]=t),R(t),t=t.nextSibling}}function U(e){p(e);for(var t=e.firstChild;t;){var n=t.nextSibling,o=s(t);if(o){var r=w[o];r&&a(t,r)?(t.parentNode.replaceChild(r,t),L(r,t)):U(t)}else U(t);t=n}}function L(t,o,r){var i=s(o);if(i&&delete w[i],!r){var d=h(t,o);if(!1===d)return;if(d instanceof HTMLElement&&R(t=d),e(t,o),v(t),!1===g(t,o))return}"TEXTAREA"!==t.nodeName?function(e,t){var o,r,i,d,u,c=y(e,t),f=t.firstChild,p=e.firstChild;e:for(;f;){for(d=f.nextSibling,o=s(f);!c&&p;){if(i=p.nextSibling,f.isSameNode&&f.isSameNode(p)){f=d,p=i;continue e}r=s(p);var h=p.nodeType,v=void 0;if(h===f.nodeType&&(1===h?(o?o!==r&&((u=w[o])?i===u?v=!1:(e.insertBefore(u,p),r?S(r):x(p,e,!0),r=s(p=u)):v=!1):r&&(v=!1),(v=!1!==v&&a(p,f))&&L(p,f)):3!==h&&8!=h||(v=!0,p.nodeValue!==f.nodeValue&&(p.nodeValue=f.nodeValue))),v){f=d,p=i;continue e}r?S(r):x(p,e,!0),p=i}if(o&&(u=w[o])&&a(u,f))c||C(e,u),L(u,f);else{var N=m(f);!1!==N&&(N&&(f=N),f.actualize&&(f=f.actualize(e.ownerDocument||n)),C(e,f),U(f))}f=d,p=i}!function(e,t,n){for(;t;){var o=t.nextSibling;(n=s(t))?S(n):x(t,e,!0),t=o}}(e,p,r);var b=l[e.nodeName];b&&b(e,t)}(t,o):l.TEXTAREA(t,o)}R(o);var O,V,I=o,P=I.nodeType,D=r.nodeType;if(!A)if(1===P)1===D?a(o,r)||(b(o),I=function(e,t){for(var n=e.firstChild;n;){var o=n.nextSibling;t.appendChild(n),n=o}return t}(o,(O=r.nodeName,(V=r.namespaceURI)&&V!==t?n.createElementNS(V,O):n.createElement(O)))):I=r;else if(3===P||8===P){if(D===P)return I.nodeValue!==r.nodeValue&&(I.nodeValue=r.nodeValue),I;I=r}if(I===r)b(o);else{if(r.isSameNode&&r.isSameNode(I))return;if(L(I,r,A),T)for(var B=0,M=T.length;B<M;B++){var k=w[T[B]];k&&x(k,k.parentNode,!1)}}return!A&&I!==o&&o.parentNode&&(I.actualize&&(I=I.actualize(o.ownerDocument||n)),o.parentNode.replaceChild(I,o)),I}}((function(e,t){var n,o,r,i,a=t.attributes;if(11!==t.nodeType&&11!==e.nodeType){for(var d=a.length-1;d>=0;d--)o=(n=a[d]).name,r=n.namespaceURI,i=n.value,r?(o=n.localName||o,e.getAttributeNS(r,o)!==i&&("xmlns"===n.prefix&&(o=n.name),e.setAttributeNS(r,o,i))):e.getAttribute(o)!==i&&e.setAttribute(o,i);for(var l=e.attributes,u=l.length-1;u>=0;u--)o=(n=l[u]).name,(r=n.namespaceURI)?(o=n.localName||o,t.hasAttributeNS(r,o)||e.removeAttributeNS(r,o)):t.hasAttribute(o)||e.removeAttribute(o)}}));return f})),"undefined"==typeof morphdom&&"undefined"!=typeof window&&(window.morphdom=window.morphdom||this.morphdom),function(){"use strict";let e,t=0;function n(){console.log("[LiveReload] Connecting..."),e=new WebSocket("{{ livereload_ws_url }}"),e.onopen=function(){console.log("[LiveReload] Connected"),t=0},e.onmessage=async e=>{try{const t=JSON.parse(e.data);if("reload"===t.type||"template"==t.type||"content"==t.type){const e=await fetch(window.location.href),t=await e.text(),n=(new DOMParser).parseFromString(t,"text/html");morphdom(document.head,n.head,{onBeforeElUpdated:function(e,t){return"LINK"!==e.tagName||"stylesheet"!==e.rel}}),morphdom(document.body,n.body)}else if("css"==t.type){if(window._cssReloading)return;window._cssReloading=!0;const e=Array.from(document.querySelectorAll('link[rel="stylesheet"]')),t=Date.now();e.forEach((e=>{const n=new URL(e.href,window.location.origin);n.searchParams.set("t",t),e.href=n.toString()})),setTimeout((()=>{window._cssReloading=!1}),100)}else window.location.reload()}catch(e){console.error("[LiveReload] Error:",e)}},e.onclose=function(){t<10&&(t++,setTimeout(n,1e3))}}"loading"===document.readyState?document.addEventListener("DOMContentLoaded",n):n()}();
\ No newline at end of file
+!function(e,t){"object"==typeof exports&&"undefined"!=typeof module?module.exports=t():"function"==typeof define&&define.amd?define(t):(e=e||self).morphdom=t()}(this,(function(){"use strict";var e;var t="http://www.w3.org/1999/xhtml",n="undefined"==typeof document?void 0:document,o=!!n&&"content"in n.createElement("template"),r=!!n&&n.createRange&&"createContextualFragment"in n.createRange();function i(t){return t=t.trim(),o?function(e){var t=n.createElement("template");return t.innerHTML=e,t.content.childNodes[0]}(t):r?function(t){return e||(e=n.createRange()).selectNode(n.body),e.createContextualFragment(t).childNodes[0]}(t):function(e){var t=n.createElement("body");return t.innerHTML=e,t.childNodes[0]}(t)}function a(e,t){var n,o,r=e.nodeName,i=t.nodeName;return r===i||(n=r.charCodeAt(0),o=i.charCodeAt(0),n<=90&&o>=97?r===i.toUpperCase():o<=90&&n>=97&&i===r.toUpperCase())}function d(e,t,n){e[n]!==t[n]&&(e[n]=t[n],e[n]?e.setAttribute(n,""):e.removeAttribute(n))}var l={OPTION:function(e,t){var n=e.parentNode;if(n){var o=n.nodeName.toUpperCase();"OPTGROUP"===o&&(o=(n=n.parentNode)&&n.nodeName.toUpperCase()),"SELECT"!==o||n.hasAttribute("multiple")||(e.hasAttribute("selected")&&!t.selected&&(e.setAttribute("selected","selected"),e.removeAttribute("selected")),n.selectedIndex=-1)}d(e,t,"selected")},INPUT:function(e,t){d(e,t,"checked"),d(e,t,"disabled"),e.value!==t.value&&(e.value=t.value),t.hasAttribute("value")||e.removeAttribute("value")},TEXTAREA:function(e,t){var n=t.value;e.value!==n&&(e.value=n);var o=e.firstChild;if(o){var r=o.nodeValue;if(r==n||!n&&r==e.placeholder)return;o.nodeValue=n}},SELECT:function(e,t){if(!t.hasAttribute("multiple")){for(var n,o,r=-1,i=0,a=e.firstChild;a;)if("OPTGROUP"===(o=a.nodeName&&a.nodeName.toUpperCase()))(a=(n=a).firstChild)||(a=n.nextSibling,n=null);else{if("OPTION"===o){if(a.hasAttribute("selected")){r=i;break}i++}!(a=a.nextSibling)&&n&&(a=n.nextSibling,n=null)}e.selectedIndex=r}}};function u(){}function c(e){if(e)return e.getAttribute&&e.getAttribute("id")||e.id}var f=function(e){return function(o,r,d){if(d||(d={}),"string"==typeof r)if("#document"===o.nodeName||"HTML"===o.nodeName||"BODY"===o.nodeName){var f=r;(r=n.createElement("html")).innerHTML=f}else r=i(r);else 11===r.nodeType&&(r=r.firstElementChild);var s=d.getNodeKey||c,m=d.onBeforeNodeAdded||u,p=d.onNodeAdded||u,h=d.onBeforeElUpdated||u,v=d.onElUpdated||u,N=d.onBeforeNodeDiscarded||u,b=d.onNodeDiscarded||u,g=d.onBeforeElChildrenUpdated||u,y=d.skipFromChildren||u,C=d.addChild||function(e,t){return e.appendChild(t)},A=!0===d.childrenOnly,w=Object.create(null),T=[];function S(e){T.push(e)}function E(e,t){if(1===e.nodeType)for(var n=e.firstChild;n;){var o=void 0;t&&(o=s(n))?S(o):(b(n),n.firstChild&&E(n,t)),n=n.nextSibling}}function x(e,t,n){!1!==N(e)&&(t&&t.removeChild(e),b(e),E(e,n))}function R(e){if(1===e.nodeType||11===e.nodeType)for(var t=e.firstChild;t;){var n=s(t);n&&(w[n]=t),R(t),t=t.nextSibling}}function U(e){p(e);for(var t=e.firstChild;t;){var n=t.nextSibling,o=s(t);if(o){var r=w[o];r&&a(t,r)?(t.parentNode.replaceChild(r,t),L(r,t)):U(t)}else U(t);t=n}}function L(t,o,r){var i=s(o);if(i&&delete w[i],!r){var d=h(t,o);if(!1===d)return;if(d instanceof HTMLElement&&R(t=d),e(t,o),v(t),!1===g(t,o))return}"TEXTAREA"!==t.nodeName?function(e,t){var o,r,i,d,u,c=y(e,t),f=t.firstChild,p=e.firstChild;e:for(;f;){for(d=f.nextSibling,o=s(f);!c&&p;){if(i=p.nextSibling,f.isSameNode&&f.isSameNode(p)){f=d,p=i;continue e}r=s(p);var h=p.nodeType,v=void 0;if(h===f.nodeType&&(1===h?(o?o!==r&&((u=w[o])?i===u?v=!1:(e.insertBefore(u,p),r?S(r):x(p,e,!0),r=s(p=u)):v=!1):r&&(v=!1),(v=!1!==v&&a(p,f))&&L(p,f)):3!==h&&8!=h||(v=!0,p.nodeValue!==f.nodeValue&&(p.nodeValue=f.nodeValue))),v){f=d,p=i;continue e}r?S(r):x(p,e,!0),p=i}if(o&&(u=w[o])&&a(u,f))c||C(e,u),L(u,f);else{var N=m(f);!1!==N&&(N&&(f=N),f.actualize&&(f=f.actualize(e.ownerDocument||n)),C(e,f),U(f))}f=d,p=i}!function(e,t,n){for(;t;){var o=t.nextSibling;(n=s(t))?S(n):x(t,e,!0),t=o}}(e,p,r);var b=l[e.nodeName];b&&b(e,t)}(t,o):l.TEXTAREA(t,o)}R(o);var O,V,I=o,P=I.nodeType,D=r.nodeType;if(!A)if(1===P)1===D?a(o,r)||(b(o),I=function(e,t){for(var n=e.firstChild;n;){var o=n.nextSibling;t.appendChild(n),n=o}return t}(o,(O=r.nodeName,(V=r.namespaceURI)&&V!==t?n.createElementNS(V,O):n.createElement(O)))):I=r;else if(3===P||8===P){if(D===P)return I.nodeValue!==r.nodeValue&&(I.nodeValue=r.nodeValue),I;I=r}if(I===r)b(o);else{if(r.isSameNode&&r.isSameNode(I))return;if(L(I,r,A),T)for(var B=0,M=T.length;B<M;B++){var k=w[T[B]];k&&x(k,k.parentNode,!1)}}return!A&&I!==o&&o.parentNode&&(I.actualize&&(I=I.actualize(o.ownerDocument||n)),o.parentNode.replaceChild(I,o)),I}}((function(e,t){var n,o,r,i,a=t.attributes;if(11!==t.nodeType&&11!==e.nodeType){for(var d=a.length-1;d>=0;d--)o=(n=a[d]).name,r=n.namespaceURI,i=n.value,r?(o=n.localName||o,e.getAttributeNS(r,o)!==i&&("xmlns"===n.prefix&&(o=n.name),e.setAttributeNS(r,o,i))):e.getAttribute(o)!==i&&e.setAttribute(o,i);for(var l=e.attributes,u=l.length-1;u>=0;u--)o=(n=l[u]).name,(r=n.namespaceURI)?(o=n.localName||o,t.hasAttributeNS(r,o)||e.removeAttributeNS(r,o)):t.hasAttribute(o)||e.removeAttribute(o)}}));return f})),"undefined"==typeof morphdom&&"undefined"!=typeof window&&(window.morphdom=window.morphdom||this.morphdom),function(){"use strict";let e,t=0;function n(){console.log("[LiveReload] Connecting..."),e=new WebSocket(("https:"===location.protocol?"wss://":"ws://")+location.host+"/__livereload"),e.onopen=function(){console.log("[LiveReload] Connected"),t=0,e.send(JSON.stringify({type:"hello",url:decodeURIComponent(window.location.pathname)}))},e.onmessage=async n=>{try{const o=performance.now(),t=JSON.parse(n.data);if("reload"===t.type||"template"==t.type||"content"==t.type){let n=t.html;"string"!=typeof n&&(n=await(await fetch(window.location.href)).text());const r=performance.now(),i=(new DOMParser).parseFromString(n,"text/html");morphdom(document.head,i.head,{onBeforeElUpdated:function(e,t){return"LINK"!==e.tagName||"stylesheet"!==e.rel}}),morphdom(document.body,i.body),e.readyState===WebSocket.OPEN&&e.send(JSON.stringify({type:"painted",version:t.version,fetch:r-o,patch:performance.now()-r}))}else if("css"==t.type){const e=Array.from(document.querySelectorAll('link[rel="stylesheet"]')),n=t.paths||[],o=e.filter((e=>n.includes(new URL(e.href,window.location.origin).pathname)));(o.length?o:e).forEach((e=>{const n=new URL(e.href,window.location.origin);n.searchParams.set("t",Date.now());const o=e.cloneNode();o.href=n.toString(),o.onload=o.onerror=()=>e.remove(),e.after(o)}))}else window.location.reload()}catch(e){console.error("[LiveReload] Error:",e)}},e.onclose=function(){t<10&&(t++,setTimeout(n,1e3))}}"loading"===document.readyState?document.addEventListener("DOMContentLoaded",n):n()}();
\ No newline at end of file
@@ -0,0 +1,423 @@
+#include "bench.hpp"
+#include "core/frontmatter.hpp"
+#include "core/html_minifier.hpp"
+#include "core/js_minifier.hpp"
+#include "core/markdown.hpp"
+#include "core/site_builder.hpp"
+#include "core/template_engine.hpp"
+#include "utils/build_info.hpp"
+#include "utils/log.hpp"
+#include "vendor/termcolor.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include <vendor/nlohmann/json.hpp>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+using Results = nlohmann::ordered_json;
+
+// Discards what the builder prints while it is being timed; the progress
+// lines would otherwise cost more than some of the phases
+class SilencedOutput {
+public:
+  // Queued log lines are written out first, so the log thread isn't
+  // writing to std::cout while its buffer is swapped
+  SilencedOutput() {
+    Log::instance().flush();
+    previous_ = std::cout.rdbuf(&discard_);
+  }
+  ~SilencedOutput() {
+    Log::instance().flush();
+    std::cout.rdbuf(previous_);
+  }
+
+private:
+  struct Discard : std::streambuf {
+    int overflow(int c) override { return traits_type::not_eof(c); }
+    std::streamsize xsputn(const char *, std::streamsize n) override {
+      return n;
+    }
+  };
+
+  Discard discard_;
+  std::streambuf *previous_;
+};
+
+template <typename Fn> static double time_ms(Fn &&fn) {
+  auto start = Clock::now();
+  fn();
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+static Results summarize(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  double mean = std::accumulate(samples.begin(), samples.end(), 0.0) /
+                static_cast<double>(samples.size());
+
+  Results summary;
+  summary["min_ms"] = samples.front();
+  summary["median_ms"] = samples[samples.size() / 2];
+  summary["mean_ms"] = mean;
+  summary["samples_ms"] = samples;
+  return summary;
+}
+
+// Repeats `fn` until it has run for a while, so short operations are
+// measured over many calls
+template <typename Fn>
+static Results measure(Fn &&fn, size_t input_bytes) {
+  constexpr auto min_time = std::chrono::milliseconds(200);
+  constexpr size_t min_iterations = 3;
+
+  fn();
+
+  size_t iterations = 0;
+  auto start = Clock::now();
+  auto elapsed = Clock::duration::zero();
+  while (iterations < min_iterations || elapsed < min_time) {
+    fn();
+    ++iterations;
+    elapsed = Clock::now() - start;
+  }
+
+  double ns_per_op =
+      std::chrono::duration<double, std::nano>(elapsed).count() /
+      static_cast<double>(iterations);
+
+  Results result;
+  result["ns_per_op"] = ns_per_op;
+  result["iterations"] = iterations;
+  result["input_bytes"] = input_bytes;
+  result["mb_per_s"] =
+      static_cast<double>(input_bytes) / (ns_per_op / 1e9) / 1e6;
+  return result;
+}
+
+static std::string read_text(const fs::path &path) {
+  std::ifstream file(path);
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  return buffer.str();
+}
+
+static fs::path page_output(const fs::path &output_dir,
+                            const std::string &url) {
+  if (url == "/") {
+    return output_dir / "index.html";
+  }
+  return output_dir / url.substr(1) / "index.html";
+}
+
+// Runs one build the way `forge build` does, timing each phase on its own.
+// frontmatter and markdown are also part of discover; they are timed again
+// separately so their share is visible.
+static void time_phases(const fs::path &root,
+                        const std::vector<std::string> &sources,
+                        std::vector<std::pair<std::string, double>> &phases,
+                        size_t &render_errors) {
+  fs::remove_all(root / "dist");
+
+  SilencedOutput silenced;
+  SiteBuilder builder(root);
+
+  phases.emplace_back("discover",
+                      time_ms([&]() { builder.discover_content(); }));
+
+  std::vector<std::string> bodies;
+  bodies.reserve(sources.size());
+  phases.emplace_back("frontmatter", time_ms([&]() {
+                        for (const auto &source : sources) {
+                          bodies.push_back(FrontMatter::parse(source).second);
+                        }
+                      }));
+
+  phases.emplace_back("markdown", time_ms([&]() {
+                        for (const auto &body : bodies) {
+                          MarkdownProcessor::to_html(body);
+                        }
+                      }));
+
+  auto site = builder.snapshot();
+  std::vector<std::pair<std::string, std::string>> rendered;
+  rendered.reserve(site->pages.size());
+  phases.emplace_back("render", time_ms([&]() {
+                        for (const auto &[url, page] : site->pages) {
+                          try {
+                            rendered.emplace_back(
+                                url, builder.render_page(*site, *page));
+                          } catch (const std::exception &) {
+                            ++render_errors;
+                          }
+                        }
+                      }));
+
+  builder.initialize_minification();
+  phases.emplace_back("minify", time_ms([&]() {
+                        for (auto &[url, html] : rendered) {
+                          html = builder.minify_html_content(html);
+                        }
+                      }));
+
+  builder.discover_available_assets();
+  phases.emplace_back("write", time_ms([&]() {
+                        for (const auto &[url, html] : rendered) {
+                          builder.trackAssets(html);
+                          fs::path path = page_output(root / "dist", url);
+                          fs::create_directories(path.parent_path());
+                          std::ofstream(path) << html;
+                        }
+                      }));
+
+  phases.emplace_back("static",
+                      time_ms([&]() { builder.process_static_files(); }));
+}
+
+static Results run_microbenchmarks(const fs::path &root,
+                                   const std::vector<std::string> &sources) {
+  Results micro;
+  SilencedOutput silenced;
+
+  // A post picked from the middle, so it is a typical one
+  const std::string &source = sources[sources.size() / 2];
+  std::string body = FrontMatter::parse(source).second;
+
+  micro["frontmatter_parse"] =
+      measure([&]() { FrontMatter::parse(source); }, source.size());
+  micro["markdown_to_html"] =
+      measure([&]() { MarkdownProcessor::to_html(body); }, body.size());
+
+  SiteBuilder builder(root);
+  builder.discover_content();
+  auto site = builder.snapshot();
+
+  // A collection's template with the context a post renders with; the
+  // first by name, so every run picks the same one
+  auto first = std::min_element(
+      site->collections.begin(), site->collections.end(),
+      [](const auto &a, const auto &b) { return a.first < b.first; });
+  const auto &[collection, posts] = *first;
+  std::string tmpl = read_text(root / "templates" / (collection + ".html"));
+  nlohmann::json data;
+  data["page"] = TemplateEngine::serialize_page(posts.front());
+  data["content"] = posts.front()->html_content;
+  data["collections"][collection] =
+      TemplateEngine::serialize_collection(posts);
+  TemplateEngine engine;
+  micro["template_render"] =
+      measure([&]() { engine.render(tmpl, data); }, tmpl.size());
+
+  std::string html = builder.render_page(*site, *posts.front());
+  micro["html_minifier"] =
+      measure([&]() { HtmlMinifier::minify(html); }, html.size());
+
+  JSMinifier js_minifier;
+  if (js_minifier.initialize()) {
+    std::string js = read_text(root / "static" / "js" / "app.js");
+    std::string css = read_text(root / "static" / "css" / "site.css");
+    micro["js_minifier_js"] =
+        measure([&]() { js_minifier.minifyJS(js); }, js.size());
+    micro["js_minifier_css"] =
+        measure([&]() { js_minifier.minifyCSS(css); }, css.size());
+    micro["js_minifier_html"] =
+        measure([&]() { js_minifier.minifyHTML(html); }, html.size());
+  }
+
+  return micro;
+}
+
+static void print_results(const Results &results) {
+  std::cout << "\n"
+            << termcolor::bright_cyan << "⏱  Build phases" << termcolor::reset
+            << termcolor::bright_blue << " (median / min of "
+            << results["iterations"].get<int>() << " runs)" << termcolor::reset
+            << "\n";
+  for (const auto &[name, phase] : results["phases"].items()) {
+    std::cout << "  " << termcolor::white << std::setw(14) << std::left << name
+              << termcolor::reset << termcolor::bright_white << std::setw(10)
+              << std::right << std::fixed << std::setprecision(2)
+              << phase["median_ms"].get<double>() << " ms" << termcolor::reset
+              << termcolor::bright_blue << std::setw(10)
+              << phase["min_ms"].get<double>() << " ms" << termcolor::reset
+              << "\n";
+  }
+
+  std::cout << "\n"
+            << termcolor::bright_cyan << "🔬 Microbenchmarks"
+            << termcolor::reset << "\n";
+  for (const auto &[name, result] : results["micro"].items()) {
+    std::cout << "  " << termcolor::white << std::setw(18) << std::left << name
+              << termcolor::reset << termcolor::bright_white << std::setw(12)
+              << std::right << std::fixed << std::setprecision(0)
+              << result["ns_per_op"].get<double>() << " ns/op"
+              << termcolor::reset << termcolor::bright_blue << std::setw(10)
+              << std::setprecision(1) << result["mb_per_s"].get<double>()
+              << " MB/s" << termcolor::reset << "\n";
+  }
+  std::cout << std::defaultfloat;
+}
+
+// Runs the bench from inside the corpus and puts things back afterwards,
+// also when a phase throws: the previous working directory is restored and
+// a temporary corpus removed
+class CorpusScope {
+public:
+  CorpusScope(const fs::path &root, bool temporary)
+      : root_(root), temporary_(temporary), previous_(fs::current_path()) {}
+  CorpusScope(const CorpusScope &) = delete;
+  CorpusScope &operator=(const CorpusScope &) = delete;
+  ~CorpusScope() { leave(); }
+
+  void enter() { fs::current_path(root_); }
+
+  void leave() {
+    if (left_) {
+      return;
+    }
+    left_ = true;
+    std::error_code ec;
+    fs::current_path(previous_, ec);
+    if (temporary_) {
+      fs::remove_all(root_, ec);
+    }
+  }
+
+private:
+  fs::path root_;
+  bool temporary_;
+  fs::path previous_;
+  bool left_ = false;
+};
+
+int run_bench(const BenchOptions &options) {
+  fs::path root = options.work_dir;
+  bool temporary = root.empty();
+  if (temporary) {
+    root = fs::temp_directory_path() / ("forge-bench-" +
+                                        std::to_string(::getpid()));
+    fs::remove_all(root);
+  } else if (fs::exists(root) && !fs::is_empty(root)) {
+    std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+              << "Bench directory " << termcolor::bright_white << root
+              << termcolor::reset << " is not empty\n";
+    return 1;
+  }
+  // The bench changes into the corpus, after which a relative path would
+  // point somewhere else
+  root = fs::absolute(root);
+
+  std::cout << "\n"
+            << termcolor::bright_cyan
+            << "╔═══════════════════════════════════════════╗\n"
+            << "║        ⏱  Forge Benchmark                 ║\n"
+            << "╚═══════════════════════════════════════════╝"
+            << termcolor::reset << "\n\n";
+
+  const CorpusOptions &corpus = options.corpus;
+  if (corpus.pages == 0) {
+    std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+              << "The corpus needs at least one page\n";
+    return 1;
+  }
+
+  CorpusScope scope(root, temporary);
+  double generate_ms = time_ms([&]() { generate_corpus(root, corpus); });
+
+  std::vector<std::string> sources;
+  size_t content_bytes = 0;
+  for (const auto &entry :
+       fs::recursive_directory_iterator(root / "content")) {
+    if (entry.is_regular_file() && entry.path().extension() == ".md") {
+      sources.push_back(read_text(entry.path()));
+      content_bytes += sources.back().size();
+    }
+  }
+
+  std::cout << termcolor::bright_green << "✓ " << termcolor::reset
+            << "Generated " << termcolor::bright_white << corpus.pages
+            << termcolor::reset << " pages in " << corpus.collections
+            << " collections (" << content_bytes / 1024 << " KB) in "
+            << static_cast<int>(generate_ms) << "ms\n";
+
+  // Templates include partials relative to the project root, as they do
+  // when forge runs from there
+  scope.enter();
+  BuildInfo::getInstance().generate_build_version();
+
+  std::vector<std::pair<std::string, std::vector<double>>> phase_samples;
+  size_t render_errors = 0;
+  int iterations = std::max(options.iterations, 1);
+
+  for (int i = 0; i < iterations; ++i) {
+    std::vector<std::pair<std::string, double>> phases;
+    time_phases(root, sources, phases, render_errors);
+
+    if (phase_samples.empty()) {
+      for (const auto &[name, ms] : phases) {
+        phase_samples.emplace_back(name, std::vector<double>());
+      }
+    }
+    for (size_t p = 0; p < phases.size(); ++p) {
+      phase_samples[p].second.push_back(phases[p].second);
+    }
+
+    std::cout << termcolor::bright_green << "  ✓ " << termcolor::reset
+              << "Run " << (i + 1) << "/" << iterations << "\n";
+  }
+
+  Results results;
+  results["label"] = options.label;
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  results["timestamp"] =
+      std::chrono::duration_cast<std::chrono::seconds>(now).count();
+  results["hardware_threads"] = std::thread::hardware_concurrency();
+  results["corpus"] = {{"pages", corpus.pages},
+                       {"collections", corpus.collections},
+                       {"tags", corpus.tags},
+                       {"body_words", corpus.body_words},
+                       {"template_complexity", corpus.template_complexity},
+                       {"seed", corpus.seed},
+                       {"content_bytes", content_bytes}};
+  results["iterations"] = iterations;
+  results["render_errors"] = render_errors / iterations;
+
+  Results phases;
+  for (const auto &[name, samples] : phase_samples) {
+    phases[name] = summarize(samples);
+  }
+  results["phases"] = std::move(phases);
+  results["micro"] = run_microbenchmarks(root, sources);
+
+  scope.leave();
+
+  print_results(results);
+
+  if (render_errors > 0) {
+    std::cout << termcolor::bright_yellow << "\n⚠ " << termcolor::reset
+              << render_errors / iterations
+              << " pages failed to render in each run\n";
+  }
+
+  if (options.json_path.empty()) {
+    std::cout << "\n" << results.dump(2) << "\n";
+  } else {
+    std::ofstream(options.json_path) << results.dump(2) << "\n";
+    std::cout << "\n"
+              << termcolor::bright_green << "✓ " << termcolor::reset
+              << "Results written to " << termcolor::bright_white
+              << options.json_path.string() << termcolor::reset << "\n\n";
+  }
+
+  return 0;
+}
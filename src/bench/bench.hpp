@@ -0,0 +1,25 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include "corpus.hpp"
+#include <filesystem>
+#include <string>
+
+struct BenchOptions {
+  CorpusOptions corpus;
+  // Timed runs of each build phase
+  int iterations = 5;
+  // Where the JSON results go; printed to stdout when empty
+  std::filesystem::path json_path;
+  // Where the corpus is generated; a temporary directory when empty
+  std::filesystem::path work_dir;
+  // Stored with the results to tell runs apart (a commit, say)
+  std::string label;
+};
+
+// `forge bench`: generates a synthetic site, times each build phase on it
+// and microbenchmarks the stages a page goes through. Returns the exit
+// status.
+int run_bench(const BenchOptions &options);
+
+#endif
@@ -0,0 +1,369 @@
+#include "corpus.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static const char *const vocabulary[] = {
+    "static",   "site",     "render",    "template", "page",    "build",
+    "fast",     "content",  "markdown",  "layout",   "server",  "cache",
+    "thread",   "memory",   "parse",     "output",   "collect", "index",
+    "feature",  "design",   "simple",    "modern",   "compile", "deploy",
+    "browser",  "network",  "request",   "response", "latency", "profile",
+    "measure",  "optimize", "structure", "reader",   "writer",  "theme",
+    "section",  "article",  "archive",   "feed",     "asset",   "image",
+    "style",    "script",   "bundle",    "module",   "package", "release",
+    "version",  "change",   "update",    "review",   "history", "future",
+    "question", "answer",   "example",   "pattern",  "detail",  "summary"};
+
+static std::string words(std::mt19937 &rng, size_t count) {
+  std::uniform_int_distribution<size_t> pick(0, std::size(vocabulary) - 1);
+  std::string text;
+  for (size_t i = 0; i < count; ++i) {
+    if (i > 0) {
+      text += ' ';
+    }
+    text += vocabulary[pick(rng)];
+  }
+  return text;
+}
+
+static std::string capitalized(std::string text) {
+  if (!text.empty()) {
+    text[0] = static_cast<char>(std::toupper(text[0]));
+  }
+  return text;
+}
+
+static void write_text(const fs::path &path, const std::string &content) {
+  fs::create_directories(path.parent_path());
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error("Cannot write file: " + path.string());
+  }
+  file << content;
+}
+
+static std::string collection_name(size_t index) {
+  static const char *const names[] = {"blog", "notes", "guides", "news",
+                                      "docs"};
+  if (index < std::size(names)) {
+    return names[index];
+  }
+  return "collection-" + std::to_string(index);
+}
+
+static std::string post_slug(size_t index) {
+  return std::format("post-{:05}", index);
+}
+
+static std::string post_date(size_t index) {
+  using namespace std::chrono;
+  year_month_day day{sys_days{year{2018} / January / 1} +
+                     days{static_cast<int>(index)}};
+  return std::format("{:04}-{:02}-{:02}", static_cast<int>(day.year()),
+                     static_cast<unsigned>(day.month()),
+                     static_cast<unsigned>(day.day()));
+}
+
+// Markdown with the constructs real posts use: headings, emphasis, links,
+// inline code, lists and fenced code blocks
+static std::string post_body(std::mt19937 &rng, size_t target_words,
+                             const std::vector<std::string> &link_targets) {
+  std::uniform_int_distribution<size_t> pick_link(0, link_targets.size() - 1);
+  std::string body;
+  size_t written = 0;
+  size_t section = 0;
+
+  while (written < target_words) {
+    body += "## " + capitalized(words(rng, 4)) + "\n\n";
+    written += 4;
+
+    // One draw per statement: operand order is unspecified, and the output
+    // must not depend on the compiler
+    for (int paragraph = 0; paragraph < 2; ++paragraph) {
+      body += capitalized(words(rng, 18));
+      body += " **" + words(rng, 2) + "** ";
+      body += words(rng, 12);
+      body += " [" + words(rng, 2) + "](";
+      body += link_targets[pick_link(rng)] + ") ";
+      body += words(rng, 10);
+      body += " `" + words(rng, 1) + "()` ";
+      body += words(rng, 14) + ".\n\n";
+      written += 59;
+    }
+
+    if (section % 2 == 0) {
+      for (int item = 0; item < 4; ++item) {
+        body += "- " + capitalized(words(rng, 6)) + "\n";
+      }
+      body += "\n";
+      written += 24;
+    } else {
+      body += "```cpp\nauto " + words(rng, 1);
+      body += " = build(\"" + words(rng, 1);
+      body += "\");\nfor (const auto &item : " + words(rng, 1);
+      body += ") {\n  render(item);\n}\n```\n\n";
+      written += 12;
+    }
+    ++section;
+  }
+
+  return body;
+}
+
+static std::string base_template(int complexity) {
+  std::string header = complexity >= 2
+                           ? "{% include \"templates/partials/header.html\" %}"
+                           : "<header><a href=\"/\">{{ site.site_name "
+                             "}}</a></header>";
+  std::string footer =
+      complexity >= 2 ? "{% include \"templates/partials/footer.html\" %}"
+                      : "<footer>Built with Forge</footer>";
+
+  return R"(<!DOCTYPE html>
+<html lang="en">
+  <head>
+    <meta charset="UTF-8" />
+    <meta name="viewport" content="width=device-width, initial-scale=1.0" />
+    <title>{{ page.title }} - {{ site.site_name }}</title>
+    <link rel="stylesheet" href="/static/css/site.css" />
+    <script defer src="/static/js/app.js"></script>
+  </head>
+  <body>
+    )" + header + R"(
+    <main>
+      {{ content }}
+    </main>
+    )" + footer + R"(
+  </body>
+</html>
+)";
+}
+
+static std::string collection_template(const std::string &collection,
+                                       int complexity) {
+  std::string tmpl = "<article>\n  <h1>{{ page.title }}</h1>\n";
+
+  if (complexity >= 2) {
+    tmpl += "  {% include \"templates/partials/post-meta.html\" %}\n";
+  } else if (complexity >= 1) {
+    tmpl += "  <p class=\"meta\">{{ page.date | date(\"long\") }} by "
+            "{{ page.author }}</p>\n";
+  }
+
+  tmpl += "  <div class=\"post-content\">{{ content }}</div>\n";
+
+  if (complexity >= 1) {
+    tmpl += "  {% if existsIn(page, \"tags\") %}\n"
+            "  <ul class=\"tags\">\n"
+            "    {% for tag in page.tags %}\n"
+            "    <li><a href=\"/tags#{{ tag }}\">{{ tag }}</a></li>\n"
+            "    {% endfor %}\n"
+            "  </ul>\n"
+            "  {% endif %}\n";
+  }
+  tmpl += "</article>\n";
+
+  if (complexity >= 1) {
+    tmpl += "<aside>\n  <h2>Recent</h2>\n  <ul>\n"
+            "    {% for post in limit(collections." +
+            collection +
+            ", 5) %}\n"
+            "    <li><a href=\"{{ post.url }}\">{{ post.title }}</a> "
+            "<small>{{ post.date | date(\"short\") }}</small></li>\n"
+            "    {% endfor %}\n  </ul>\n</aside>\n";
+  }
+
+  return tmpl;
+}
+
+static std::string listing_page(const std::string &collection,
+                                int complexity) {
+  std::string page = "---\ntitle: \"" + capitalized(collection) +
+                     "\"\n---\n\n<h1>" + capitalized(collection) +
+                     "</h1>\n{% for post in collections." + collection +
+                     " %}\n<article>\n"
+                     "  <h2><a href=\"{{ post.url }}\">{{ post.title }}</a>"
+                     "</h2>\n";
+  if (complexity >= 1) {
+    page += "  <p class=\"meta\">{{ post.date | date(\"long\") }}</p>\n";
+  }
+  page += "  <p>{{ post.description }}</p>\n</article>\n{% endfor %}\n";
+  return page;
+}
+
+static std::string stylesheet(std::mt19937 &rng) {
+  std::string css = "body {\n  margin: 0;\n  font-family: sans-serif;\n"
+                    "  line-height: 1.6;\n}\n\n";
+  std::uniform_int_distribution<int> size(1, 48);
+  std::uniform_int_distribution<int> color(0, 0xffffff);
+
+  for (int i = 0; i < 240; ++i) {
+    int vertical = size(rng);
+    int horizontal = size(rng);
+    int padding = size(rng);
+    int text = color(rng);
+    int border = color(rng);
+    css += std::format(".{}-{} {{\n  margin: {}px {}px;\n  padding: {}px;\n"
+                       "  color: #{:06x};\n"
+                       "  border: 1px solid #{:06x};\n}}\n\n",
+                       vocabulary[i % std::size(vocabulary)], i, vertical,
+                       horizontal, padding, text, border);
+  }
+  return css;
+}
+
+static std::string script(std::mt19937 &rng) {
+  std::string js = "\"use strict\";\n\n";
+  for (int i = 0; i < 60; ++i) {
+    std::string name = std::string(vocabulary[i % std::size(vocabulary)]) +
+                       "Handler" + std::to_string(i);
+    js += "function " + name +
+          "(event) {\n"
+          "  // " +
+          words(rng, 8) +
+          "\n"
+          "  const elements = document.querySelectorAll(\"." +
+          vocabulary[(i * 7) % std::size(vocabulary)] +
+          "\");\n"
+          "  for (const element of elements) {\n"
+          "    element.classList.toggle(\"active\", event.type === "
+          "\"click\");\n"
+          "  }\n"
+          "  return elements.length;\n"
+          "}\n\n"
+          "document.addEventListener(\"click\", " +
+          name + ");\n\n";
+  }
+  return js;
+}
+
+void generate_corpus(const fs::path &root, const CorpusOptions &options) {
+  std::mt19937 rng(options.seed);
+  size_t collection_count = std::max<size_t>(options.collections, 1);
+  size_t tag_count = std::max<size_t>(options.tags, 1);
+  int complexity = options.template_complexity;
+
+  std::vector<std::string> collections;
+  for (size_t i = 0; i < collection_count; ++i) {
+    collections.push_back(collection_name(i));
+  }
+
+  std::string config = "site_name: \"Forge Bench\"\n"
+                       "description: \"Synthetic site for forge bench\"\n"
+                       "author: \"Forge\"\n\n"
+                       "output_dir: \"dist\"\n"
+                       "static_dir: \"static\"\n"
+                       "content_dir: \"content\"\n"
+                       "templates_dir: \"templates\"\n\n"
+                       "minify_output: true\n\n"
+                       "collections:\n";
+  for (const auto &collection : collections) {
+    config += "  " + collection +
+              ":\n"
+              "    sort_by: \"date\"\n"
+              "    sort_order: \"desc\"\n"
+              "    template: \"" +
+              collection + ".html\"\n";
+  }
+  write_text(root / "forge.yaml", config);
+
+  write_text(root / "templates" / "base.html", base_template(complexity));
+  for (const auto &collection : collections) {
+    write_text(root / "templates" / (collection + ".html"),
+               collection_template(collection, complexity));
+  }
+  if (complexity >= 2) {
+    std::string nav = "<header>\n  <a href=\"/\">{{ site.site_name }}</a>\n"
+                      "  <nav>\n";
+    for (const auto &collection : collections) {
+      nav += "    <a href=\"/" + collection + "\">" +
+             capitalized(collection) + "</a>\n";
+    }
+    nav += "    <a href=\"/tags\">Tags</a>\n  </nav>\n</header>\n";
+    write_text(root / "templates" / "partials" / "header.html", nav);
+    write_text(root / "templates" / "partials" / "footer.html",
+               "<footer>\n  <p>{{ site.description }}</p>\n"
+               "  <p>&copy; {{ site.author }}</p>\n</footer>\n");
+    write_text(root / "templates" / "partials" / "post-meta.html",
+               "<p class=\"meta\">\n"
+               "  {% if existsIn(page, \"date\") %}{{ page.date | "
+               "date(\"long\") }}{% endif %}\n"
+               "  {% if existsIn(page, \"author\") %}by {{ page.author "
+               "}}{% endif %}\n</p>\n");
+  }
+
+  // Every post links to others, as real sites do
+  std::vector<std::string> urls;
+  for (size_t i = 0; i < options.pages; ++i) {
+    urls.push_back("/" + collections[i % collection_count] + "/" +
+                   post_slug(i));
+  }
+  if (urls.empty()) {
+    urls.push_back("/");
+  }
+
+  std::uniform_int_distribution<size_t> pick_tag(0, tag_count - 1);
+  for (size_t i = 0; i < options.pages; ++i) {
+    std::string tags;
+    for (int t = 0; t < 3; ++t) {
+      tags += (t > 0 ? ", " : "") +
+              std::format("\"tag-{}\"", pick_tag(rng));
+    }
+
+    std::string title = capitalized(words(rng, 5));
+    std::string description = capitalized(words(rng, 16));
+    std::string post = "---\ntitle: \"" + title + "\"\ndate: " +
+                       post_date(i) + "\nauthor: \"Author " +
+                       std::to_string(i % 7) + "\"\ndescription: \"" +
+                       description + "\"\ntags: [" + tags + "]\n---\n\n";
+    post += post_body(rng, options.body_words, urls);
+    write_text(root / "content" / collections[i % collection_count] /
+                   (post_slug(i) + ".md"),
+               post);
+  }
+
+  std::string index = "---\ntitle: \"Home\"\n---\n\n<h1>Forge Bench</h1>\n";
+  for (const auto &collection : collections) {
+    index += "<section>\n  <h2>" + capitalized(collection) +
+             "</h2>\n  <ul>\n    {% for post in limit(collections." +
+             collection +
+             ", 10) %}\n"
+             "    <li><a href=\"{{ post.url }}\">{{ post.title }}</a></li>\n"
+             "    {% endfor %}\n  </ul>\n</section>\n";
+  }
+  write_text(root / "content" / "pages" / "index.html", index);
+
+  for (const auto &collection : collections) {
+    write_text(root / "content" / "pages" / (collection + ".html"),
+               listing_page(collection, complexity));
+  }
+
+  write_text(root / "content" / "pages" / "about.md",
+             "---\ntitle: \"About\"\n---\n\n" +
+                 post_body(rng, options.body_words / 2, urls));
+
+  if (complexity >= 2) {
+    std::string tags_page = "---\ntitle: \"Tags\"\n---\n\n<h1>Tags</h1>\n";
+    for (const auto &collection : collections) {
+      tags_page += "{% for post in collections." + collection +
+                   " %}\n"
+                   "{% for tag in post.tags %}\n"
+                   "<p id=\"{{ tag }}\"><a href=\"{{ post.url }}\">"
+                   "{{ post.title }}</a> ({{ tag }})</p>\n"
+                   "{% endfor %}\n{% endfor %}\n";
+    }
+    write_text(root / "content" / "pages" / "tags.html", tags_page);
+  }
+
+  write_text(root / "static" / "css" / "site.css", stylesheet(rng));
+  write_text(root / "static" / "js" / "app.js", script(rng));
+}
@@ -0,0 +1,28 @@
+#ifndef CORPUS_HPP
+#define CORPUS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// Shape of a synthetic site for `forge bench`. The same options always
+// produce the same files, so runs on different commits measure the same
+// input.
+struct CorpusOptions {
+  size_t pages = 500;
+  size_t collections = 3;
+  size_t tags = 20;
+  // Approximate number of words in each page body
+  size_t body_words = 600;
+  // 0: title and body only; 1: adds dates, tag lists and a recent-posts
+  // sidebar; 2: adds included partials and a tag index over every post
+  int template_complexity = 1;
+  uint32_t seed = 42;
+};
+
+// Writes forge.yaml, templates, content and static files under `root`,
+// which should be empty
+void generate_corpus(const std::filesystem::path &root,
+                     const CorpusOptions &options);
+
+#endif
@@ -0,0 +1,112 @@
+#include "forge_process.hpp"
+#include <chrono>
+#include <csignal>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+ForgeProcess::ForgeProcess(const fs::path &root,
+                           const std::vector<std::string> &args,
+                           const fs::path &log) {
+  // Nothing but async-signal-safe calls may happen between fork and exec,
+  // since the log thread may hold locks
+  std::string root_dir = root.string();
+  std::string log_path = log.string();
+  std::vector<char *> argv;
+  argv.push_back(const_cast<char *>("forge"));
+  for (const auto &arg : args) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+
+  // A child that died would otherwise take us with it on the next write to
+  // its stdin
+  std::signal(SIGPIPE, SIG_IGN);
+
+  int input[2];
+  if (pipe(input) != 0) {
+    throw std::runtime_error("Cannot create a pipe for forge " + args.at(0));
+  }
+
+  pid_ = fork();
+  if (pid_ < 0) {
+    close(input[0]);
+    close(input[1]);
+    throw std::runtime_error("Cannot start forge " + args.at(0));
+  }
+
+  if (pid_ == 0) {
+    int output = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(input[0], STDIN_FILENO);
+    if (output >= 0) {
+      dup2(output, STDOUT_FILENO);
+      dup2(output, STDERR_FILENO);
+    }
+    close(input[0]);
+    close(input[1]);
+    if (chdir(root_dir.c_str()) == 0) {
+      execv("/proc/self/exe", argv.data());
+    }
+    _exit(127);
+  }
+
+  close(input[0]);
+  stdin_ = input[1];
+}
+
+ForgeProcess::~ForgeProcess() { stop(); }
+
+bool ForgeProcess::running() {
+  if (pid_ <= 0) {
+    return false;
+  }
+  int status = 0;
+  if (waitpid(pid_, &status, WNOHANG) == 0) {
+    return true;
+  }
+  pid_ = -1;
+  return false;
+}
+
+bool ForgeProcess::stop() {
+  if (stdin_ >= 0) {
+    if (write(stdin_, "\n", 1) < 0) {
+      // Already gone; waitpid below reaps it
+    }
+    close(stdin_);
+    stdin_ = -1;
+  }
+  if (pid_ <= 0) {
+    return true;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  int status = 0;
+  while (waitpid(pid_, &status, WNOHANG) == 0) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      kill(pid_, SIGKILL);
+      waitpid(pid_, &status, 0);
+      pid_ = -1;
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  pid_ = -1;
+  return true;
+}
+
+size_t resident_kb(pid_t pid) {
+  std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("VmRSS:", 0) == 0) {
+      return std::stoul(line.substr(6));
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef FORGE_PROCESS_HPP
+#define FORGE_PROCESS_HPP
+
+#include <filesystem>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// A forge command run from `root` as a child of this process, with its
+// output in `log`. The servers stop when a line is written to their stdin,
+// as they do for a person pressing ENTER.
+class ForgeProcess {
+public:
+  ForgeProcess(const std::filesystem::path &root,
+               const std::vector<std::string> &args,
+               const std::filesystem::path &log);
+  ~ForgeProcess();
+
+  ForgeProcess(const ForgeProcess &) = delete;
+  ForgeProcess &operator=(const ForgeProcess &) = delete;
+
+  pid_t pid() const { return pid_; }
+
+  bool running();
+
+  // Asks it to shut down and kills it if it hasn't within a few seconds.
+  // False if it had to be killed.
+  bool stop();
+
+private:
+  pid_t pid_ = -1;
+  int stdin_ = -1;
+};
+
+// Resident memory of `pid` in KB, from /proc
+size_t resident_kb(pid_t pid);
+
+#endif
@@ -0,0 +1,507 @@
+#include "loadtest.hpp"
+#include "forge_process.hpp"
+#include "vendor/termcolor.hpp"
+#include <algorithm>
+#include <atomic>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <vendor/nlohmann/json.hpp>
+
+namespace fs = std::filesystem;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+using Results = nlohmann::ordered_json;
+
+// `forge serve` always listens here
+static constexpr unsigned short serve_port = 8080;
+
+// Escapes everything in a path but unreserved characters and '/'
+static std::string encode_path(const std::string &path) {
+  static const char hex[] = "0123456789ABCDEF";
+  std::string encoded;
+  for (unsigned char c : path) {
+    if (std::isalnum(c) || c == '/' || c == '-' || c == '_' || c == '.' ||
+        c == '~') {
+      encoded += static_cast<char>(c);
+    } else {
+      encoded += '%';
+      encoded += hex[c >> 4];
+      encoded += hex[c & 15];
+    }
+  }
+  return encoded;
+}
+
+// The URLs a server of `dist` answers, mapped the way SiteImage does:
+// pages by their directory, everything else by its path. Precompressed .gz
+// siblings are sent in place of their originals, so they aren't URLs.
+static std::vector<std::string> site_urls(const fs::path &dist) {
+  std::vector<std::string> urls;
+  for (const auto &entry : fs::recursive_directory_iterator(dist)) {
+    if (!entry.is_regular_file() || entry.path().extension() == ".gz") {
+      continue;
+    }
+    std::string url = "/" + fs::relative(entry.path(), dist).generic_string();
+    if (entry.path().filename() == "index.html") {
+      url.resize(url.size() - std::string("/index.html").size());
+      if (url.empty()) {
+        url = "/";
+      }
+    }
+    urls.push_back(encode_path(url));
+  }
+  // Directory order varies between file systems
+  std::sort(urls.begin(), urls.end());
+  return urls;
+}
+
+static bool reachable(const tcp::endpoint &endpoint) {
+  try {
+    net::io_context ioc;
+    tcp::socket socket(ioc);
+    socket.connect(endpoint);
+    return true;
+  } catch (const std::exception &) {
+    return false;
+  }
+}
+
+// Shared by every connection and only read while the test runs
+struct LoadPlan {
+  std::vector<std::string> urls;
+  tcp::endpoint endpoint;
+  std::string host;
+  // Responses completed in [measure_from, measure_until) are counted
+  Clock::time_point measure_from;
+  Clock::time_point measure_until;
+  std::atomic<bool> stopping{false};
+};
+
+// What one connection saw; merged once the run is over, so the hot path
+// shares nothing between connections
+struct Tally {
+  std::vector<uint32_t> latency_us;
+  uint64_t bytes = 0;
+  std::map<unsigned, size_t> error_statuses;
+  size_t transport_errors = 0;
+  size_t reconnects = 0;
+};
+
+// A keep-alive connection with one request in flight at a time, walking
+// the URL list from its own starting point. A connection the server closes
+// is opened again and counted.
+class LoadConnection : public std::enable_shared_from_this<LoadConnection> {
+public:
+  LoadConnection(net::io_context &ioc, LoadPlan &plan, size_t first_url,
+                 Tally &tally)
+      : stream_(net::make_strand(ioc)), retry_(stream_.get_executor()),
+        plan_(plan), next_url_(first_url), tally_(tally) {
+    request_.version(11);
+    request_.method(http::verb::get);
+    request_.set(http::field::host, plan_.host);
+    request_.set(http::field::user_agent, "forge-loadtest");
+    // As a browser would ask
+    request_.set(http::field::accept_encoding, "gzip");
+    request_.keep_alive(true);
+  }
+
+  void start() { connect(); }
+
+private:
+  static constexpr std::chrono::seconds io_timeout{10};
+
+  void connect() {
+    stream_.expires_after(io_timeout);
+    stream_.async_connect(plan_.endpoint,
+                          beast::bind_front_handler(&LoadConnection::on_connect,
+                                                    shared_from_this()));
+  }
+
+  void on_connect(beast::error_code ec) {
+    if (ec) {
+      failed();
+      return;
+    }
+    send();
+  }
+
+  void send() {
+    if (plan_.stopping) {
+      beast::error_code ignored;
+      stream_.socket().shutdown(tcp::socket::shutdown_both, ignored);
+      return;
+    }
+
+    request_.target(plan_.urls[next_url_++ % plan_.urls.size()]);
+    parser_.emplace();
+    parser_->body_limit(boost::none);
+    sent_at_ = Clock::now();
+
+    stream_.expires_after(io_timeout);
+    http::async_write(stream_, request_,
+                      beast::bind_front_handler(&LoadConnection::on_write,
+                                                shared_from_this()));
+  }
+
+  void on_write(beast::error_code ec, std::size_t) {
+    if (ec) {
+      failed();
+      return;
+    }
+    http::async_read(stream_, buffer_, *parser_,
+                     beast::bind_front_handler(&LoadConnection::on_read,
+                                               shared_from_this()));
+  }
+
+  void on_read(beast::error_code ec, std::size_t) {
+    if (ec) {
+      failed();
+      return;
+    }
+
+    auto now = Clock::now();
+    const auto &response = parser_->get();
+    if (now >= plan_.measure_from && now < plan_.measure_until) {
+      tally_.latency_us.push_back(static_cast<uint32_t>(
+          std::chrono::duration_cast<std::chrono::microseconds>(now - sent_at_)
+              .count()));
+      tally_.bytes += response.body().size();
+      if (response.result_int() >= 400) {
+        tally_.error_statuses[response.result_int()]++;
+      }
+    }
+
+    if (!response.keep_alive()) {
+      reconnect();
+      return;
+    }
+    send();
+  }
+
+  void failed() {
+    if (plan_.stopping) {
+      return;
+    }
+    auto now = Clock::now();
+    if (now >= plan_.measure_from && now < plan_.measure_until) {
+      tally_.transport_errors++;
+    }
+
+    // Backs off a little so a server that is down isn't hammered with
+    // connection attempts
+    retry_.expires_after(std::chrono::milliseconds(50));
+    retry_.async_wait(
+        [self = shared_from_this()](beast::error_code) { self->reconnect(); });
+  }
+
+  void reconnect() {
+    if (plan_.stopping) {
+      return;
+    }
+    tally_.reconnects++;
+    beast::error_code ignored;
+    stream_.socket().close(ignored);
+    buffer_.clear();
+    connect();
+  }
+
+  beast::tcp_stream stream_;
+  net::steady_timer retry_;
+  LoadPlan &plan_;
+  size_t next_url_;
+  Tally &tally_;
+  http::request<http::empty_body> request_;
+  std::optional<http::response_parser<http::string_body>> parser_;
+  beast::flat_buffer buffer_;
+  Clock::time_point sent_at_;
+};
+
+// Nearest rank of `p` in sorted `values`, in milliseconds
+static double percentile_ms(const std::vector<uint32_t> &sorted_us,
+                            double p) {
+  if (sorted_us.empty()) {
+    return 0;
+  }
+  size_t rank = static_cast<size_t>(p / 100 * sorted_us.size() + 0.5);
+  return sorted_us[std::clamp<size_t>(rank, 1, sorted_us.size()) - 1] /
+         1000.0;
+}
+
+static void print_results(const Results &results) {
+  std::cout << "\n"
+            << termcolor::bright_cyan << "⚡ Load test" << termcolor::reset
+            << termcolor::bright_blue << " (" << results["connections"]
+            << " connections, " << results["urls"] << " URLs, "
+            << results["duration_s"].get<double>() << "s)"
+            << termcolor::reset << "\n";
+
+  auto row = [](const std::string &name, const std::string &value) {
+    std::cout << "  " << termcolor::white << std::setw(12) << std::left
+              << name << termcolor::reset << termcolor::bright_white << value
+              << termcolor::reset << "\n";
+  };
+
+  const Results &latency = results["latency_ms"];
+  const Results &errors = results["errors"];
+  row("Requests", std::format("{} ({:.0f}/s)",
+                              results["requests"].get<size_t>(),
+                              results["requests_per_s"].get<double>()));
+  row("Transfer",
+      std::format("{:.1f} MB ({:.1f} MB/s)",
+                  results["bytes"].get<uint64_t>() / 1e6,
+                  results["mb_per_s"].get<double>()));
+  row("Latency",
+      std::format("p50 {:.2f}ms · p99 {:.2f}ms · p999 {:.2f}ms · max "
+                  "{:.2f}ms",
+                  latency["p50"].get<double>(), latency["p99"].get<double>(),
+                  latency["p999"].get<double>(),
+                  latency["max"].get<double>()));
+  row("Errors", std::format("{} ({} transport, {} reconnects)",
+                            errors["total"].get<size_t>(),
+                            errors["transport"].get<size_t>(),
+                            results["reconnects"].get<size_t>()));
+  for (const auto &[status, count] : errors["status"].items()) {
+    std::cout << termcolor::bright_yellow << "    ⚠ " << termcolor::reset
+              << "HTTP " << status << termcolor::bright_blue << " × "
+              << count.get<size_t>() << termcolor::reset << "\n";
+  }
+  if (results.contains("server_rss_kb")) {
+    row("Server RSS", std::format("{:.1f} MB",
+                                  results["server_rss_kb"].get<size_t>() /
+                                      1024.0));
+  }
+}
+
+int run_loadtest(const LoadTestOptions &options) {
+  std::cout << "\n"
+            << termcolor::bright_cyan
+            << "╔═══════════════════════════════════════════╗\n"
+            << "║        ⚡ Forge Load Test                 ║\n"
+            << "╚═══════════════════════════════════════════╝"
+            << termcolor::reset << "\n\n";
+
+  if (!fs::is_directory(options.dist)) {
+    std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+              << termcolor::bright_white << options.dist.string()
+              << termcolor::reset << " not found; run forge build first\n";
+    return 1;
+  }
+  if (options.connections == 0 || options.duration_s <= 0) {
+    std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+              << "Connections and duration must be above zero\n";
+    return 1;
+  }
+  if (options.serve && options.port != serve_port) {
+    std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+              << "forge serve listens on port " << serve_port
+              << "; --serve can't be combined with --port\n";
+    return 1;
+  }
+
+  LoadPlan plan;
+  plan.urls = site_urls(options.dist);
+  if (plan.urls.empty()) {
+    std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+              << termcolor::bright_white << options.dist.string()
+              << termcolor::reset << " has no files to request\n";
+    return 1;
+  }
+  plan.host = options.port == 80
+                  ? options.host
+                  : std::format("{}:{}", options.host, options.port);
+
+  try {
+    net::io_context resolve_ioc;
+    tcp::resolver resolver(resolve_ioc);
+    plan.endpoint =
+        *resolver.resolve(options.host, std::to_string(options.port)).begin();
+  } catch (const std::exception &e) {
+    std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+              << "Cannot resolve " << options.host << ": " << e.what()
+              << "\n";
+    return 1;
+  }
+
+  std::optional<ForgeProcess> server;
+  fs::path log_path = fs::temp_directory_path() /
+                      ("forge-loadtest-" + std::to_string(::getpid()) +
+                       ".log");
+  if (options.serve) {
+    if (reachable(plan.endpoint)) {
+      std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+                << "Port " << serve_port
+                << " is already in use; stop the other server first\n";
+      return 1;
+    }
+
+    auto launch_start = Clock::now();
+    server.emplace(fs::current_path(),
+                   std::vector<std::string>{"serve", "--quiet"}, log_path);
+    while (!reachable(plan.endpoint) && server->running() &&
+           Clock::now() - launch_start < std::chrono::seconds(60)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+  }
+
+  if (!reachable(plan.endpoint)) {
+    std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+              << "Nothing is answering on " << termcolor::bright_white
+              << plan.host << termcolor::reset;
+    if (options.serve) {
+      std::cerr << "; forge serve's output is in " << log_path.string()
+                << "\n";
+    } else {
+      std::cerr << "; start forge serve or pass --serve\n";
+    }
+    return 1;
+  }
+
+  std::cout << termcolor::bright_green << "✓ " << termcolor::reset
+            << termcolor::bright_white << plan.urls.size() << termcolor::reset
+            << " URLs from " << options.dist.string() << ", target "
+            << termcolor::bright_white << "http://" << plan.host
+            << termcolor::reset;
+  if (server) {
+    std::cout << termcolor::bright_blue << " (forge serve, pid "
+              << server->pid() << ")" << termcolor::reset;
+  }
+  std::cout << "\n";
+
+  unsigned threads = options.threads;
+  if (threads == 0) {
+    threads = std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+  }
+
+  auto to_duration = [](double seconds) {
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(seconds));
+  };
+  auto start = Clock::now();
+  plan.measure_from = start + to_duration(std::max(options.warmup_s, 0.0));
+  plan.measure_until = plan.measure_from + to_duration(options.duration_s);
+
+  net::io_context ioc(static_cast<int>(threads));
+  std::vector<Tally> tallies(options.connections);
+  for (size_t i = 0; i < options.connections; ++i) {
+    // Spread over the list so connections don't all ask for the same file
+    size_t first_url = i * plan.urls.size() / options.connections;
+    std::make_shared<LoadConnection>(ioc, plan, first_url, tallies[i])
+        ->start();
+  }
+
+  std::vector<std::thread> io_threads;
+  for (unsigned i = 0; i < threads; ++i) {
+    io_threads.emplace_back([&ioc]() { ioc.run(); });
+  }
+
+  std::cout << termcolor::bright_blue << "⏳ " << termcolor::reset
+            << "Running for " << options.warmup_s << "s warm-up + "
+            << options.duration_s << "s on " << threads << " threads...\n";
+  std::this_thread::sleep_until(plan.measure_until);
+  plan.stopping = true;
+  // Connections finish their request in flight and close
+  for (auto &thread : io_threads) {
+    thread.join();
+  }
+
+  std::optional<size_t> server_rss_kb;
+  if (server) {
+    server_rss_kb = resident_kb(server->pid());
+    if (!server->stop()) {
+      std::cerr << termcolor::bright_yellow << "⚠ " << termcolor::reset
+                << "forge serve did not stop on its own and was killed\n";
+    }
+    fs::remove(log_path);
+  }
+
+  std::vector<uint32_t> latency_us;
+  uint64_t bytes = 0;
+  std::map<unsigned, size_t> error_statuses;
+  size_t transport_errors = 0;
+  size_t reconnects = 0;
+  for (auto &tally : tallies) {
+    latency_us.insert(latency_us.end(), tally.latency_us.begin(),
+                      tally.latency_us.end());
+    bytes += tally.bytes;
+    for (const auto &[status, count] : tally.error_statuses) {
+      error_statuses[status] += count;
+    }
+    transport_errors += tally.transport_errors;
+    reconnects += tally.reconnects;
+  }
+  std::sort(latency_us.begin(), latency_us.end());
+
+  size_t status_errors = 0;
+  Results statuses = Results::object();
+  for (const auto &[status, count] : error_statuses) {
+    status_errors += count;
+    statuses[std::to_string(status)] = count;
+  }
+  double mean_ms =
+      latency_us.empty()
+          ? 0
+          : std::accumulate(latency_us.begin(), latency_us.end(), 0.0) /
+                latency_us.size() / 1000.0;
+
+  Results results;
+  results["label"] = options.label;
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  results["timestamp"] =
+      std::chrono::duration_cast<std::chrono::seconds>(now).count();
+  results["target"] = plan.host;
+  results["urls"] = plan.urls.size();
+  results["connections"] = options.connections;
+  results["threads"] = threads;
+  results["duration_s"] = options.duration_s;
+  results["requests"] = latency_us.size();
+  results["requests_per_s"] = latency_us.size() / options.duration_s;
+  results["bytes"] = bytes;
+  results["mb_per_s"] = bytes / 1e6 / options.duration_s;
+  results["latency_ms"] = {{"mean", mean_ms},
+                           {"p50", percentile_ms(latency_us, 50)},
+                           {"p90", percentile_ms(latency_us, 90)},
+                           {"p99", percentile_ms(latency_us, 99)},
+                           {"p999", percentile_ms(latency_us, 99.9)},
+                           {"max", percentile_ms(latency_us, 100)}};
+  results["errors"] = {{"total", status_errors + transport_errors},
+                       {"transport", transport_errors},
+                       {"status", std::move(statuses)}};
+  results["reconnects"] = reconnects;
+  if (server_rss_kb) {
+    results["server_rss_kb"] = *server_rss_kb;
+  }
+
+  print_results(results);
+
+  if (options.json_path.empty()) {
+    std::cout << "\n" << results.dump(2) << "\n";
+  } else {
+    std::ofstream(options.json_path) << results.dump(2) << "\n";
+    std::cout << "\n"
+              << termcolor::bright_green << "✓ " << termcolor::reset
+              << "Results written to " << termcolor::bright_white
+              << options.json_path.string() << termcolor::reset << "\n\n";
+  }
+
+  return status_errors + transport_errors > 0 ? 1 : 0;
+}
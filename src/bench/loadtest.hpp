@@ -0,0 +1,36 @@
+#ifndef LOADTEST_HPP
+#define LOADTEST_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+
+struct LoadTestOptions {
+  // The built site whose files are requested
+  std::filesystem::path dist = "dist";
+  std::string host = "127.0.0.1";
+  unsigned short port = 8080;
+  // Keep-alive connections, each with one request in flight
+  size_t connections = 64;
+  // Client threads; 0 picks one per hardware thread, up to 8
+  unsigned threads = 0;
+  double duration_s = 10;
+  // Requests before this point aren't counted, so connection setup and
+  // cold caches don't skew the results
+  double warmup_s = 1;
+  // Starts `forge serve` from the current directory for the run instead of
+  // testing a server that is already running
+  bool serve = false;
+  // Where the JSON results go; printed to stdout when empty
+  std::filesystem::path json_path;
+  // Stored with the results to tell runs apart
+  std::string label;
+};
+
+// `forge loadtest`: replays every URL of a built `dist` (pages and the
+// static files beside them) against an HTTP server over keep-alive
+// connections and reports requests per second, latency percentiles and
+// errors. Returns the exit status.
+int run_loadtest(const LoadTestOptions &options);
+
+#endif
@@ -0,0 +1,647 @@
+#include "stress.hpp"
+#include "forge_process.hpp"
+#include "vendor/termcolor.hpp"
+#include <algorithm>
+#include <atomic>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include <vendor/nlohmann/json.hpp>
+
+namespace fs = std::filesystem;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+using Results = nlohmann::ordered_json;
+
+// `forge dev` always listens here
+static constexpr unsigned short dev_port = 8080;
+
+static tcp::endpoint dev_endpoint() {
+  return tcp::endpoint(net::ip::make_address("127.0.0.1"), dev_port);
+}
+
+static double ms_between(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Nearest rank of `p` in `values`
+static double percentile(std::vector<double> values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  size_t rank = static_cast<size_t>(p / 100 * values.size() + 0.5);
+  return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+}
+
+static bool port_in_use() {
+  try {
+    net::io_context ioc;
+    tcp::socket socket(ioc);
+    socket.connect(dev_endpoint());
+    return true;
+  } catch (const std::exception &) {
+    return false;
+  }
+}
+
+// One GET against the dev server; nothing if it isn't answering
+static std::optional<std::string> http_get(const std::string &target) {
+  try {
+    net::io_context ioc;
+    tcp::socket socket(ioc);
+    socket.connect(dev_endpoint());
+
+    http::request<http::empty_body> req{http::verb::get, target, 11};
+    req.set(http::field::host, "127.0.0.1");
+    req.set(http::field::connection, "close");
+    http::write(socket, req);
+
+    beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+    http::read(socket, buffer, res);
+    if (res.result() != http::status::ok) {
+      return std::nullopt;
+    }
+    return res.body();
+  } catch (const std::exception &) {
+    return std::nullopt;
+  }
+}
+
+static std::optional<uint64_t> current_version() {
+  auto body = http_get("/version");
+  if (!body) {
+    return std::nullopt;
+  }
+  auto data = nlohmann::json::parse(*body, nullptr, false);
+  if (!data.is_object() || !data.contains("version") ||
+      !data["version"].is_number_unsigned()) {
+    return std::nullopt;
+  }
+  return data["version"].get<uint64_t>();
+}
+
+// The value of an unlabelled series in the Prometheus text format
+static double metric(const std::string &text, const std::string &name) {
+  std::istringstream lines(text);
+  std::string line;
+  while (std::getline(lines, line)) {
+    if (line.size() > name.size() && line.compare(0, name.size(), name) == 0 &&
+        line[name.size()] == ' ') {
+      return std::stod(line.substr(name.size() + 1));
+    }
+  }
+  return 0;
+}
+
+// What the clients received, written from the io threads
+struct Deliveries {
+  explicit Deliveries(size_t clients) : received(clients), closed(clients) {}
+
+  std::mutex mutex;
+  // Per client, the version of each message and when it arrived
+  std::vector<std::vector<std::pair<uint64_t, Clock::time_point>>> received;
+  // Clients whose connection ended before the harness closed it
+  std::vector<bool> closed;
+  std::atomic<size_t> connected{0};
+  std::atomic<size_t> failed{0};
+};
+
+// A browser tab as far as the dev server can tell: it connects to the live
+// reload socket and takes every message. It doesn't say which page it
+// shows, so every change is sent to it.
+class StressClient : public std::enable_shared_from_this<StressClient> {
+public:
+  StressClient(net::io_context &ioc, size_t index, Deliveries &deliveries)
+      : ws_(net::make_strand(ioc)), index_(index), deliveries_(deliveries) {}
+
+  void start() {
+    beast::get_lowest_layer(ws_).async_connect(
+        dev_endpoint(), beast::bind_front_handler(&StressClient::on_connect,
+                                                  shared_from_this()));
+  }
+
+  void close() {
+    net::post(ws_.get_executor(), [self = shared_from_this()]() {
+      self->stopping_ = true;
+      beast::get_lowest_layer(self->ws_).close();
+    });
+  }
+
+private:
+  void on_connect(beast::error_code ec) {
+    if (ec) {
+      deliveries_.failed++;
+      return;
+    }
+
+    ws_.set_option(
+        websocket::stream_base::timeout::suggested(beast::role_type::client));
+    // Browsers offer compression, so the server's deflate path is exercised
+    websocket::permessage_deflate deflate;
+    deflate.client_enable = true;
+    ws_.set_option(deflate);
+
+    ws_.async_handshake(std::format("127.0.0.1:{}", dev_port), "/__livereload",
+                        beast::bind_front_handler(&StressClient::on_handshake,
+                                                  shared_from_this()));
+  }
+
+  void on_handshake(beast::error_code ec) {
+    if (ec) {
+      deliveries_.failed++;
+      return;
+    }
+    deliveries_.connected++;
+    read();
+  }
+
+  void read() {
+    ws_.async_read(buffer_, beast::bind_front_handler(&StressClient::on_read,
+                                                      shared_from_this()));
+  }
+
+  void on_read(beast::error_code ec, std::size_t) {
+    auto arrived = Clock::now();
+    if (ec) {
+      if (!stopping_) {
+        std::lock_guard<std::mutex> lock(deliveries_.mutex);
+        deliveries_.closed[index_] = true;
+      }
+      return;
+    }
+
+    auto data = nlohmann::json::parse(beast::buffers_to_string(buffer_.data()),
+                                      nullptr, false);
+    buffer_.clear();
+    if (data.is_object() && data.contains("version") &&
+        data["version"].is_number_unsigned()) {
+      std::lock_guard<std::mutex> lock(deliveries_.mutex);
+      deliveries_.received[index_].emplace_back(
+          data["version"].get<uint64_t>(), arrived);
+    }
+    read();
+  }
+
+  websocket::stream<beast::tcp_stream> ws_;
+  beast::flat_buffer buffer_;
+  size_t index_;
+  Deliveries &deliveries_;
+  bool stopping_ = false;
+};
+
+// The dev server's memory, sampled on a thread of its own
+class MemorySampler {
+public:
+  explicit MemorySampler(pid_t pid) : pid_(pid), start_(Clock::now()) {
+    thread_ = std::thread([this]() {
+      while (!stopping_) {
+        size_t kb = resident_kb(pid_);
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          samples_.emplace_back(ms_between(start_, Clock::now()), kb);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+    });
+  }
+
+  ~MemorySampler() { stop(); }
+
+  void stop() {
+    stopping_ = true;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  // Milliseconds since the sampler started, and resident KB at the time
+  std::vector<std::pair<double, size_t>> samples() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return samples_;
+  }
+
+private:
+  pid_t pid_;
+  Clock::time_point start_;
+  std::mutex mutex_;
+  std::vector<std::pair<double, size_t>> samples_;
+  std::atomic<bool> stopping_{false};
+  std::thread thread_;
+};
+
+// Rewrites `count` content files, continuing round the list from where
+// the previous burst stopped. Appending keeps every page valid markdown.
+static void write_burst(const std::vector<fs::path> &sources, size_t burst,
+                        size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    const fs::path &path = sources[(burst * count + i) % sources.size()];
+    std::ofstream(path, std::ios::app)
+        << "\nStress edit " << burst << "." << i << "\n";
+  }
+}
+
+// Polls /version until it has moved on from `before` and then stayed put
+// for `settle`. Returns the final version and when it was published, or
+// nothing if no rebuild was seen in time.
+static std::optional<std::pair<uint64_t, Clock::time_point>>
+wait_for_settle(uint64_t before, std::chrono::milliseconds settle) {
+  constexpr auto timeout = std::chrono::seconds(60);
+  auto deadline = Clock::now() + timeout;
+  uint64_t version = before;
+  auto changed_at = Clock::now();
+
+  while (Clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(25));
+    auto now_version = current_version();
+    if (now_version && *now_version != version) {
+      version = *now_version;
+      changed_at = Clock::now();
+    }
+    if (version != before && Clock::now() - changed_at >= settle) {
+      return std::make_pair(version, changed_at);
+    }
+  }
+  return std::nullopt;
+}
+
+static void print_summary(const Results &results) {
+  const Results &summary = results["summary"];
+  const Results &memory = results["memory"];
+
+  std::cout << "\n"
+            << termcolor::bright_cyan << "📊 Summary" << termcolor::reset
+            << "\n";
+
+  auto row = [](const std::string &name, const std::string &value) {
+    std::cout << "  " << termcolor::white << std::setw(22) << std::left
+              << name << termcolor::reset << termcolor::bright_white << value
+              << termcolor::reset << "\n";
+  };
+
+  row("Files written", std::to_string(summary["files_written"].get<size_t>()));
+  row("Rebuilds", std::format("{} ({} failed)",
+                              summary["rebuilds"].get<size_t>(),
+                              summary["rebuild_failures"].get<size_t>()));
+  row("Reloads delivered",
+      std::format("{} of {}", summary["delivered"].get<size_t>(),
+                  summary["expected"].get<size_t>()));
+  row("Missed / disconnected",
+      std::format("{} / {}", summary["missed"].get<size_t>(),
+                  summary["disconnected"].get<size_t>()));
+  row("Notify latency",
+      std::format("p50 {:.0f}ms · p99 {:.0f}ms · max {:.0f}ms",
+                  summary["notify_ms"]["p50"].get<double>(),
+                  summary["notify_ms"]["p99"].get<double>(),
+                  summary["notify_ms"]["max"].get<double>()));
+  row("Fan-out spread",
+      std::format("p50 {:.1f}ms · max {:.1f}ms",
+                  summary["fanout_ms"]["p50"].get<double>(),
+                  summary["fanout_ms"]["max"].get<double>()));
+  row("Server memory",
+      std::format("{:.1f} MB → peak {:.1f} MB → {:.1f} MB",
+                  memory["start_kb"].get<size_t>() / 1024.0,
+                  memory["peak_kb"].get<size_t>() / 1024.0,
+                  memory["end_kb"].get<size_t>() / 1024.0));
+}
+
+int run_stress(const StressOptions &options) {
+  fs::path root = options.work_dir;
+  bool temporary = root.empty();
+  if (temporary) {
+    root = fs::temp_directory_path() /
+           ("forge-stress-" + std::to_string(::getpid()));
+    fs::remove_all(root);
+  } else if (fs::exists(root) && !fs::is_empty(root)) {
+    std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+              << "Stress directory " << termcolor::bright_white << root
+              << termcolor::reset << " is not empty\n";
+    return 1;
+  }
+  root = fs::absolute(root);
+
+  std::cout << "\n"
+            << termcolor::bright_cyan
+            << "╔═══════════════════════════════════════════╗\n"
+            << "║        🌪  Forge Live Reload Stress        ║\n"
+            << "╚═══════════════════════════════════════════╝"
+            << termcolor::reset << "\n\n";
+
+  if (options.corpus.pages == 0 || options.clients == 0 ||
+      options.bursts == 0 || options.burst_files == 0) {
+    std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+              << "Pages, clients, bursts and files per burst must all be "
+                 "at least 1\n";
+    return 1;
+  }
+  if (port_in_use()) {
+    std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+              << "Port " << dev_port
+              << " is already in use; stop the other dev server first\n";
+    return 1;
+  }
+
+  generate_corpus(root, options.corpus);
+  std::vector<fs::path> sources;
+  for (const auto &entry :
+       fs::recursive_directory_iterator(root / "content")) {
+    if (entry.is_regular_file() && entry.path().extension() == ".md") {
+      sources.push_back(entry.path());
+    }
+  }
+  // Directory order varies between file systems
+  std::sort(sources.begin(), sources.end());
+
+  std::cout << termcolor::bright_green << "✓ " << termcolor::reset
+            << "Generated " << termcolor::bright_white << options.corpus.pages
+            << termcolor::reset << " pages in " << termcolor::bright_white
+            << root.string() << termcolor::reset << "\n";
+
+  fs::path log_path = root / "forge-dev.log";
+  auto launch_start = Clock::now();
+  ForgeProcess dev(root, {"dev", "--quiet"}, log_path);
+
+  std::optional<uint64_t> version;
+  while (!(version = current_version()) && dev.running() &&
+         Clock::now() - launch_start < std::chrono::seconds(60)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  if (!version) {
+    std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+              << "forge dev did not come up; its output is in "
+              << termcolor::bright_white << log_path.string()
+              << termcolor::reset << "\n";
+    return 1;
+  }
+
+  std::cout << termcolor::bright_green << "✓ " << termcolor::reset
+            << "forge dev ready in "
+            << static_cast<int>(ms_between(launch_start, Clock::now()))
+            << "ms " << termcolor::bright_blue << "(pid " << dev.pid()
+            << ", output in " << log_path.filename().string() << ")"
+            << termcolor::reset << "\n";
+
+  MemorySampler memory(dev.pid());
+
+  net::io_context ioc;
+  auto work = net::make_work_guard(ioc);
+  std::vector<std::thread> io_threads;
+  unsigned io_thread_count =
+      std::clamp(std::thread::hardware_concurrency(), 1u, 4u);
+  for (unsigned i = 0; i < io_thread_count; ++i) {
+    io_threads.emplace_back([&ioc]() { ioc.run(); });
+  }
+
+  Deliveries deliveries(options.clients);
+  std::vector<std::shared_ptr<StressClient>> clients;
+  for (size_t i = 0; i < options.clients; ++i) {
+    clients.push_back(std::make_shared<StressClient>(ioc, i, deliveries));
+    clients.back()->start();
+  }
+
+  auto connect_start = Clock::now();
+  while (deliveries.connected + deliveries.failed < options.clients &&
+         Clock::now() - connect_start < std::chrono::seconds(30)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  std::cout << termcolor::bright_green << "✓ " << termcolor::reset
+            << termcolor::bright_white << deliveries.connected.load()
+            << termcolor::reset << " clients connected in "
+            << static_cast<int>(ms_between(connect_start, Clock::now()))
+            << "ms";
+  if (size_t failed = options.clients - deliveries.connected) {
+    std::cout << termcolor::bright_yellow << " (" << failed << " failed)"
+              << termcolor::reset;
+  }
+  std::cout << "\n\n";
+
+  Results bursts = Results::array();
+  std::vector<double> all_notify_ms;
+  std::vector<double> all_fanout_ms;
+  size_t total_rebuilds = 0;
+  size_t total_failures = 0;
+  size_t total_delivered = 0;
+  size_t total_missed = 0;
+  size_t total_disconnected = 0;
+  size_t unsettled = 0;
+
+  for (size_t burst = 0; burst < options.bursts; ++burst) {
+    uint64_t before = current_version().value_or(0);
+    std::string metrics_before = http_get("/__forge/metrics").value_or("");
+
+    auto write_start = Clock::now();
+    write_burst(sources, burst, options.burst_files);
+    auto written = Clock::now();
+
+    auto settled =
+        wait_for_settle(before, std::chrono::milliseconds(options.settle_ms));
+    std::string metrics_after = http_get("/__forge/metrics").value_or("");
+
+    auto delta = [&](const std::string &name) {
+      return metric(metrics_after, name) - metric(metrics_before, name);
+    };
+    size_t rebuilds = static_cast<size_t>(
+        delta("forge_rebuild_duration_seconds_count"));
+    size_t failures =
+        static_cast<size_t>(delta("forge_rebuild_failures_total"));
+    double broadcasts =
+        delta("forge_websocket_broadcast_latency_seconds_count");
+    double broadcast_mean_ms =
+        broadcasts > 0
+            ? delta("forge_websocket_broadcast_latency_seconds_sum") /
+                  broadcasts * 1000
+            : 0;
+    total_rebuilds += rebuilds;
+    total_failures += failures;
+
+    Results result;
+    result["burst"] = burst + 1;
+    result["files"] = options.burst_files;
+    result["write_ms"] = ms_between(write_start, written);
+    result["rebuilds"] = rebuilds;
+    result["rebuild_failures"] = failures;
+
+    if (!settled) {
+      ++unsettled;
+      result["settled"] = false;
+      bursts.push_back(std::move(result));
+      std::cout << termcolor::bright_yellow << "  ⚠ " << termcolor::reset
+                << "Burst " << (burst + 1) << "/" << options.bursts
+                << ": no rebuild was published within 60s\n";
+      continue;
+    }
+
+    auto [final_version, published] = *settled;
+    std::vector<double> notify_ms;
+    size_t missed = 0;
+    size_t disconnected = 0;
+    size_t messages = 0;
+    Clock::time_point first_arrival = Clock::time_point::max();
+    Clock::time_point last_arrival = Clock::time_point::min();
+    {
+      std::lock_guard<std::mutex> lock(deliveries.mutex);
+      for (size_t c = 0; c < options.clients; ++c) {
+        const auto &received = deliveries.received[c];
+        auto got = std::find_if(received.begin(), received.end(),
+                                [&](const auto &message) {
+                                  return message.first == final_version;
+                                });
+        messages += std::count_if(
+            received.begin(), received.end(),
+            [&](const auto &message) { return message.first > before; });
+
+        if (got != received.end()) {
+          notify_ms.push_back(ms_between(written, got->second));
+          first_arrival = std::min(first_arrival, got->second);
+          last_arrival = std::max(last_arrival, got->second);
+        } else if (deliveries.closed[c]) {
+          ++disconnected;
+        } else {
+          ++missed;
+        }
+      }
+    }
+
+    double fanout_ms =
+        notify_ms.empty() ? 0 : ms_between(first_arrival, last_arrival);
+    size_t rss_kb = resident_kb(dev.pid());
+
+    result["settled"] = true;
+    result["version"] = final_version;
+    result["published_ms"] = ms_between(written, published);
+    result["delivered"] = notify_ms.size();
+    result["missed"] = missed;
+    result["disconnected"] = disconnected;
+    result["messages"] = messages;
+    result["notify_ms"] = {{"p50", percentile(notify_ms, 50)},
+                           {"p99", percentile(notify_ms, 99)},
+                           {"max", percentile(notify_ms, 100)}};
+    result["fanout_ms"] = fanout_ms;
+    result["server_broadcast_mean_ms"] = broadcast_mean_ms;
+    result["rss_kb"] = rss_kb;
+    bursts.push_back(std::move(result));
+
+    total_delivered += notify_ms.size();
+    total_missed += missed;
+    total_disconnected += disconnected;
+    all_notify_ms.insert(all_notify_ms.end(), notify_ms.begin(),
+                         notify_ms.end());
+    all_fanout_ms.push_back(fanout_ms);
+
+    bool complete = missed == 0 && disconnected == 0;
+    std::cout << (complete ? termcolor::bright_green
+                           : termcolor::bright_yellow)
+              << (complete ? "  ✓ " : "  ⚠ ") << termcolor::reset << "Burst "
+              << (burst + 1) << "/" << options.bursts << ": "
+              << options.burst_files << " files → " << rebuilds
+              << (rebuilds == 1 ? " rebuild" : " rebuilds") << ", "
+              << termcolor::bright_white << notify_ms.size() << "/"
+              << options.clients << termcolor::reset << " notified in "
+              << std::format("{:.0f}ms", percentile(notify_ms, 50))
+              << termcolor::bright_blue
+              << std::format(" (p99 {:.0f}ms, fan-out {:.1f}ms, {:.1f} MB)",
+                             percentile(notify_ms, 99), fanout_ms,
+                             rss_kb / 1024.0)
+              << termcolor::reset << "\n";
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(options.pause_ms));
+  }
+
+  for (auto &client : clients) {
+    client->close();
+  }
+  work.reset();
+  ioc.stop();
+  for (auto &thread : io_threads) {
+    thread.join();
+  }
+
+  memory.stop();
+  if (!dev.stop()) {
+    std::cerr << termcolor::bright_yellow << "⚠ " << termcolor::reset
+              << "forge dev did not stop on its own and was killed\n";
+  }
+
+  auto samples = memory.samples();
+  Results memory_series = Results::array();
+  size_t peak_kb = 0;
+  for (const auto &[ms, kb] : samples) {
+    memory_series.push_back({ms, kb});
+    peak_kb = std::max(peak_kb, kb);
+  }
+
+  const CorpusOptions &corpus = options.corpus;
+  Results results;
+  results["label"] = options.label;
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  results["timestamp"] =
+      std::chrono::duration_cast<std::chrono::seconds>(now).count();
+  results["corpus"] = {{"pages", corpus.pages},
+                       {"collections", corpus.collections},
+                       {"template_complexity", corpus.template_complexity},
+                       {"seed", corpus.seed}};
+  results["clients"] = options.clients;
+  results["settle_ms"] = options.settle_ms;
+  results["summary"] = {
+      {"files_written", options.bursts * options.burst_files},
+      {"rebuilds", total_rebuilds},
+      {"rebuild_failures", total_failures},
+      {"expected", options.bursts * options.clients},
+      {"delivered", total_delivered},
+      {"missed", total_missed},
+      {"disconnected", total_disconnected},
+      {"unsettled_bursts", unsettled},
+      {"notify_ms",
+       {{"p50", percentile(all_notify_ms, 50)},
+        {"p99", percentile(all_notify_ms, 99)},
+        {"max", percentile(all_notify_ms, 100)}}},
+      {"fanout_ms",
+       {{"p50", percentile(all_fanout_ms, 50)},
+        {"max", percentile(all_fanout_ms, 100)}}}};
+  results["bursts"] = std::move(bursts);
+  results["memory"] = {
+      {"start_kb", samples.empty() ? 0 : samples.front().second},
+      {"peak_kb", peak_kb},
+      {"end_kb", samples.empty() ? 0 : samples.back().second},
+      {"samples", std::move(memory_series)}};
+
+  if (temporary) {
+    fs::remove_all(root);
+  }
+
+  print_summary(results);
+
+  if (options.json_path.empty()) {
+    std::cout << "\n" << results.dump(2) << "\n";
+  } else {
+    std::ofstream(options.json_path) << results.dump(2) << "\n";
+    std::cout << "\n"
+              << termcolor::bright_green << "✓ " << termcolor::reset
+              << "Results written to " << termcolor::bright_white
+              << options.json_path.string() << termcolor::reset << "\n\n";
+  }
+
+  // Non-zero when a tab would have been left showing a stale page
+  return total_missed + total_disconnected + unsettled > 0 ? 1 : 0;
+}
@@ -0,0 +1,35 @@
+#ifndef STRESS_HPP
+#define STRESS_HPP
+
+#include "corpus.hpp"
+#include <cstddef>
+#include <filesystem>
+#include <string>
+
+struct StressOptions {
+  CorpusOptions corpus;
+  // Live reload connections kept open, like that many browser tabs
+  size_t clients = 100;
+  size_t bursts = 10;
+  // Content files rewritten back to back in each burst
+  size_t burst_files = 200;
+  // A burst is over once the build version has been stable this long
+  int settle_ms = 1500;
+  // Quiet time between bursts
+  int pause_ms = 500;
+  // Where the JSON results go; printed to stdout when empty
+  std::filesystem::path json_path;
+  // Where the project is generated; a temporary directory when empty
+  std::filesystem::path work_dir;
+  // Stored with the results to tell runs apart
+  std::string label;
+};
+
+// `forge stress`: starts `forge dev` on a generated site, connects
+// `clients` live reload WebSockets to it over localhost and rewrites
+// batches of content files, recording rebuilds, notification latency,
+// clients that missed the final reload of a burst and the server's memory
+// over time. Returns the exit status.
+int run_stress(const StressOptions &options);
+
+#endif
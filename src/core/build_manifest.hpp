@@ -0,0 +1,62 @@
+#ifndef BUILD_MANIFEST_HPP
+#define BUILD_MANIFEST_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vendor/nlohmann/json.hpp>
+
+// What the previous `forge build` saw: a fingerprint (mtime and size) of
+// every input file, and the assets each page referenced. An incremental
+// build diffs the fingerprints to find changed inputs and reuses the asset
+// lists of pages it doesn't render again, along with their size before
+// minification for the build report.
+struct BuildManifest {
+  static constexpr int format_version = 2;
+
+  std::unordered_map<std::string, std::string> inputs;
+  std::unordered_map<std::string, std::vector<std::string>> page_assets;
+  std::unordered_map<std::string, size_t> page_rendered_bytes;
+
+  static std::optional<BuildManifest> load(const std::filesystem::path &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+      return std::nullopt;
+    }
+
+    try {
+      nlohmann::json data = nlohmann::json::parse(file);
+      if (data.value("format", 0) != format_version) {
+        return std::nullopt;
+      }
+
+      BuildManifest manifest;
+      data.at("inputs").get_to(manifest.inputs);
+      data.at("pages").get_to(manifest.page_assets);
+      data.at("rendered_bytes").get_to(manifest.page_rendered_bytes);
+      return manifest;
+    } catch (const std::exception &) {
+      // Unreadable manifests just mean a full build
+      return std::nullopt;
+    }
+  }
+
+  void save(const std::filesystem::path &path) const {
+    std::filesystem::create_directories(path.parent_path());
+
+    nlohmann::json data;
+    data["format"] = format_version;
+    data["inputs"] = inputs;
+    data["pages"] = page_assets;
+    data["rendered_bytes"] = page_rendered_bytes;
+
+    std::ofstream file(path);
+    file << data.dump(2);
+  }
+};
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef BUILD_REPORT_HPP
+#define BUILD_REPORT_HPP
+
+#include "utils/config.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <vendor/nlohmann/json.hpp>
+
+// What one `forge build` did and how long it took, for `--report` and the
+// budgets in forge.yaml. Filled in by SiteBuilder as the build runs.
+struct BuildReport {
+  struct PageStats {
+    std::string url;
+    double render_ms = 0;
+    double minify_ms = 0;
+    size_t input_bytes = 0;
+    size_t rendered_bytes = 0;
+    size_t output_bytes = 0;
+    // Left as-is by an incremental build; sizes are from its existing
+    // output and the previous build
+    bool reused = false;
+  };
+
+  // Bytes in and out of minification, per kind of file
+  struct SizeStats {
+    size_t files = 0;
+    size_t input_bytes = 0;
+    size_t output_bytes = 0;
+  };
+
+  struct CacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+  };
+
+  // What loading a page transfers: its HTML plus every static file it
+  // references, directly or through a stylesheet's url()s, counted once
+  struct PageWeight {
+    std::string url;
+    size_t assets = 0;
+    size_t html_bytes = 0;
+    size_t html_gzip_bytes = 0;
+    size_t total_bytes = 0;
+    // As sent to a client that accepts gzip; fonts and images count as-is
+    size_t total_gzip_bytes = 0;
+    // Raw bytes per kind of asset ("css", "js", "font", "image", "other")
+    std::map<std::string, size_t> asset_bytes;
+  };
+
+  // In the order they ran
+  std::vector<std::pair<std::string, double>> phases;
+  double total_ms = 0;
+
+  std::vector<PageStats> pages;
+  std::vector<PageWeight> weights;
+  SizeStats html;
+  SizeStats css;
+  SizeStats js;
+  SizeStats other;
+  // Everything in the output directory, not counting .gz siblings
+  size_t output_bytes = 0;
+
+  CacheStats template_parses;
+  CacheStats template_scans;
+  // Pages an incremental build reused instead of rendering
+  CacheStats incremental_pages;
+
+  void add_phase(std::string name, double ms) {
+    phases.emplace_back(std::move(name), ms);
+  }
+
+  // Budget limits that were exceeded, described for the console
+  std::vector<std::string> over_budget(const BudgetConfig &budgets) const {
+    std::vector<std::string> violations;
+
+    if (budgets.max_build_ms && total_ms > *budgets.max_build_ms) {
+      violations.push_back(std::format("Build took {:.0f}ms (budget {:.0f}ms)",
+                                       total_ms, *budgets.max_build_ms));
+    }
+
+    if (budgets.max_page_kb) {
+      for (const auto &page : pages) {
+        double kb = static_cast<double>(page.output_bytes) / 1024;
+        if (kb > *budgets.max_page_kb) {
+          violations.push_back(std::format("{} is {:.1f} KB (budget {:.1f} KB)",
+                                           page.url, kb,
+                                           *budgets.max_page_kb));
+        }
+      }
+    }
+
+    if (budgets.max_page_weight_kb) {
+      for (const auto &weight : weights) {
+        double kb = static_cast<double>(weight.total_gzip_bytes) / 1024;
+        if (kb > *budgets.max_page_weight_kb) {
+          violations.push_back(std::format(
+              "{} transfers {:.1f} KB with its assets (budget {:.1f} KB)",
+              weight.url, kb, *budgets.max_page_weight_kb));
+        }
+      }
+    }
+
+    if (budgets.max_total_kb) {
+      double kb = static_cast<double>(output_bytes) / 1024;
+      if (kb > *budgets.max_total_kb) {
+        violations.push_back(std::format(
+            "Output is {:.1f} KB (budget {:.1f} KB)", kb,
+            *budgets.max_total_kb));
+      }
+    }
+
+    return violations;
+  }
+
+  // `slowest_count` caps both the slowest and the heaviest page lists
+  nlohmann::ordered_json to_json(size_t slowest_count = 10) const {
+    auto sizes = [](const SizeStats &stats) {
+      return nlohmann::ordered_json{
+          {"files", stats.files},
+          {"input_bytes", stats.input_bytes},
+          {"output_bytes", stats.output_bytes},
+          {"ratio", stats.input_bytes == 0
+                        ? 1.0
+                        : static_cast<double>(stats.output_bytes) /
+                              static_cast<double>(stats.input_bytes)}};
+    };
+    auto cache = [](const CacheStats &stats) {
+      size_t lookups = stats.hits + stats.misses;
+      return nlohmann::ordered_json{
+          {"hits", stats.hits},
+          {"misses", stats.misses},
+          {"hit_rate", lookups == 0 ? 0.0
+                                    : static_cast<double>(stats.hits) /
+                                          static_cast<double>(lookups)}};
+    };
+    auto page_json = [](const PageStats &page) {
+      return nlohmann::ordered_json{{"url", page.url},
+                                    {"render_ms", page.render_ms},
+                                    {"minify_ms", page.minify_ms},
+                                    {"input_bytes", page.input_bytes},
+                                    {"rendered_bytes", page.rendered_bytes},
+                                    {"output_bytes", page.output_bytes},
+                                    {"reused", page.reused}};
+    };
+    auto weight_json = [](const PageWeight &weight) {
+      return nlohmann::ordered_json{
+          {"url", weight.url},
+          {"assets", weight.assets},
+          {"html_bytes", weight.html_bytes},
+          {"html_gzip_bytes", weight.html_gzip_bytes},
+          {"total_bytes", weight.total_bytes},
+          {"total_gzip_bytes", weight.total_gzip_bytes},
+          {"asset_bytes", weight.asset_bytes}};
+    };
+
+    nlohmann::ordered_json report;
+    report["total_ms"] = total_ms;
+
+    nlohmann::ordered_json phase_times = nlohmann::ordered_json::object();
+    for (const auto &[name, ms] : phases) {
+      phase_times[name] = ms;
+    }
+    report["phases"] = std::move(phase_times);
+
+    report["sizes"] = {{"html", sizes(html)},
+                       {"css", sizes(css)},
+                       {"js", sizes(js)},
+                       {"other", sizes(other)},
+                       {"output_bytes", output_bytes}};
+    report["caches"] = {{"template_parses", cache(template_parses)},
+                        {"template_scans", cache(template_scans)},
+                        {"incremental_pages", cache(incremental_pages)}};
+
+    std::vector<const PageStats *> slowest;
+    for (const auto &page : pages) {
+      slowest.push_back(&page);
+    }
+    std::sort(slowest.begin(), slowest.end(),
+              [](const PageStats *a, const PageStats *b) {
+                return a->render_ms + a->minify_ms >
+                       b->render_ms + b->minify_ms;
+              });
+    slowest.resize(std::min(slowest.size(), slowest_count));
+
+    report["slowest_pages"] = nlohmann::ordered_json::array();
+    for (const PageStats *page : slowest) {
+      report["slowest_pages"].push_back(page_json(*page));
+    }
+
+    std::vector<const PageWeight *> heaviest;
+    for (const auto &weight : weights) {
+      heaviest.push_back(&weight);
+    }
+    std::sort(heaviest.begin(), heaviest.end(),
+              [](const PageWeight *a, const PageWeight *b) {
+                return a->total_gzip_bytes > b->total_gzip_bytes;
+              });
+    heaviest.resize(std::min(heaviest.size(), slowest_count));
+
+    report["heaviest_pages"] = nlohmann::ordered_json::array();
+    for (const PageWeight *weight : heaviest) {
+      report["heaviest_pages"].push_back(weight_json(*weight));
+    }
+
+    report["pages"] = nlohmann::ordered_json::array();
+    for (const auto &page : pages) {
+      report["pages"].push_back(page_json(page));
+    }
+
+    report["page_weights"] = nlohmann::ordered_json::array();
+    for (const auto &weight : weights) {
+      report["page_weights"].push_back(weight_json(weight));
+    }
+
+    return report;
+  }
+
+  bool save(const std::filesystem::path &path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+      return false;
+    }
+    file << to_json().dump(2) << "\n";
+    return static_cast<bool>(file);
+  }
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "dependency_graph.hpp"
+#include <algorithm>
+
+void DependencyGraph::set(const std::string &url, PageDeps deps) {
+  remove(url);
+
+  for (const auto &file : deps.files) {
+    by_file_[file].insert(url);
+  }
+  for (const auto &name : deps.collections) {
+    by_collection_[name].insert(url);
+  }
+
+  pages_[url] = std::move(deps);
+}
+
+void DependencyGraph::remove(const std::string &url) {
+  auto it = pages_.find(url);
+  if (it == pages_.end()) {
+    return;
+  }
+
+  for (const auto &file : it->second.files) {
+    unlink(by_file_, file, url);
+  }
+  for (const auto &name : it->second.collections) {
+    unlink(by_collection_, name, url);
+  }
+
+  pages_.erase(it);
+}
+
+void DependencyGraph::clear() {
+  pages_.clear();
+  by_file_.clear();
+  by_collection_.clear();
+}
+
+const DependencyGraph::PageDeps *
+DependencyGraph::find(const std::string &url) const {
+  auto it = pages_.find(url);
+  return it != pages_.end() ? &it->second : nullptr;
+}
+
+std::unordered_set<std::string>
+DependencyGraph::pages_using_file(const std::string &file) const {
+  auto it = by_file_.find(file);
+  return it != by_file_.end() ? it->second : std::unordered_set<std::string>{};
+}
+
+std::unordered_set<std::string>
+DependencyGraph::pages_using_collection(const std::string &name) const {
+  std::unordered_set<std::string> urls;
+
+  if (auto it = by_collection_.find(name); it != by_collection_.end()) {
+    urls = it->second;
+  }
+  if (auto it = by_collection_.find(all_collections);
+      it != by_collection_.end()) {
+    urls.insert(it->second.begin(), it->second.end());
+  }
+
+  return urls;
+}
+
+std::unordered_set<std::string>
+DependencyGraph::pages_reading(const std::string &collection,
+                               const std::vector<std::string> &changed) const {
+  std::unordered_set<std::string> urls;
+
+  for (const auto &url : pages_using_collection(collection)) {
+    const PageDeps &deps = pages_.at(url);
+    bool reads_change = std::any_of(
+        deps.reads.begin(), deps.reads.end(), [&](const std::string &read) {
+          return std::any_of(changed.begin(), changed.end(),
+                             [&](const std::string &path) {
+                               return paths_overlap(read, path);
+                             });
+        });
+    if (reads_change) {
+      urls.insert(url);
+    }
+  }
+
+  return urls;
+}
+
+std::vector<std::string_view>
+DependencyGraph::path_segments(std::string_view path) {
+  std::vector<std::string_view> segments;
+
+  while (!path.empty()) {
+    if (path.front() == '.') {
+      path.remove_prefix(1);
+      continue;
+    }
+
+    size_t end;
+    if (path.front() == '[') {
+      end = path.find(']');
+      end = end == std::string_view::npos ? path.size() : end + 1;
+    } else {
+      end = std::min(path.find_first_of(".["), path.size());
+    }
+
+    segments.push_back(path.substr(0, end));
+    path.remove_prefix(end);
+  }
+
+  return segments;
+}
+
+bool DependencyGraph::paths_overlap(std::string_view a, std::string_view b) {
+  auto lhs = path_segments(a);
+  auto rhs = path_segments(b);
+
+  for (size_t i = 0; i < std::min(lhs.size(), rhs.size()); ++i) {
+    // "*" matches a key, but not the element markers
+    bool wildcard = (lhs[i] == "*" && !rhs[i].starts_with('[')) ||
+                    (rhs[i] == "*" && !lhs[i].starts_with('['));
+    if (lhs[i] != rhs[i] && !wildcard) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void DependencyGraph::unlink(Index &index, const std::string &key,
+                             const std::string &url) {
+  auto it = index.find(key);
+  if (it == index.end()) {
+    return;
+  }
+  it->second.erase(url);
+  if (it->second.empty()) {
+    index.erase(it);
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef DEPENDENCY_GRAPH_HPP
+#define DEPENDENCY_GRAPH_HPP
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Which inputs each page was built from, with reverse indexes to answer
+// "which pages does this file affect". Files are project-relative paths
+// (content file, templates and partials, forge.yaml); collections are the
+// names a page's templates read, with "*" for templates that iterate all
+// of them.
+//
+// Reads narrow that down to the context paths the templates touch, such as
+// `collections.blog[*].title` (a field of every element), `collections.blog[#]`
+// (which elements there are, and their order) or `site.social_links`. A
+// path covers everything below it; "*" stands for any key and "" for the
+// whole context.
+class DependencyGraph {
+public:
+  struct PageDeps {
+    std::vector<std::string> files;
+    std::vector<std::string> collections;
+    std::vector<std::string> reads;
+  };
+
+  static constexpr const char *all_collections = "*";
+
+  void set(const std::string &url, PageDeps deps);
+  void remove(const std::string &url);
+  void clear();
+
+  const PageDeps *find(const std::string &url) const;
+
+  std::unordered_set<std::string>
+  pages_using_file(const std::string &file) const;
+  // Includes pages that read every collection
+  std::unordered_set<std::string>
+  pages_using_collection(const std::string &name) const;
+  // Pages using `collection` that read any of the `changed` paths
+  std::unordered_set<std::string>
+  pages_reading(const std::string &collection,
+                const std::vector<std::string> &changed) const;
+
+  // "collections.blog[*].title" -> collections, blog, [*], title
+  static std::vector<std::string_view> path_segments(std::string_view path);
+  // True if one path lies within the other
+  static bool paths_overlap(std::string_view a, std::string_view b);
+
+  size_t size() const { return pages_.size(); }
+
+private:
+  using Index =
+      std::unordered_map<std::string, std::unordered_set<std::string>>;
+
+  static void unlink(Index &index, const std::string &key,
+                     const std::string &url);
+
+  std::unordered_map<std::string, PageDeps> pages_;
+  Index by_file_;
+  Index by_collection_;
+};
+
+#endif
@@ -1,9 +1,14 @@
 #include "site_builder.hpp"
 #include "markdown.hpp"
+#include "template_analysis.hpp"
 #include "template_engine.hpp"
 #include "utils/build_info.hpp"
+#include "utils/compression.hpp"
+#include "utils/log.hpp"
+#include "utils/trace.hpp"
 #include "vendor/termcolor.hpp"
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
@@ -12,10 +17,18 @@
 #include <mutex>
 #include <print>
 #include <regex>
-#include <shared_mutex>
+#include <set>
 #include <sstream>
+#include <thread>
 #include <unordered_set>
 
+// Milliseconds since `start`, for the build report
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
 std::string escape_regex(const std::string &str) {
   static const std::regex special_chars{R"([-[\]{}()*+?.,\^$|#\s])"};
   return std::regex_replace(str, special_chars, R"(\$&)");
@@ -38,6 +51,8 @@ SiteBuilder::SiteBuilder(const fs::path &root) : project_root(root) {
     std::cerr << termcolor::yellow << "⚠ Warning: " << termcolor::reset
               << "base.html not found\n";
   }
+
+  snapshot_.store(std::make_shared<const SiteSnapshot>());
 }
 
 void SiteBuilder::initialize_minification() {
@@ -62,6 +77,7 @@ std::string SiteBuilder::minify_css_content(const std::string &css) {
     return css;
   }
 
+  FORGE_TRACE_SCOPE("minify_css");
   auto result = js_minifier->minifyCSS(css);
   return result.value_or(css);
 }
@@ -71,6 +87,7 @@ std::string SiteBuilder::minify_js_content(const std::string &js) {
     return js;
   }
 
+  FORGE_TRACE_SCOPE("minify_js");
   auto result = js_minifier->minifyJS(js);
   return result.value_or(js);
 }
@@ -80,6 +97,7 @@ std::string SiteBuilder::minify_html_content(const std::string &html) {
     return html;
   }
 
+  FORGE_TRACE_SCOPE("minify_html");
   auto result = js_minifier->minifyHTML(html);
   return result.value_or(html);
 }
@@ -95,6 +113,7 @@ std::string SiteBuilder::read_file(const fs::path &path) {
 }
 
 void SiteBuilder::write_file(const fs::path &path, const std::string &content) {
+  FORGE_TRACE_SCOPE("write_file", path);
   if (path.has_parent_path()) {
     fs::create_directories(path.parent_path());
   }
@@ -105,6 +124,11 @@ void SiteBuilder::write_file(const fs::path &path, const std::string &content) {
   file << content;
 }
 
+TemplateEngine &SiteBuilder::template_engine() {
+  static thread_local TemplateEngine engine;
+  return engine;
+}
+
 std::string SiteBuilder::inject_dev_scripts(const std::string &html) {
   std::string dev_script = R"(
 <script defer src="/livereload.js"></script>
@@ -119,20 +143,23 @@ std::string SiteBuilder::inject_dev_scripts(const std::string &html) {
   }
 }
 
-void SiteBuilder::trackAssets(const std::string &source) {
+std::vector<std::string> SiteBuilder::trackAssets(const std::string &source) {
   std::regex assetPattern(
       R"((src|href)=["']([^"']+)["']|url\(["']?([^)']+)["']?\))");
 
+  std::vector<std::string> found;
   std::smatch match;
   auto searchStart = source.cbegin();
   while (std::regex_search(searchStart, source.cend(), match, assetPattern)) {
     std::string path = match[2].matched ? match[2].str() : match[3].str();
 
     if (isStaticAsset(path)) {
-      referencedAssets.insert(normalizeAssetPath(path));
+      found.push_back(normalizeAssetPath(path));
+      referencedAssets.insert(found.back());
     }
     searchStart = match.suffix().first;
   }
+  return found;
 }
 
 void SiteBuilder::trackAssetsInCss(const std::string &source,
@@ -140,6 +167,9 @@ void SiteBuilder::trackAssetsInCss(const std::string &source,
   std::regex urlPattern(R"(url\(["']?([^)']+)["']?\))");
   std::smatch match;
 
+  auto &children = css_assets_[css_relative_path];
+  children.clear();
+
   auto searchStart = source.cbegin();
   while (std::regex_search(searchStart, source.cend(), match, urlPattern)) {
     std::string url = match[1].str();
@@ -165,6 +195,7 @@ void SiteBuilder::trackAssetsInCss(const std::string &source,
 
     if (isStaticAsset(normalizedPath)) {
       referencedAssets.insert(normalizedPath);
+      children.push_back(normalizedPath);
     }
 
     searchStart = match.suffix().first;
@@ -222,17 +253,16 @@ void SiteBuilder::report_unused_assets() {
 
 void SiteBuilder::log_processed_file(const fs::path &relative,
                                      const std::string &note) {
-  std::cout << termcolor::bright_green << "  ✓ " << termcolor::reset
-            << termcolor::white << relative.string();
-
-  if (!note.empty()) {
-    std::cout << termcolor::bright_blue << " (" << note << ")";
-  }
-
-  std::cout << termcolor::reset << "\n";
+  Log::instance().file(relative.string(), note);
 }
 
 void SiteBuilder::process_static_files() {
+  FORGE_TRACE_SCOPE("process_static_files");
+  auto record_sizes = [](BuildReport::SizeStats &stats, size_t in, size_t out) {
+    stats.files++;
+    stats.input_bytes += in;
+    stats.output_bytes += out;
+  };
   auto static_start = std::chrono::high_resolution_clock::now();
 
   std::cout << "\n"
@@ -244,10 +274,18 @@ void SiteBuilder::process_static_files() {
 
   int css_count = 0, js_count = 0, html_count = 0, other_count = 0, skipped = 0;
 
+  // Stylesheets go first: the fonts and images their url()s reference are
+  // only known to be used once they have been scanned
+  std::vector<fs::directory_entry> entries;
   for (const auto &entry : fs::recursive_directory_iterator(static_dir)) {
-    if (!entry.is_regular_file())
-      continue;
+    if (entry.is_regular_file())
+      entries.push_back(entry);
+  }
+  std::stable_partition(entries.begin(), entries.end(), [](const auto &entry) {
+    return entry.path().extension() == ".css";
+  });
 
+  for (const auto &entry : entries) {
     fs::path relative = fs::relative(entry.path(), static_dir);
     fs::path relativePath = fs::relative(entry.path(), project_root);
     fs::path out_path = static_out / relative;
@@ -265,7 +303,9 @@ void SiteBuilder::process_static_files() {
     }
     // DO NOT minify already minified files
     if (entry.path().filename().string().find(".min.") != std::string::npos) {
-      write_file(out_path, read_file(entry.path()));
+      std::string content = read_file(entry.path());
+      write_file(out_path, content);
+      record_sizes(report_.other, content.size(), content.size());
       other_count++;
       log_processed_file(relative, "copied (minified)");
       continue;
@@ -283,6 +323,7 @@ void SiteBuilder::process_static_files() {
       std::string minified = minify_css_content(css_content);
       trackAssetsInCss(minified, relativePath.string());
       write_file(out_path, minified);
+      record_sizes(report_.css, css_content.size(), minified.size());
       css_count++;
       log_processed_file(relative, "minified");
 
@@ -290,6 +331,7 @@ void SiteBuilder::process_static_files() {
       std::string js_content = read_file(entry.path());
       std::string minified = minify_js_content(js_content);
       write_file(out_path, minified);
+      record_sizes(report_.js, js_content.size(), minified.size());
       js_count++;
       log_processed_file(relative, "minified");
 
@@ -297,17 +339,21 @@ void SiteBuilder::process_static_files() {
       std::string html_content = read_file(entry.path());
       std::string minified = minify_html_content(html_content);
       write_file(out_path, minified);
+      record_sizes(report_.html, html_content.size(), minified.size());
       html_count++;
       log_processed_file(relative, "minified");
 
     } else {
       fs::copy_file(entry.path(), out_path,
                     fs::copy_options::overwrite_existing);
+      size_t size = entry.file_size();
+      record_sizes(report_.other, size, size);
       other_count++;
       log_processed_file(relative, "");
     }
   }
 
+  Log::instance().flush();
   auto static_end = std::chrono::high_resolution_clock::now();
   auto static_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
       static_end - static_start);
@@ -328,6 +374,224 @@ void SiteBuilder::process_static_files() {
             << "ms" << termcolor::reset << "\n";
 }
 
+// Removes the .gz sibling of `file` left by an earlier build, so servers
+// that prefer it don't send stale content
+static void remove_gzip_sibling(const fs::path &file) {
+  fs::path gz_path = file;
+  gz_path += ".gz";
+  std::error_code ec;
+  fs::remove(gz_path, ec);
+}
+
+void SiteBuilder::precompress_output() {
+  FORGE_TRACE_SCOPE("precompress_output");
+  auto gzip_start = std::chrono::high_resolution_clock::now();
+
+  // Incremental builds keep dist, so files that no longer get a variant
+  // (too small now, or precompression turned off) lose their old one
+  std::vector<fs::path> candidates;
+  std::vector<fs::path> uncompressed;
+  for (const auto &entry : fs::recursive_directory_iterator(output_dir)) {
+    if (!entry.is_regular_file() || !is_compressible(entry.path())) {
+      continue;
+    }
+    if (config.precompress.gzip &&
+        entry.file_size() >= config.precompress.min_size) {
+      candidates.push_back(entry.path());
+    } else {
+      uncompressed.push_back(entry.path());
+    }
+  }
+  for (const auto &file : uncompressed) {
+    remove_gzip_sibling(file);
+  }
+
+  if (candidates.empty())
+    return;
+
+  std::cout << "\n"
+            << termcolor::bright_cyan << "🗜  Precompressing output"
+            << termcolor::reset << "\n";
+
+  std::atomic<size_t> next{0};
+  std::atomic<size_t> written{0};
+  std::atomic<size_t> raw_bytes{0};
+  std::atomic<size_t> gzip_bytes{0};
+  // Reported once the workers are done; an exception must not escape one
+  std::mutex failures_mutex;
+  std::vector<std::pair<fs::path, std::string>> failures;
+
+  auto worker = [&]() {
+    for (size_t i = next++; i < candidates.size(); i = next++) {
+      FORGE_TRACE_SCOPE("gzip", candidates[i]);
+      try {
+        std::string content = read_file(candidates[i]);
+        std::string compressed = gzip_compress(content, 9);
+
+        // Not worth a sibling if gzip barely helps
+        if (compressed.size() >= content.size()) {
+          remove_gzip_sibling(candidates[i]);
+          continue;
+        }
+
+        fs::path gz_path = candidates[i];
+        gz_path += ".gz";
+        write_file(gz_path, compressed);
+
+        written++;
+        raw_bytes += content.size();
+        gzip_bytes += compressed.size();
+      } catch (const std::exception &e) {
+        // A stale or partly written variant would be served instead
+        remove_gzip_sibling(candidates[i]);
+        std::lock_guard<std::mutex> lock(failures_mutex);
+        failures.emplace_back(candidates[i], e.what());
+      }
+    }
+  };
+
+  size_t thread_count = std::min<size_t>(
+      candidates.size(), std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < thread_count; ++i) {
+    workers.emplace_back(worker);
+  }
+  for (auto &t : workers) {
+    t.join();
+  }
+
+  auto gzip_end = std::chrono::high_resolution_clock::now();
+  auto gzip_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      gzip_end - gzip_start);
+
+  for (const auto &[file, error] : failures) {
+    std::cerr << termcolor::bright_red << "  ✗ " << termcolor::reset
+              << termcolor::white << relative_path(file) << termcolor::reset
+              << termcolor::bright_blue << ": " << error << termcolor::reset
+              << "\n";
+  }
+
+  std::cout << termcolor::bright_green << "✓ " << termcolor::reset
+            << "Wrote gzip variants for " << written << " files ("
+            << raw_bytes / 1024 << " KB → " << gzip_bytes / 1024 << " KB)";
+  if (!failures.empty()) {
+    std::cout << termcolor::bright_red << " (" << failures.size()
+              << " errors)" << termcolor::reset;
+  }
+  std::cout << termcolor::bright_blue << " in " << gzip_duration.count()
+            << "ms" << termcolor::reset << "\n";
+}
+
+void SiteBuilder::measure_page_weights() {
+  FORGE_TRACE_SCOPE("measure_page_weights");
+  struct Size {
+    size_t raw = 0;
+    size_t gzip = 0;
+  };
+
+  auto measure = [this](const fs::path &file) {
+    Size size;
+    if (!fs::is_regular_file(file)) {
+      return size;
+    }
+    size.raw = size.gzip = fs::file_size(file);
+    if (!is_compressible(file)) {
+      return size;
+    }
+
+    fs::path gz_path = file;
+    gz_path += ".gz";
+    if (fs::is_regular_file(gz_path)) {
+      size.gzip = fs::file_size(gz_path);
+    } else {
+      size.gzip = std::min(size.raw, gzip_compress(read_file(file)).size());
+    }
+    return size;
+  };
+
+  auto kind = [](const std::string &asset) -> const char * {
+    static const std::unordered_map<std::string, const char *> kinds = {
+        {".css", "css"},    {".js", "js"},      {".mjs", "js"},
+        {".woff", "font"},  {".woff2", "font"}, {".ttf", "font"},
+        {".otf", "font"},   {".eot", "font"},   {".png", "image"},
+        {".jpg", "image"},  {".jpeg", "image"}, {".gif", "image"},
+        {".webp", "image"}, {".avif", "image"}, {".svg", "image"},
+        {".ico", "image"}};
+    auto it = kinds.find(fs::path(asset).extension().string());
+    return it == kinds.end() ? "other" : it->second;
+  };
+
+  // Assets are shared by most pages, so each is measured once
+  std::string static_prefix = relative_path(static_dir);
+  std::unordered_map<std::string, Size> asset_sizes;
+  auto asset_size = [&](const std::string &asset) -> const Size & {
+    auto it = asset_sizes.find(asset);
+    if (it == asset_sizes.end()) {
+      fs::path out = output_dir / "static" /
+                     fs::path(asset).lexically_relative(static_prefix);
+      it = asset_sizes.emplace(asset, measure(out)).first;
+    }
+    return it->second;
+  };
+
+  report_.weights.clear();
+  for (const auto &[url, assets] : page_assets) {
+    BuildReport::PageWeight weight;
+    weight.url = url;
+
+    Size html = measure(output_path(url));
+    weight.html_bytes = weight.total_bytes = html.raw;
+    weight.html_gzip_bytes = weight.total_gzip_bytes = html.gzip;
+
+    // Page references also include links to other pages; only files from
+    // the static folder count, each once however often it's reached
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> pending(assets.begin(), assets.end());
+    while (!pending.empty()) {
+      std::string asset = std::move(pending.back());
+      pending.pop_back();
+      if (!availableAssets.count(asset) || !seen.insert(asset).second) {
+        continue;
+      }
+
+      const Size &size = asset_size(asset);
+      weight.assets++;
+      weight.total_bytes += size.raw;
+      weight.total_gzip_bytes += size.gzip;
+      weight.asset_bytes[kind(asset)] += size.raw;
+
+      auto children = css_assets_.find(asset);
+      if (children != css_assets_.end()) {
+        pending.insert(pending.end(), children->second.begin(),
+                       children->second.end());
+      }
+    }
+
+    report_.weights.push_back(std::move(weight));
+  }
+
+  std::sort(report_.weights.begin(), report_.weights.end(),
+            [](const auto &a, const auto &b) {
+              return a.total_gzip_bytes > b.total_gzip_bytes;
+            });
+  if (report_.weights.empty()) {
+    return;
+  }
+
+  std::cout << "\n"
+            << termcolor::bright_cyan << "⚖️  Heaviest pages"
+            << termcolor::reset << "\n";
+  size_t shown = std::min<size_t>(report_.weights.size(), 5);
+  for (size_t i = 0; i < shown; ++i) {
+    const auto &weight = report_.weights[i];
+    std::cout << termcolor::bright_cyan << "  • " << termcolor::reset
+              << termcolor::white << weight.url << termcolor::bright_blue
+              << " " << weight.total_gzip_bytes / 1024 << " KB gzipped, "
+              << weight.total_bytes / 1024 << " KB raw, " << weight.assets
+              << " assets" << termcolor::reset << "\n";
+  }
+}
+
 void SiteBuilder::print_build_summary(
     const std::chrono::high_resolution_clock::time_point &start) {
   auto end = std::chrono::high_resolution_clock::now();
@@ -351,227 +615,825 @@ void SiteBuilder::print_build_summary(
             << termcolor::reset << "\n";
   std::cout << termcolor::bright_green << "║  " << termcolor::reset
             << "Pages:  " << termcolor::bright_white << std::setw(32)
-            << std::left << std::to_string(pages.size()) << termcolor::reset
-            << termcolor::bright_green << "║" << termcolor::reset << "\n";
+            << std::left << std::to_string(snapshot()->pages.size())
+            << termcolor::reset << termcolor::bright_green << "║"
+            << termcolor::reset << "\n";
   std::cout << termcolor::bright_green
             << "╚═══════════════════════════════════════════╝"
             << termcolor::reset << "\n\n";
 }
 
-void SiteBuilder::discover_content() {
-  // auto start = std::chrono::high_resolution_clock::now();
+static bool is_within(const fs::path &path, const fs::path &dir) {
+  fs::path relative = path.lexically_relative(dir);
+  return !relative.empty() && *relative.begin() != "..";
+}
+
+// Strict ordering of a configured collection by its sort key
+static auto collection_order(const CollectionConfig &col) {
+  return [sort_by = col.sort_by, descending = (col.sort_order == "desc")](
+             const PageInfo *a, const PageInfo *b) {
+    std::string a_val = a->frontmatter.get(sort_by, "");
+    std::string b_val = b->frontmatter.get(sort_by, "");
+
+    if (descending) {
+      return a_val > b_val;
+    } else {
+      return a_val < b_val;
+    }
+  };
+}
+
+std::shared_ptr<const PageInfo> SiteBuilder::load_page(const fs::path &path) {
+  std::string ext = path.extension().string();
+  if (ext != ".md" && ext != ".html") {
+    return nullptr;
+  }
 
-  std::unique_lock<std::shared_mutex> lock(pages_mutex_);
+  fs::path relative = fs::relative(path, content_dir);
 
-  pages.clear();
-  collections.clear();
+  std::string content_type = "page";
+  std::string url_path;
+
+  auto it = relative.begin();
+  if (it != relative.end()) {
+    std::string first_folder = it->string();
+    content_type = first_folder;
+    ++it;
+
+    if (first_folder == "pages") {
+      fs::path rest_path;
+      while (it != relative.end()) {
+        rest_path /= *it;
+        ++it;
+      }
+
+      if (rest_path.stem() == "index") {
+        url_path = "/";
+      } else {
+        url_path = "/" + rest_path.stem().string();
+      }
+    } else {
+      url_path = "/" + first_folder;
+
+      fs::path rest_path;
+      while (it != relative.end()) {
+        rest_path /= *it;
+        ++it;
+      }
+
+      if (!rest_path.empty() && rest_path.stem() != "index") {
+        url_path += "/" + rest_path.stem().string();
+      }
+    }
+  }
+
+  FORGE_TRACE_SCOPE("load_page", path);
+  std::string raw_content = read_file(path);
+  FrontMatter fm;
+  std::string html_content;
+  bool is_standalone = false;
+
+  if (ext == ".md") {
+    auto [parsed_fm, markdown_body] = FrontMatter::parse(raw_content);
+    fm = parsed_fm;
+    html_content = MarkdownProcessor::to_html(markdown_body);
+  } else if (ext == ".html") {
+    if (raw_content.find("---") == 0) {
+      auto [parsed_fm, html_body] = FrontMatter::parse(raw_content);
+      fm = parsed_fm;
+      html_content = html_body;
+
+      if (html_body.find("<!DOCTYPE") != std::string::npos ||
+          html_body.find("<html") != std::string::npos) {
+        is_standalone = true;
+      }
+    } else {
+      html_content = raw_content;
+
+      if (raw_content.find("<!DOCTYPE") != std::string::npos ||
+          raw_content.find("<html") != std::string::npos) {
+        is_standalone = true;
+      }
+    }
+  }
+
+  fs::path template_path;
+  bool has_content_template = false;
+
+  if (!is_standalone) {
+
+    auto col_config = config.collections.find(content_type);
+
+    if (col_config != config.collections.end() &&
+        !col_config->second.template_name.empty()) {
+
+      template_path = templates_dir / col_config->second.template_name;
+
+      if (fs::exists(template_path) &&
+          template_path.filename() != "base.html") {
+        has_content_template = true;
+      } else {
+        std::cerr << termcolor::yellow << "⚠ Warning: " << termcolor::reset
+                  << "Template '" << col_config->second.template_name
+                  << "' not found for collection '" << content_type << "'\n";
+      }
+    } else {
+
+      template_path = templates_dir / (content_type + ".html");
+
+      if (fs::exists(template_path) &&
+          template_path.filename() != "base.html") {
+        has_content_template = true;
+      }
+    }
+  }
+
+  PageInfo page;
+  page.content_path = path;
+  page.template_path = has_content_template ? template_path : fs::path();
+  page.url = url_path;
+  page.content_type = content_type;
+  page.frontmatter = fm;
+  page.html_content = html_content;
+  page.needs_template = !is_standalone;
+
+  if (page.url == "404") {
+    has_error_page = true;
+  }
+
+  return std::make_shared<const PageInfo>(std::move(page));
+}
+
+void SiteBuilder::discover_content() {
+  FORGE_TRACE_SCOPE("discover_content");
+  auto start = std::chrono::steady_clock::now();
+  report_ = BuildReport();
+
+  // Built privately and published in one store at the end, so requests keep
+  // being served from the previous snapshot while this one is assembled.
+  auto next = std::make_shared<SiteSnapshot>();
+  next->version = BuildInfo::getInstance().getVersion();
+  next->base_template = base_template;
+  next->site_data = std::make_shared<const nlohmann::json>(
+      TemplateEngine::yaml_to_json(config.get_custom_data()));
+
+  dependency_graph_.clear();
+  template_scans_.clear();
+  parsed_templates_.clear();
 
   if (!fs::exists(content_dir)) {
     std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
               << "Content directory not found: " << termcolor::bright_white
               << content_dir << termcolor::reset << "\n";
+    snapshot_.store(std::move(next));
+    report_.total_ms = elapsed_ms(start);
+    report_.add_phase("discover", report_.total_ms);
     return;
   }
 
   for (const auto &entry : fs::recursive_directory_iterator(content_dir)) {
-    std::string ext = entry.path().extension().string();
+    if (!entry.is_regular_file()) {
+      continue;
+    }
 
-    if (!entry.is_regular_file() || (ext != ".md" && ext != ".html")) {
+    auto page = load_page(entry.path().lexically_normal());
+    if (!page) {
       continue;
     }
 
-    fs::path relative = fs::relative(entry.path(), content_dir);
+    next->urls_by_path[page->content_path.string()] = page->url;
+    next->page_data[page->url] = std::make_shared<const nlohmann::json>(
+        TemplateEngine::serialize_page(page.get()));
+    track_page(*next, *page);
+    next->pages[page->url] = std::move(page);
+  }
 
-    std::string content_type = "page";
-    std::string url_path;
+  build_collections(*next);
+  serialize_collections(*next);
+  snapshot_.store(std::move(next));
 
-    auto it = relative.begin();
-    if (it != relative.end()) {
-      std::string first_folder = it->string();
-      content_type = first_folder;
-      ++it;
+  report_.total_ms = elapsed_ms(start);
+  report_.add_phase("discover", report_.total_ms);
+}
 
-      if (first_folder == "pages") {
-        fs::path rest_path;
-        while (it != relative.end()) {
-          rest_path /= *it;
-          ++it;
-        }
+void SiteBuilder::build_collections(SiteSnapshot &site) const {
+  FORGE_TRACE_SCOPE("build_collections");
+  site.collections.clear();
 
-        if (rest_path.stem() == "index") {
-          url_path = "/";
-        } else {
-          url_path = "/" + rest_path.stem().string();
-        }
-      } else {
-        url_path = "/" + first_folder;
+  for (const auto &[url, page] : site.pages) {
 
-        fs::path rest_path;
-        while (it != relative.end()) {
-          rest_path /= *it;
-          ++it;
-        }
+    if (page->content_type == "pages")
+      continue;
 
-        if (!rest_path.empty() && rest_path.stem() != "index") {
-          url_path += "/" + rest_path.stem().string();
-        }
-      }
+    site.collections[page->content_type].push_back(page.get());
+  }
+
+  for (auto &[name, items] : site.collections) {
+    auto col_config = config.collections.find(name);
+    if (col_config != config.collections.end()) {
+      std::sort(items.begin(), items.end(),
+                collection_order(col_config->second));
     }
+  }
+}
 
-    std::string raw_content = read_file(entry.path());
-    FrontMatter fm;
-    std::string html_content;
-    bool is_standalone = false;
+// A page's template data minus its body, for templates that don't read it
+static nlohmann::json without_html_content(const nlohmann::json &page_json) {
+  nlohmann::json trimmed = nlohmann::json::object();
+  for (const auto &[key, value] : page_json.items()) {
+    if (key != "html_content") {
+      trimmed[key] = value;
+    }
+  }
+  return trimmed;
+}
 
-    if (ext == ".md") {
-      auto [parsed_fm, markdown_body] = FrontMatter::parse(raw_content);
-      fm = parsed_fm;
-      html_content = MarkdownProcessor::to_html(markdown_body);
-    } else if (ext == ".html") {
-      if (raw_content.find("---") == 0) {
-        auto [parsed_fm, html_body] = FrontMatter::parse(raw_content);
-        fm = parsed_fm;
-        html_content = html_body;
-
-        if (html_body.find("<!DOCTYPE") != std::string::npos ||
-            html_body.find("<html") != std::string::npos) {
-          is_standalone = true;
-        }
-      } else {
-        html_content = raw_content;
+void SiteBuilder::serialize_collections(SiteSnapshot &site) {
+  FORGE_TRACE_SCOPE("serialize_collections");
+  std::erase_if(site.collection_data, [&site](const auto &entry) {
+    return !site.collections.contains(entry.first);
+  });
+
+  for (const auto &[name, items] : site.collections) {
+    std::vector<SiteSnapshot::JsonPtr> sources;
+    sources.reserve(items.size());
+    for (const PageInfo *item : items) {
+      sources.push_back(site.page_data.at(item->url));
+    }
 
-        if (raw_content.find("<!DOCTYPE") != std::string::npos ||
-            raw_content.find("<html") != std::string::npos) {
-          is_standalone = true;
-        }
+    auto &data = site.collection_data[name];
+    if (data.full && data.sources == sources) {
+      continue;
+    }
+
+    auto full = nlohmann::json::array();
+    auto trimmed = nlohmann::json::array();
+    for (const auto &source : sources) {
+      full.push_back(*source);
+      trimmed.push_back(without_html_content(*source));
+    }
+    data.full = std::make_shared<const nlohmann::json>(std::move(full));
+    data.trimmed = std::make_shared<const nlohmann::json>(std::move(trimmed));
+    data.sources = std::move(sources);
+  }
+}
+
+void SiteBuilder::remove_page(SiteSnapshot &site, const PageInfo &page) {
+  site.urls_by_path.erase(page.content_path.string());
+
+  auto it = site.pages.find(page.url);
+  if (it == site.pages.end() || it->second.get() != &page) {
+    // The URL has since been claimed by another file
+    return;
+  }
+
+  if (page.content_type != "pages") {
+    auto col = site.collections.find(page.content_type);
+    if (col != site.collections.end()) {
+      auto &items = col->second;
+      items.erase(std::remove(items.begin(), items.end(), &page), items.end());
+      if (items.empty()) {
+        site.collections.erase(col);
       }
     }
+  }
+
+  dependency_graph_.remove(page.url);
+  site.page_data.erase(page.url);
+  site.demands.erase(page.url);
+  site.pages.erase(it);
+}
+
+void SiteBuilder::insert_page(SiteSnapshot &site,
+                              std::shared_ptr<const PageInfo> page) {
+  // Two files can map to the same URL; the newer one wins, as in a full scan
+  if (const PageInfo *existing = site.find(page->url)) {
+    auto keep_alive = site.pages.at(page->url);
+    remove_page(site, *existing);
+  }
+
+  site.urls_by_path[page->content_path.string()] = page->url;
+  site.page_data[page->url] = std::make_shared<const nlohmann::json>(
+      TemplateEngine::serialize_page(page.get()));
+
+  if (page->content_type != "pages") {
+    auto &items = site.collections[page->content_type];
+    auto col_config = config.collections.find(page->content_type);
+    if (col_config != config.collections.end()) {
+      // Already sorted, so the new page only needs its slot found
+      auto order = collection_order(col_config->second);
+      items.insert(std::upper_bound(items.begin(), items.end(), page.get(),
+                                    order),
+                   page.get());
+    } else {
+      items.push_back(page.get());
+    }
+  }
 
-    fs::path template_path;
-    bool has_content_template = false;
+  track_page(site, *page);
+  site.pages[page->url] = std::move(page);
+}
 
-    if (!is_standalone) {
+ContentUpdate SiteBuilder::update_content(const ChangeSet &changes) {
+  ContentUpdate result;
 
-      auto col_config = config.collections.find(content_type);
+  std::vector<fs::path> paths;
+  for (const auto &change : changes.changes()) {
+    paths.push_back(change.path.lexically_normal());
+  }
 
-      if (col_config != config.collections.end() &&
-          !col_config->second.template_name.empty()) {
+  auto needs_full_scan = [this](const FileChange &change) {
+    std::string ext = change.path.extension().string();
 
-        template_path = templates_dir / col_config->second.template_name;
+    if (ext == ".yaml" || ext == ".yml") {
+      return true;
+    }
+    // Whether a page has a content template is decided at discovery
+    if (is_within(change.path, templates_dir) &&
+        change.kind != ChangeKind::Modified) {
+      return true;
+    }
+    // A directory moved into content/ doesn't report its files
+    return change.kind != ChangeKind::Removed &&
+           fs::is_directory(change.path);
+  };
+
+  if (!fs::exists(content_dir) ||
+      std::any_of(changes.changes().begin(), changes.changes().end(),
+                  needs_full_scan)) {
+    auto before = snapshot();
+    discover_content();
+
+    result.incremental = false;
+    for (const auto *site : {before.get(), snapshot().get()}) {
+      for (const auto &[url, page] : site->pages) {
+        result.affected_urls.insert(url);
+      }
+    }
+    return result;
+  }
 
-        if (fs::exists(template_path) &&
-            template_path.filename() != "base.html") {
-          has_content_template = true;
-        } else {
-          std::cerr << termcolor::yellow << "⚠ Warning: " << termcolor::reset
-                    << "Template '" << col_config->second.template_name
-                    << "' not found for collection '" << content_type << "'\n";
+  // Dependents by file and collection as of before the change, which
+  // covers removed pages. Edits that keep a page in place narrow this down
+  // to the pages reading what changed.
+  std::unordered_map<std::string, std::unordered_set<std::string>> dependents;
+  for (const auto &path : paths) {
+    dependents[path.string()] = affected_urls({path});
+  }
+  std::vector<fs::path> coarse;
+
+  auto current = snapshot();
+  auto next = std::make_shared<SiteSnapshot>(*current);
+  next->version = BuildInfo::getInstance().getVersion();
+
+  fs::path base_path = (templates_dir / "base.html").lexically_normal();
+
+  for (const auto &change : changes.changes()) {
+    fs::path path = change.path.lexically_normal();
+
+    if (is_within(path, templates_dir)) {
+      // Only modified templates get this far. Pages are rendered from the
+      // file itself, but what it includes and reads may have changed.
+      coarse.push_back(path);
+      std::string relative = relative_path(path);
+      parsed_templates_.erase(relative);
+      // Scans take in their includes, so any of them may be stale
+      template_scans_.clear();
+      if (path == base_path) {
+        base_template = read_file(path);
+      }
+      for (const auto &url : dependency_graph_.pages_using_file(relative)) {
+        if (const PageInfo *page = next->find(url)) {
+          track_page(*next, *page);
         }
-      } else {
+      }
+      continue;
+    }
 
-        template_path = templates_dir / (content_type + ".html");
+    if (!is_within(path, content_dir)) {
+      coarse.push_back(path);
+      continue;
+    }
+
+    std::string key = path.string();
+    std::shared_ptr<const PageInfo> old_page;
+    if (auto it = next->urls_by_path.find(key);
+        it != next->urls_by_path.end()) {
+      auto page_it = next->pages.find(it->second);
+      if (page_it != next->pages.end() &&
+          page_it->second->content_path == path) {
+        old_page = page_it->second;
+      }
+    }
 
-        if (fs::exists(template_path) &&
-            template_path.filename() != "base.html") {
-          has_content_template = true;
+    if (change.kind == ChangeKind::Removed) {
+      coarse.push_back(path);
+      if (old_page) {
+        remove_page(*next, *old_page);
+        continue;
+      }
+
+      // A removed directory only reports itself: drop everything under it
+      std::string prefix = key + "/";
+      std::vector<std::shared_ptr<const PageInfo>> contained;
+      for (const auto &[file, url] : next->urls_by_path) {
+        if (file.starts_with(prefix)) {
+          if (auto page = next->pages.find(url); page != next->pages.end()) {
+            contained.push_back(page->second);
+          }
         }
       }
+      for (const auto &page : contained) {
+        remove_page(*next, *page);
+      }
+      continue;
+    }
+
+    auto page = fs::is_regular_file(path) ? load_page(path) : nullptr;
+    if (!page) {
+      coarse.push_back(path);
+      continue;
     }
 
-    PageInfo page;
-    page.content_path = entry.path();
-    page.template_path = has_content_template ? template_path : fs::path();
-    page.url = url_path;
-    page.content_type = content_type;
-    page.frontmatter = fm;
-    page.html_content = html_content;
-    page.needs_template = !is_standalone;
+    bool same_page = old_page && old_page->url == page->url &&
+                     old_page->content_type == page->content_type;
+    if (!same_page) {
+      coarse.push_back(path);
+      if (old_page) {
+        remove_page(*next, *old_page);
+      }
+      insert_page(*next, std::move(page));
+      continue;
+    }
+
+    auto col_config = config.collections.find(page->content_type);
+    bool same_slot =
+        col_config == config.collections.end() ||
+        old_page->frontmatter.get(col_config->second.sort_by, "") ==
+            page->frontmatter.get(col_config->second.sort_by, "");
+
+    auto old_data = next->page_data.at(page->url);
+    auto new_data = std::make_shared<const nlohmann::json>(
+        TemplateEngine::serialize_page(page.get()));
+    std::vector<std::string> changed =
+        changed_paths(page->content_type, *old_data, *new_data);
+    if (!same_slot) {
+      changed.push_back("collections." + page->content_type + "[#]");
+    }
 
-    if (page.url == "404") {
-      has_error_page = true;
+    result.affected_urls.insert(page->url);
+    if (page->content_type != "pages") {
+      auto readers =
+          dependency_graph_.pages_reading(page->content_type, changed);
+      result.affected_urls.insert(readers.begin(), readers.end());
     }
 
-    pages[url_path] = page;
+    if (same_slot) {
+      // Sort key unchanged: swap the page in place, no re-sort
+      next->page_data[page->url] = std::move(new_data);
+      if (page->content_type != "pages") {
+        auto &items = next->collections[page->content_type];
+        std::replace(items.begin(), items.end(), old_page.get(), page.get());
+      }
+      track_page(*next, *page);
+      next->pages[page->url] = std::move(page);
+      continue;
+    }
+
+    remove_page(*next, *old_page);
+    insert_page(*next, std::move(page));
   }
 
-  build_collections();
+  next->base_template = base_template;
+  serialize_collections(*next);
+  snapshot_.store(std::move(next));
+
+  for (const auto &path : coarse) {
+    const auto &before = dependents[path.string()];
+    result.affected_urls.insert(before.begin(), before.end());
+  }
+  // ...and after it, which covers added pages and new collection members
+  auto added = affected_urls(coarse);
+  result.affected_urls.insert(added.begin(), added.end());
+  return result;
 }
 
-void SiteBuilder::build_collections() {
-  collections.clear();
+std::vector<std::string>
+SiteBuilder::changed_paths(const std::string &collection,
+                           const nlohmann::json &before,
+                           const nlohmann::json &after) {
+  std::string element = "collections." + collection + "[*].";
+  std::vector<std::string> paths;
+
+  for (const auto &[key, value] : after.items()) {
+    auto it = before.find(key);
+    if (it == before.end() || *it != value) {
+      paths.push_back(element + key);
+    }
+  }
+  for (const auto &[key, value] : before.items()) {
+    if (!after.contains(key)) {
+      paths.push_back(element + key);
+    }
+  }
 
-  for (const auto &[url, page] : pages) {
+  return paths;
+}
 
-    if (page.content_type == "pages")
-      continue;
+std::string SiteBuilder::relative_path(const fs::path &path) const {
+  return path.lexically_normal()
+      .lexically_relative(project_root)
+      .generic_string();
+}
 
-    collections[page.content_type].push_back(&page);
+const inja::Template *SiteBuilder::parsed_template(const fs::path &path) {
+  std::string key = relative_path(path);
+  auto it = parsed_templates_.find(key);
+  if (it != parsed_templates_.end()) {
+    report_.template_parses.hits++;
+  } else {
+    report_.template_parses.misses++;
+    std::shared_ptr<const inja::Template> tmpl;
+    try {
+      // A missing include renders as nothing, so it reads nothing
+      tmpl = std::make_shared<const inja::Template>(template_engine().parse(
+          fs::is_regular_file(path) ? read_file(path) : ""));
+    } catch (const std::exception &) {
+    }
+    it = parsed_templates_.emplace(key, std::move(tmpl)).first;
   }
+  return it->second.get();
+}
 
-  for (auto &[name, items] : collections) {
-    auto col_config = config.collections.find(name);
-    if (col_config != config.collections.end()) {
-      std::string sort_by = col_config->second.sort_by;
-      bool descending = (col_config->second.sort_order == "desc");
+SiteBuilder::TemplateScan
+SiteBuilder::scan_parsed(const inja::Template *tmpl) {
+  TemplateScan scan;
+  if (!tmpl) {
+    // Fails to render anyway; until it's fixed, assume it reads everything
+    scan.reads.push_back("");
+    return scan;
+  }
 
-      std::sort(items.begin(), items.end(),
-                [&sort_by, descending](const PageInfo *a, const PageInfo *b) {
-                  std::string a_val = a->frontmatter.get(sort_by, "");
-                  std::string b_val = b->frontmatter.get(sort_by, "");
+  std::set<std::string> includes;
+  ReadSetAnalyzer analyzer(
+      [&](const std::string &name) -> const inja::Template * {
+        // inja resolves includes from the working directory (the project
+        // root); fall back to the templates folder for bare names
+        fs::path resolved = project_root / name;
+        if (!fs::exists(resolved)) {
+          resolved = templates_dir / name;
+        }
+        includes.insert(relative_path(resolved));
+        return parsed_template(resolved);
+      });
+  analyzer.analyze(*tmpl);
+
+  scan.includes.assign(includes.begin(), includes.end());
+  scan.reads.assign(analyzer.reads().begin(), analyzer.reads().end());
+  return scan;
+}
+
+SiteBuilder::TemplateScan
+SiteBuilder::scan_source(const std::string &source) {
+  // Most page bodies are plain HTML and need no parsing
+  if (source.find("{{") == std::string::npos &&
+      source.find("{%") == std::string::npos) {
+    return {};
+  }
+
+  try {
+    inja::Template tmpl = template_engine().parse(source);
+    return scan_parsed(&tmpl);
+  } catch (const std::exception &) {
+    return scan_parsed(nullptr);
+  }
+}
+
+const SiteBuilder::TemplateScan &
+SiteBuilder::scan_template(const fs::path &path) {
+  std::string key = relative_path(path);
+  auto it = template_scans_.find(key);
+  if (it != template_scans_.end()) {
+    report_.template_scans.hits++;
+    return it->second;
+  }
+  report_.template_scans.misses++;
+
+  TemplateScan scan = scan_parsed(parsed_template(path));
+  return template_scans_.emplace(key, std::move(scan)).first->second;
+}
 
-                  if (descending) {
-                    return a_val > b_val;
-                  } else {
-                    return a_val < b_val;
-                  }
-                });
+DependencyGraph::PageDeps
+SiteBuilder::page_dependencies(const PageInfo &page) {
+  std::unordered_set<std::string> files = {relative_path(page.content_path),
+                                           "forge.yaml"};
+  std::set<std::string> reads;
+
+  if (page.needs_template) {
+    auto add_scan = [&](const TemplateScan &scan) {
+      files.insert(scan.includes.begin(), scan.includes.end());
+      reads.insert(scan.reads.begin(), scan.reads.end());
+    };
+
+    // The page body is rendered as a template too
+    add_scan(scan_source(page.html_content));
+
+    if (!page.template_path.empty()) {
+      files.insert(relative_path(page.template_path));
+      add_scan(scan_template(page.template_path));
+    }
+    fs::path base_path = templates_dir / "base.html";
+    if (fs::exists(base_path)) {
+      files.insert(relative_path(base_path));
+      add_scan(scan_template(base_path));
     }
   }
+
+  std::set<std::string> collections;
+  for (const auto &read : reads) {
+    auto segments = DependencyGraph::path_segments(read);
+    if (!segments.empty() && segments[0] != "collections") {
+      continue;
+    }
+    // "" reads the whole context, "collections" and "collections.*" all
+    // of the collections
+    if (segments.size() < 2 || segments[1] == "*") {
+      collections.insert(DependencyGraph::all_collections);
+    } else {
+      collections.insert(std::string(segments[1]));
+    }
+  }
+
+  DependencyGraph::PageDeps deps;
+  deps.files.assign(files.begin(), files.end());
+  std::sort(deps.files.begin(), deps.files.end());
+  deps.collections.assign(collections.begin(), collections.end());
+  deps.reads.assign(reads.begin(), reads.end());
+  return deps;
 }
 
-std::string SiteBuilder::apply_template(const std::string &template_content,
-                                        const PageInfo &page,
-                                        const std::string &processed_content) {
-  using json = nlohmann::json;
-  json data;
+void SiteBuilder::track_page(SiteSnapshot &site, const PageInfo &page) {
+  auto deps = page_dependencies(page);
+  site.demands[page.url] = RenderDemand::from_reads(deps.reads);
+  dependency_graph_.set(page.url, std::move(deps));
+}
+
+std::unordered_set<std::string>
+SiteBuilder::affected_urls(const std::vector<fs::path> &paths) const {
+  auto site = snapshot();
+  std::unordered_set<std::string> urls;
+
+  auto add = [&urls](const std::unordered_set<std::string> &more) {
+    urls.insert(more.begin(), more.end());
+  };
+
+  for (const auto &changed : paths) {
+    fs::path path = changed.lexically_normal();
+    std::string relative = relative_path(path);
+
+    if (relative == "forge.yaml") {
+      for (const auto &[url, page] : site->pages) {
+        urls.insert(url);
+      }
+      continue;
+    }
+
+    add(dependency_graph_.pages_using_file(relative));
 
-  data["site"] = TemplateEngine::yaml_to_json(config.get_custom_data());
+    if (!is_within(path, content_dir)) {
+      continue;
+    }
 
-  data["page"] = TemplateEngine::serialize_page(&page);
+    // Pages listing the file's collection, whether or not it is (still) a
+    // member. The collection is the first folder, as in load_page().
+    std::string collection =
+        path.lexically_relative(content_dir).begin()->string();
+    if (collection != "pages") {
+      add(dependency_graph_.pages_using_collection(collection));
+    }
 
-  data["collections"] = json::object();
-  for (const auto &[name, items] : collections) {
-    data["collections"][name] = TemplateEngine::serialize_collection(items);
+    // A directory stands for everything under it
+    std::string prefix = path.string() + "/";
+    for (const auto &[file, url] : site->urls_by_path) {
+      if (file.starts_with(prefix)) {
+        urls.insert(url);
+        const PageInfo *page = site->find(url);
+        if (page && page->content_type != "pages") {
+          add(dependency_graph_.pages_using_collection(page->content_type));
+        }
+      }
+    }
   }
 
-  data["content"] = processed_content;
+  return urls;
+}
+
+void SiteBuilder::print_dependencies(const std::string &target) const {
+  auto site = snapshot();
 
-  return template_engine.render(template_content, data);
+  if (const DependencyGraph::PageDeps *deps = dependency_graph_.find(target)) {
+    std::cout << "\n"
+              << termcolor::bright_cyan << "🔗 " << target << " is built from"
+              << termcolor::reset << "\n";
+    for (const auto &file : deps->files) {
+      std::cout << termcolor::bright_blue << "  → " << termcolor::reset
+                << termcolor::white << file << termcolor::reset << "\n";
+    }
+    for (const auto &name : deps->collections) {
+      std::cout << termcolor::bright_blue << "  → " << termcolor::reset
+                << termcolor::bright_magenta
+                << (name == DependencyGraph::all_collections
+                        ? std::string("all collections")
+                        : "collection " + name)
+                << termcolor::reset << "\n";
+    }
+    for (const auto &read : deps->reads) {
+      std::cout << termcolor::bright_blue << "  ↳ reads " << termcolor::reset
+                << termcolor::cyan << (read.empty() ? "everything" : read)
+                << termcolor::reset << "\n";
+    }
+    std::cout << "\n";
+    return;
+  }
+
+  fs::path path = fs::path(target).is_absolute() ? fs::path(target)
+                                                  : project_root / target;
+  auto urls = affected_urls({path});
+  std::vector<std::string> sorted(urls.begin(), urls.end());
+  std::sort(sorted.begin(), sorted.end());
+
+  std::cout << "\n"
+            << termcolor::bright_cyan << "🔗 Pages depending on "
+            << relative_path(path) << termcolor::reset << termcolor::bright_blue
+            << " (" << sorted.size() << ")" << termcolor::reset << "\n";
+  if (sorted.empty()) {
+    std::cout << termcolor::bright_blue << "  ℹ  No page depends on it"
+              << termcolor::reset << "\n";
+  }
+  for (const auto &url : sorted) {
+    std::cout << termcolor::bright_blue << "  → " << termcolor::reset
+              << termcolor::cyan << url << termcolor::reset << "\n";
+  }
+  std::cout << "\n";
 }
 
-std::string SiteBuilder::apply_base_template(const std::string &content,
-                                             const PageInfo &page) {
-  if (base_template.empty()) {
-    return content;
+nlohmann::json SiteBuilder::render_context(const SiteSnapshot &site,
+                                           const PageInfo &page) const {
+  const RenderDemand &demand = site.demand(page.url);
+
+  nlohmann::json data;
+
+  if (demand.site) {
+    data["site"] = site.site_data ? *site.site_data : nlohmann::json();
   }
 
-  using json = nlohmann::json;
-  json data;
+  // Bodies are most of the data; copy them only where a template reads them
+  auto page_data = site.page_data.find(page.url);
+  if (page_data == site.page_data.end()) {
+    data["page"] = TemplateEngine::serialize_page(&page);
+  } else if (demand.page_html_content) {
+    data["page"] = *page_data->second;
+  } else {
+    data["page"] = without_html_content(*page_data->second);
+  }
 
-  data["site"] = TemplateEngine::yaml_to_json(config.get_custom_data());
+  // Collections are copied whole from the arrays built with the snapshot
+  if (!demand.collections.empty()) {
+    auto &collections = data["collections"] = nlohmann::json::object();
+    for (const auto &[name, elements] : site.collection_data) {
+      auto html_content = demand.collection_html_content(name);
+      if (html_content) {
+        collections[name] = *html_content ? *elements.full : *elements.trimmed;
+      }
+    }
+  }
+
+  return data;
+}
+
+std::string SiteBuilder::apply_template(const std::string &template_content,
+                                        nlohmann::json &data,
+                                        const std::string &processed_content) {
+  data["content"] = processed_content;
 
-  data["page"] = TemplateEngine::serialize_page(&page);
+  return template_engine().render(template_content, data);
+}
 
-  data["collections"] = json::object();
-  for (const auto &[name, items] : collections) {
-    data["collections"][name] = TemplateEngine::serialize_collection(items);
+std::string SiteBuilder::apply_base_template(const SiteSnapshot &site,
+                                             const std::string &content,
+                                             nlohmann::json &data,
+                                             const RenderDemand &demand) {
+  if (site.base_template.empty()) {
+    return content;
   }
 
   data["content"] = content;
 
-  data["version"] = std::to_string(BuildInfo::getInstance().getVersion());
+  if (demand.version) {
+    data["version"] = std::to_string(site.version);
+  }
 
-  std::string result = template_engine.render(base_template, data);
+  std::string result = template_engine().render(site.base_template, data);
 
   if (is_dev_mode) {
     result = inject_dev_scripts(result);
@@ -580,47 +1442,73 @@ std::string SiteBuilder::apply_base_template(const std::string &content,
   return result;
 }
 
-std::string SiteBuilder::render_page(const PageInfo &page) {
-  std::shared_lock<std::shared_mutex> lock(pages_mutex_);
-
+std::string SiteBuilder::render_page(const SiteSnapshot &site,
+                                     const PageInfo &page) {
   if (!page.needs_template) {
     return page.html_content;
   }
 
-  using json = nlohmann::json;
-  json data;
+  FORGE_TRACE_SCOPE("render_page", page.url);
 
-  data["site"] = TemplateEngine::yaml_to_json(config.get_custom_data());
-  data["page"] = TemplateEngine::serialize_page(&page);
+  // One context for all three passes; each pass only adds its own keys.
+  // It holds only what the page's templates can read.
+  nlohmann::json data = render_context(site, page);
 
-  data["collections"] = json::object();
-  for (const auto &[name, items] : collections) {
-    data["collections"][name] = TemplateEngine::serialize_collection(items);
+  std::string processed_content;
+  {
+    FORGE_TRACE_SCOPE("render_body");
+    processed_content = template_engine().render(page.html_content, data);
   }
 
-  std::string processed_content =
-      template_engine.render(page.html_content, data);
-
   std::string content_to_wrap = processed_content;
 
   if (!page.template_path.empty() && fs::exists(page.template_path)) {
+    FORGE_TRACE_SCOPE("render_collection_template", page.template_path);
     std::string template_content = read_file(page.template_path);
-    content_to_wrap = apply_template(template_content, page, processed_content);
+    content_to_wrap = apply_template(template_content, data, processed_content);
   }
 
-  return apply_base_template(content_to_wrap, page);
+  FORGE_TRACE_SCOPE("render_base_template");
+  return apply_base_template(site, content_to_wrap, data,
+                             site.demand(page.url));
 }
 
 void SiteBuilder::build_page(const std::string &url) {
-  auto it = pages.find(url);
-  if (it == pages.end()) {
+  FORGE_TRACE_SCOPE("build_page", url);
+  auto site = snapshot();
+  const PageInfo *page = site->find(url);
+  if (!page) {
     throw std::runtime_error("Page not found: " + url);
   }
 
-  std::string html = render_page(it->second);
+  BuildReport::PageStats stats;
+  stats.url = url;
+  std::error_code size_error;
+  auto input_size = fs::file_size(page->content_path, size_error);
+  stats.input_bytes = size_error ? 0 : input_size;
+
+  auto render_start = std::chrono::steady_clock::now();
+  std::string html = render_page(*site, *page);
+  stats.render_ms = elapsed_ms(render_start);
+  stats.rendered_bytes = html.size();
 
+  auto minify_start = std::chrono::steady_clock::now();
   html = minify_html_content(html);
+  stats.minify_ms = elapsed_ms(minify_start);
+  stats.output_bytes = html.size();
+
+  page_assets[url] = trackAssets(html);
+  page_rendered_bytes[url] = stats.rendered_bytes;
+
+  write_file(output_path(url), html);
+
+  report_.html.files++;
+  report_.html.input_bytes += stats.rendered_bytes;
+  report_.html.output_bytes += stats.output_bytes;
+  report_.pages.push_back(std::move(stats));
+}
 
+fs::path SiteBuilder::output_path(const std::string &url) const {
   fs::path out_path = output_dir;
   if (url == "/") {
     out_path /= "index.html";
@@ -629,13 +1517,20 @@ void SiteBuilder::build_page(const std::string &url) {
     out_path /= path_str;
     out_path += "/index.html";
   }
-
-  trackAssets(html);
-
-  write_file(out_path, html);
+  return out_path;
 }
 
 void SiteBuilder::build_all() {
+  auto site = snapshot();
+  std::vector<std::string> urls;
+  urls.reserve(site->pages.size());
+  for (const auto &[url, page] : site->pages) {
+    urls.push_back(url);
+  }
+  build_pages(urls);
+}
+
+void SiteBuilder::build_pages(const std::vector<std::string> &urls) {
   auto start = std::chrono::high_resolution_clock::now();
 
   std::cout << "\n"
@@ -645,20 +1540,17 @@ void SiteBuilder::build_all() {
   int success_count = 0;
   int error_count = 0;
 
-  for (const auto &[url, page] : pages) {
+  for (const auto &url : urls) {
     try {
       build_page(url);
       success_count++;
-      std::cout << termcolor::bright_green << "  ✓ " << termcolor::reset
-                << termcolor::white << url << termcolor::reset << "\n";
+      Log::instance().page(url);
     } catch (const std::exception &e) {
       error_count++;
-      std::cerr << termcolor::bright_red << "  ✗ " << termcolor::reset
-                << termcolor::white << url << termcolor::reset
-                << termcolor::bright_blue << ": " << e.what()
-                << termcolor::reset << "\n";
+      Log::instance().page(url, e.what());
     }
   }
+  Log::instance().flush();
 
   auto end = std::chrono::high_resolution_clock::now();
   auto duration =
@@ -676,8 +1568,129 @@ void SiteBuilder::build_all() {
             << termcolor::reset << "\n";
 }
 
-void SiteBuilder::export_static_site() {
+std::unordered_map<std::string, std::string>
+SiteBuilder::fingerprint_inputs() const {
+  std::unordered_map<std::string, std::string> inputs;
+
+  auto add = [&](const fs::path &path) {
+    auto mtime = fs::last_write_time(path).time_since_epoch().count();
+    inputs[relative_path(path)] =
+        std::to_string(mtime) + ":" + std::to_string(fs::file_size(path));
+  };
+
+  for (const auto &dir : {content_dir, templates_dir}) {
+    if (!fs::exists(dir)) {
+      continue;
+    }
+    for (const auto &entry : fs::recursive_directory_iterator(dir)) {
+      if (entry.is_regular_file()) {
+        add(entry.path());
+      }
+    }
+  }
+
+  fs::path config_path = project_root / "forge.yaml";
+  if (fs::exists(config_path)) {
+    add(config_path);
+  }
+
+  return inputs;
+}
+
+std::optional<std::vector<std::string>>
+SiteBuilder::plan_incremental_build(const BuildManifest &previous,
+                                    const BuildManifest &current) {
+  std::vector<fs::path> changed;
+  bool templates_added_or_removed = false;
+
+  for (const auto &[file, fingerprint] : current.inputs) {
+    auto it = previous.inputs.find(file);
+    if (it == previous.inputs.end() || it->second != fingerprint) {
+      changed.push_back(project_root / file);
+      templates_added_or_removed |=
+          it == previous.inputs.end() &&
+          is_within(project_root / file, templates_dir);
+    }
+  }
+  for (const auto &[file, fingerprint] : previous.inputs) {
+    if (current.inputs.find(file) == current.inputs.end()) {
+      changed.push_back(project_root / file);
+      templates_added_or_removed |=
+          is_within(project_root / file, templates_dir);
+    }
+  }
+
+  // Same rule as update_content(): these can change every page
+  if (templates_added_or_removed ||
+      std::any_of(changed.begin(), changed.end(), [this](const fs::path &p) {
+        return relative_path(p) == "forge.yaml";
+      })) {
+    return std::nullopt;
+  }
+
+  auto site = snapshot();
+  auto affected = affected_urls(changed);
+
+  // Outputs of pages that no longer exist
+  for (const auto &[url, assets] : previous.page_assets) {
+    if (site->find(url)) {
+      continue;
+    }
+    fs::path stale = output_path(url);
+    fs::remove(stale);
+    fs::remove(fs::path(stale) += ".gz");
+    if (url != "/" && fs::is_empty(stale.parent_path())) {
+      fs::remove(stale.parent_path());
+    }
+  }
+
+  std::vector<std::string> urls;
+  for (const auto &[url, page] : site->pages) {
+    auto previous_assets = previous.page_assets.find(url);
+    std::error_code ec;
+    size_t output_size = fs::file_size(output_path(url), ec);
+    if (affected.count(url) || previous_assets == previous.page_assets.end() ||
+        ec) {
+      urls.push_back(url);
+      continue;
+    }
+
+    // Not rendered again, but its assets still need copying
+    page_assets[url] = previous_assets->second;
+    referencedAssets.insert(previous_assets->second.begin(),
+                            previous_assets->second.end());
+
+    // ...and its output still counts toward the report and page budgets
+    BuildReport::PageStats stats;
+    stats.url = url;
+    stats.reused = true;
+    size_t input_size = fs::file_size(page->content_path, ec);
+    stats.input_bytes = ec ? 0 : input_size;
+    stats.output_bytes = output_size;
+    auto rendered = previous.page_rendered_bytes.find(url);
+    stats.rendered_bytes = rendered != previous.page_rendered_bytes.end()
+                               ? rendered->second
+                               : output_size;
+    page_rendered_bytes[url] = stats.rendered_bytes;
+
+    report_.html.files++;
+    report_.html.input_bytes += stats.rendered_bytes;
+    report_.html.output_bytes += stats.output_bytes;
+    report_.pages.push_back(std::move(stats));
+  }
+
+  return urls;
+}
+
+void SiteBuilder::export_static_site(bool incremental) {
+  FORGE_TRACE_SCOPE("export_static_site");
   auto total_start = std::chrono::high_resolution_clock::now();
+  auto export_start = std::chrono::steady_clock::now();
+  auto phase_start = export_start;
+  auto end_phase = [&](const char *name) {
+    report_.add_phase(name, elapsed_ms(phase_start));
+    phase_start = std::chrono::steady_clock::now();
+  };
 
   std::cout << "\n"
             << termcolor::bright_cyan
@@ -688,25 +1701,84 @@ void SiteBuilder::export_static_site() {
 
   initialize_minification();
 
-  if (fs::exists(output_dir)) {
-    fs::remove_all(output_dir);
+  fs::path manifest_path = project_root / ".forge" / "build-manifest.json";
+  BuildManifest manifest;
+  manifest.inputs = fingerprint_inputs();
+
+  std::optional<std::vector<std::string>> plan;
+  if (incremental && fs::exists(output_dir)) {
+    if (auto previous = BuildManifest::load(manifest_path)) {
+      plan = plan_incremental_build(*previous, manifest);
+    }
+  }
+
+  if (!plan) {
+    if (incremental) {
+      std::cout << termcolor::bright_yellow << "⚠ " << termcolor::reset
+                << "No usable previous build, building everything\n";
+    }
+    if (fs::exists(output_dir)) {
+      fs::remove_all(output_dir);
+    }
+    fs::create_directories(output_dir);
   }
-  fs::create_directories(output_dir);
+  end_phase("plan");
 
   // Discover available assets before building
   discover_available_assets();
+  end_phase("assets");
+
+  size_t page_count = snapshot()->pages.size();
+  size_t rendered = plan ? plan->size() : page_count;
+  report_.incremental_pages.hits += page_count - rendered;
+  report_.incremental_pages.misses += rendered;
 
   // Build all pages (tracks referenced assets)
-  build_all();
+  if (plan) {
+    // Static files aren't fingerprinted; they are processed again in full
+    fs::remove_all(output_dir / "static");
+
+    std::cout << termcolor::bright_green << "✓ " << termcolor::reset
+              << "Incremental build: " << termcolor::bright_white
+              << plan->size() << termcolor::reset << " of "
+              << snapshot()->pages.size() << " pages affected\n";
+    build_pages(*plan);
+  } else {
+    build_all();
+  }
+  end_phase("pages");
 
   // Process static files
   if (fs::exists(static_dir)) {
     process_static_files();
+    end_phase("static");
+  }
+
+  // Emit .gz siblings for text assets, or clear ones left from before
+  precompress_output();
+  if (config.precompress.gzip) {
+    end_phase("precompress");
   }
 
+  measure_page_weights();
+  end_phase("weights");
+
   // Report unused assets
   report_unused_assets();
 
+  manifest.page_assets = page_assets;
+  manifest.page_rendered_bytes = page_rendered_bytes;
+  manifest.save(manifest_path);
+  end_phase("manifest");
+
+  report_.output_bytes = 0;
+  for (const auto &entry : fs::recursive_directory_iterator(output_dir)) {
+    if (entry.is_regular_file() && entry.path().extension() != ".gz") {
+      report_.output_bytes += entry.file_size();
+    }
+  }
+  report_.total_ms += elapsed_ms(export_start);
+
   // Print summary
   print_build_summary(total_start);
 }
\ No newline at end of file
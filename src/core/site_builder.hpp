@@ -2,12 +2,19 @@
 #define SITE_BUILDER_HPP
 
 #include "core/js_minifier.hpp"
+#include "dependency_graph.hpp"
 #include "frontmatter.hpp"
 
+#include "build_manifest.hpp"
+#include "build_report.hpp"
+#include "site_snapshot.hpp"
 #include "template_engine.hpp"
 #include "utils/config.hpp"
+#include "utils/rebuild_queue.hpp"
+#include <atomic>
 #include <filesystem>
-#include <shared_mutex>
+#include <memory>
+#include <optional>
 #include <string>
 #include <sys/types.h>
 #include <unordered_map>
@@ -16,6 +23,13 @@
 
 namespace fs = std::filesystem;
 
+struct ContentUpdate {
+  // False when the change forced a full rediscover
+  bool incremental = true;
+  // Pages whose output may differ, including pages that were removed
+  std::unordered_set<std::string> affected_urls;
+};
+
 class SiteBuilder {
 private:
   std::unique_ptr<JSMinifier> js_minifier;
@@ -28,55 +42,129 @@ private:
 
   SiteConfig config;
   std::string base_template;
-  TemplateEngine template_engine;
-  std::unordered_map<std::string, PageInfo> pages;
-  mutable std::shared_mutex pages_mutex_;
 
-  std::unordered_map<std::string, std::vector<const PageInfo *>> collections;
+  // The published site. Rebuilds store a fresh snapshot; readers load it
+  // once and render from that copy without taking any lock.
+  std::atomic<std::shared_ptr<const SiteSnapshot>> snapshot_;
+
+  // Only touched by the thread running discovery/updates
+  DependencyGraph dependency_graph_;
+  struct TemplateScan {
+    // Everything it includes, directly or not
+    std::vector<std::string> includes;
+    std::vector<std::string> reads;
+  };
+  std::unordered_map<std::string, TemplateScan> template_scans_;
+  // Null where the file didn't parse
+  std::unordered_map<std::string, std::shared_ptr<const inja::Template>>
+      parsed_templates_;
+
   std::unordered_set<std::string> referencedAssets;
   std::unordered_set<std::string> availableAssets;
+  // Assets referenced by each built page, kept for incremental builds
+  std::unordered_map<std::string, std::vector<std::string>> page_assets;
+  // Each page's size before minification, for the same reason
+  std::unordered_map<std::string, size_t> page_rendered_bytes;
+  // Assets each processed stylesheet points at through url()
+  std::unordered_map<std::string, std::vector<std::string>> css_assets_;
 
   bool has_error_page;
 
+  // Timings and sizes since the last discover_content()
+  BuildReport report_;
+
   std::string read_file(const fs::path &path);
   void write_file(const fs::path &path, const std::string &content);
 
+  // Parses one content file; nullptr if it isn't a page
+  std::shared_ptr<const PageInfo> load_page(const fs::path &path);
+
+  void remove_page(SiteSnapshot &site, const PageInfo &page);
+  void insert_page(SiteSnapshot &site, std::shared_ptr<const PageInfo> page);
+
+  std::string relative_path(const fs::path &path) const;
+  const inja::Template *parsed_template(const fs::path &path);
+  TemplateScan scan_parsed(const inja::Template *tmpl);
+  TemplateScan scan_source(const std::string &source);
+  const TemplateScan &scan_template(const fs::path &path);
+  DependencyGraph::PageDeps page_dependencies(const PageInfo &page);
+  // Records the page's dependencies and its render demand in `site`
+  void track_page(SiteSnapshot &site, const PageInfo &page);
+  // Element paths (`collections.<name>[*].<key>`) whose value differs
+  // between two serializations of the same page
+  static std::vector<std::string> changed_paths(const std::string &collection,
+                                                const nlohmann::json &before,
+                                                const nlohmann::json &after);
+
+  fs::path output_path(const std::string &url) const;
+  std::unordered_map<std::string, std::string> fingerprint_inputs() const;
+  std::optional<std::vector<std::string>>
+  plan_incremental_build(const BuildManifest &previous,
+                         const BuildManifest &current);
+
+  nlohmann::json render_context(const SiteSnapshot &site,
+                                const PageInfo &page) const;
+
   std::string apply_template(const std::string &template_content,
-                             const PageInfo &page,
+                             nlohmann::json &data,
                              const std::string &processed_content);
 
-  std::string apply_base_template(const std::string &content,
-                                  const PageInfo &page);
+  std::string apply_base_template(const SiteSnapshot &site,
+                                  const std::string &content,
+                                  nlohmann::json &data,
+                                  const RenderDemand &demand);
 
   std::string inject_dev_scripts(const std::string &html);
 
+  // inja environments are not safe to share between threads, so every
+  // rendering thread gets its own engine.
+  static TemplateEngine &template_engine();
+
   bool is_dev_mode = false;
 
 public:
   SiteBuilder(const fs::path &root);
 
   void discover_content();
-  void build_collections();
+  void build_collections(SiteSnapshot &site) const;
+  // Brings `site.collection_data` in line with its collections
+  static void serialize_collections(SiteSnapshot &site);
 
-  std::string render_page(const PageInfo &page);
+  // Publishes a snapshot with only the changed content files reparsed.
+  // Falls back to discover_content() for changes that can affect every
+  // page (config, added or removed templates, directories moved in).
+  ContentUpdate update_content(const ChangeSet &changes);
+
+  const DependencyGraph &dependency_graph() const { return dependency_graph_; }
+
+  // URLs whose output depends on any of `paths`
+  std::unordered_set<std::string>
+  affected_urls(const std::vector<fs::path> &paths) const;
+
+  // `forge deps`: a page URL lists its inputs, a file lists its dependents
+  void print_dependencies(const std::string &target) const;
+
+  std::string render_page(const SiteSnapshot &site, const PageInfo &page);
   void build_page(const std::string &url);
+  void build_pages(const std::vector<std::string> &urls);
   void build_all();
-  void export_static_site();
+  // With `incremental`, only pages affected by inputs that changed since
+  // the last build are rendered again
+  void export_static_site(bool incremental = false);
 
+  // Takes effect with the next discover_content()
   void reload_base_template(const fs::path &path) {
     base_template = read_file(path);
   }
 
-  const std::unordered_map<std::string, PageInfo> &get_pages() const {
-    return pages;
+  std::shared_ptr<const SiteSnapshot> snapshot() const {
+    return snapshot_.load();
   }
 
-  const std::unordered_map<std::string, std::vector<const PageInfo *>> &
-  get_collections() const {
-    return collections;
-  }
+  const BuildReport &report() const { return report_; }
 
-  void trackAssets(const std::string &source);
+  // Returns the assets found in `source`, which are also recorded as used
+  std::vector<std::string> trackAssets(const std::string &source);
   void trackAssetsInCss(const std::string &source, const std::string &path);
   bool isStaticAsset(const std::string &path);
   std::string normalizeAssetPath(const std::string &path) {
@@ -101,6 +189,10 @@ public:
   void discover_available_assets();
   void report_unused_assets();
   void process_static_files();
+  // Writes .gz siblings of text outputs and removes outdated ones
+  void precompress_output();
+  // Fills the report's page weights from the asset graph and the output
+  void measure_page_weights();
   void log_processed_file(const fs::path &relative, const std::string &note);
   void print_build_summary(
       const std::chrono::high_resolution_clock::time_point &start);
@@ -0,0 +1,67 @@
+#ifndef SITE_SNAPSHOT_HPP
+#define SITE_SNAPSHOT_HPP
+
+#include "template_analysis.hpp"
+#include "template_engine.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Everything a request needs to render a page, frozen at the end of a
+// discover pass. Snapshots are never modified once published: the builder
+// assembles the next one off to the side and swaps it in, so a reader that
+// pinned the old one keeps rendering from consistent data until it lets go.
+//
+// Pages and serialized data are held by shared_ptr so an incremental update
+// can copy the previous snapshot cheaply and replace only what changed.
+struct SiteSnapshot {
+  using JsonPtr = std::shared_ptr<const nlohmann::json>;
+
+  // Build version the snapshot was discovered under
+  uint64_t version = 0;
+
+  std::unordered_map<std::string, std::shared_ptr<const PageInfo>> pages;
+
+  // Content file path to the URL it produced, for mapping deletes and
+  // renames back to pages
+  std::unordered_map<std::string, std::string> urls_by_path;
+
+  // Points into `pages`; sorted per the collection's config
+  std::unordered_map<std::string, std::vector<const PageInfo *>> collections;
+
+  // Template data serialized once and shared by every render: "site" and
+  // each page by URL.
+  JsonPtr site_data;
+  std::unordered_map<std::string, JsonPtr> page_data;
+
+  // Each collection's elements as templates see them, with and without
+  // `html_content`, assembled from `page_data` once per snapshot. `sources`
+  // is what they were built from, so an update only redoes the
+  // collections whose members changed.
+  struct CollectionData {
+    JsonPtr full;
+    JsonPtr trimmed;
+    std::vector<JsonPtr> sources;
+  };
+  std::unordered_map<std::string, CollectionData> collection_data;
+
+  // What each page's templates can read, so renders skip the rest
+  std::unordered_map<std::string, RenderDemand> demands;
+
+  std::string base_template;
+
+  const PageInfo *find(const std::string &url) const {
+    auto it = pages.find(url);
+    return it != pages.end() ? it->second.get() : nullptr;
+  }
+
+  const RenderDemand &demand(const std::string &url) const {
+    static const RenderDemand everything;
+    auto it = demands.find(url);
+    return it != demands.end() ? it->second : everything;
+  }
+};
+
+#endif
@@ -0,0 +1,361 @@
+#include "template_analysis.hpp"
+#include "dependency_graph.hpp"
+#include <algorithm>
+#include <cctype>
+
+void ReadSetAnalyzer::analyze(const inja::Template &tmpl) {
+  tmpl.root.accept(*this);
+}
+
+void ReadSetAnalyzer::visit(const inja::BlockNode &node) {
+  for (const auto &child : node.nodes) {
+    child->accept(*this);
+  }
+}
+
+void ReadSetAnalyzer::visit(const inja::TextNode &) {}
+
+void ReadSetAnalyzer::visit(const inja::ExpressionNode &) {}
+
+void ReadSetAnalyzer::visit(const inja::LiteralNode &) {}
+
+void ReadSetAnalyzer::visit(const inja::DataNode &node) {
+  if (auto path = reference(node)) {
+    record(*path);
+  }
+}
+
+void ReadSetAnalyzer::visit(const inja::FunctionNode &node) {
+  if (auto path = reference(node)) {
+    record(*path);
+  }
+}
+
+void ReadSetAnalyzer::visit(const inja::ExpressionListNode &node) {
+  if (node.root) {
+    node.root->accept(*this);
+  }
+}
+
+void ReadSetAnalyzer::visit(const inja::StatementNode &) {}
+
+void ReadSetAnalyzer::visit(const inja::ForStatementNode &) {}
+
+void ReadSetAnalyzer::visit(const inja::ForArrayStatementNode &node) {
+  std::optional<std::string> source;
+  if (node.condition.root) {
+    source = reference(*node.condition.root);
+  }
+  if (source) {
+    // The loop runs once per element, so membership and order count too
+    record(*source + "[#]");
+  }
+
+  size_t scope = bindings_.size();
+  bindings_.emplace_back(node.value, source ? std::optional(*source + "[*]")
+                                            : std::nullopt);
+  walk_loop_body(node.body);
+  // Variables set inside the loop outlive it, as they do in inja
+  bindings_.erase(bindings_.begin() + scope);
+}
+
+void ReadSetAnalyzer::visit(const inja::ForObjectStatementNode &node) {
+  std::optional<std::string> source;
+  if (node.condition.root) {
+    source = reference(*node.condition.root);
+  }
+  if (source) {
+    // Every key is visited, so the whole object is read
+    record(*source);
+  }
+
+  size_t scope = bindings_.size();
+  bindings_.emplace_back(node.key, std::nullopt);
+  bindings_.emplace_back(node.value, source ? std::optional(*source + ".*")
+                                            : std::nullopt);
+  walk_loop_body(node.body);
+  bindings_.erase(bindings_.begin() + scope, bindings_.begin() + scope + 2);
+}
+
+void ReadSetAnalyzer::visit(const inja::IfStatementNode &node) {
+  node.condition.accept(*this);
+
+  size_t scope = bindings_.size();
+  node.true_statement.accept(*this);
+  auto taken = take_bindings(scope);
+  node.false_statement.accept(*this);
+  auto not_taken = take_bindings(scope);
+  merge_bindings({std::move(taken), std::move(not_taken)});
+}
+
+void ReadSetAnalyzer::visit(const inja::IncludeStatementNode &node) {
+  walk_file(node.file);
+}
+
+void ReadSetAnalyzer::visit(const inja::ExtendsStatementNode &node) {
+  walk_file(node.file);
+}
+
+void ReadSetAnalyzer::visit(const inja::BlockStatementNode &node) {
+  node.block.accept(*this);
+}
+
+void ReadSetAnalyzer::visit(const inja::SetStatementNode &node) {
+  if (!node.expression.root) {
+    // Nothing to trace the value to
+    reads_.insert("");
+    return;
+  }
+  auto value = reference(*node.expression.root);
+
+  // `set a.b = ...` writes into an object, and reads of `a.b` are taken at
+  // face value rather than traced back here, so the value is read now
+  if (node.key.find('.') != std::string::npos) {
+    if (value) {
+      record(*value);
+    }
+    return;
+  }
+  bindings_.emplace_back(node.key, std::move(value));
+}
+
+void ReadSetAnalyzer::walk_loop_body(const inja::BlockNode &body) {
+  size_t scope = bindings_.size();
+  ++loop_depth_;
+  body.accept(*this);
+
+  if (bindings_.size() > scope) {
+    // Later iterations start from what earlier ones set, so reads before a
+    // set see both; walking again from the merged bindings covers that
+    auto first = take_bindings(scope);
+    merge_bindings({std::move(first), {}});
+    body.accept(*this);
+  }
+  --loop_depth_;
+
+  // The body may not run at all
+  auto ran = take_bindings(scope);
+  if (!ran.empty()) {
+    merge_bindings({std::move(ran), {}});
+  }
+}
+
+std::vector<ReadSetAnalyzer::Binding>
+ReadSetAnalyzer::take_bindings(size_t scope) {
+  std::vector<Binding> taken(
+      std::make_move_iterator(bindings_.begin() + scope),
+      std::make_move_iterator(bindings_.end()));
+  bindings_.resize(scope);
+  return taken;
+}
+
+void ReadSetAnalyzer::merge_bindings(
+    const std::vector<std::vector<Binding>> &alternatives) {
+  std::vector<std::string> names;
+  for (const auto &alternative : alternatives) {
+    for (const auto &binding : alternative) {
+      if (std::find(names.begin(), names.end(), binding.first) ==
+          names.end()) {
+        names.push_back(binding.first);
+      }
+    }
+  }
+
+  for (const auto &name : names) {
+    // An alternative that didn't set `name` leaves the outer binding
+    std::vector<std::optional<std::string>> values;
+    for (const auto &alternative : alternatives) {
+      auto it = std::find_if(
+          alternative.rbegin(), alternative.rend(),
+          [&name](const Binding &binding) { return binding.first == name; });
+      values.push_back(it != alternative.rend() ? it->second : resolve(name));
+    }
+
+    if (std::all_of(values.begin(), values.end(),
+                    [&values](const auto &value) {
+                      return value == values.front();
+                    })) {
+      bindings_.emplace_back(name, values.front());
+      continue;
+    }
+
+    // No one path stands for every alternative, so each is read in full
+    // here and the name is treated as a local value from now on
+    for (const auto &value : values) {
+      if (value) {
+        record(*value);
+      }
+    }
+    bindings_.emplace_back(name, std::nullopt);
+  }
+}
+
+std::optional<std::string>
+ReadSetAnalyzer::resolve(const std::string &name) const {
+  size_t dot = name.find('.');
+  std::string head = name.substr(0, dot);
+  std::string rest = dot == std::string::npos ? "" : name.substr(dot);
+
+  for (auto it = bindings_.rbegin(); it != bindings_.rend(); ++it) {
+    if (it->first == head) {
+      if (!it->second) {
+        return std::nullopt;
+      }
+      return *it->second + rest;
+    }
+  }
+
+  if (head == "loop" && loop_depth_ > 0) {
+    return std::nullopt;
+  }
+
+  return name;
+}
+
+std::optional<std::string>
+ReadSetAnalyzer::reference(const inja::ExpressionNode &expr) {
+  if (const auto *data = dynamic_cast<const inja::DataNode *>(&expr)) {
+    return resolve(data->name);
+  }
+  if (const auto *function = dynamic_cast<const inja::FunctionNode *>(&expr)) {
+    return reference(*function);
+  }
+
+  expr.accept(*this);
+  return std::nullopt;
+}
+
+std::optional<std::string>
+ReadSetAnalyzer::reference(const inja::FunctionNode &node) {
+  using Op = inja::FunctionNode::Op;
+  const auto &args = node.arguments;
+
+  // at(object, "key") and existsIn(object, "key") read one member
+  if ((node.operation == Op::At || node.operation == Op::ExistsInObject) &&
+      args.size() == 2) {
+    const auto *key = dynamic_cast<const inja::LiteralNode *>(args[1].get());
+    if (key && (key->value.is_string() || key->value.is_number_integer())) {
+      auto base = reference(*args[0]);
+      if (!base) {
+        return std::nullopt;
+      }
+      return *base + "." +
+             (key->value.is_string() ? key->value.get<std::string>()
+                                     : key->value.dump());
+    }
+  }
+
+  // exists("page.title") names the variable in a string
+  if (node.operation == Op::Exists && args.size() == 1) {
+    const auto *name = dynamic_cast<const inja::LiteralNode *>(args[0].get());
+    if (name && name->value.is_string()) {
+      return resolve(name->value.get<std::string>());
+    }
+  }
+
+  // limit() and slice() pick elements without looking at them
+  if (node.operation == Op::Callback &&
+      (node.name == "limit" || node.name == "slice") && !args.empty()) {
+    for (size_t i = 1; i < args.size(); ++i) {
+      args[i]->accept(*this);
+    }
+    return reference(*args[0]);
+  }
+
+  for (const auto &arg : args) {
+    arg->accept(*this);
+  }
+  return std::nullopt;
+}
+
+void ReadSetAnalyzer::record(const std::string &path) {
+  // `posts.0` reads whichever element comes first: that depends on the
+  // order as well as on the elements themselves
+  std::string normalized;
+  for (std::string_view segment : DependencyGraph::path_segments(path)) {
+    bool index = std::all_of(segment.begin(), segment.end(),
+                             [](unsigned char c) { return std::isdigit(c); });
+    if (index) {
+      reads_.insert(normalized + "[#]");
+      normalized += "[*]";
+      continue;
+    }
+    if (!normalized.empty() && !segment.starts_with('[')) {
+      normalized += '.';
+    }
+    normalized += segment;
+  }
+
+  reads_.insert(std::move(normalized));
+}
+
+void ReadSetAnalyzer::walk_file(const std::string &name) {
+  // inja would recurse forever on a cycle; the reads are the same anyway
+  if (file_stack_.size() >= max_include_depth ||
+      std::find(file_stack_.begin(), file_stack_.end(), name) !=
+          file_stack_.end()) {
+    return;
+  }
+
+  const inja::Template *tmpl = loader_(name);
+  if (!tmpl) {
+    reads_.insert("");
+    return;
+  }
+
+  file_stack_.push_back(name);
+  tmpl->root.accept(*this);
+  file_stack_.pop_back();
+}
+
+RenderDemand RenderDemand::from_reads(const std::vector<std::string> &reads) {
+  RenderDemand demand;
+  demand.site = false;
+  demand.version = false;
+  demand.page_html_content = false;
+  demand.collections.clear();
+
+  for (const auto &read : reads) {
+    auto segments = DependencyGraph::path_segments(read);
+    if (segments.empty()) {
+      return RenderDemand();
+    }
+
+    // Any other root (content, locals the analysis couldn't place) isn't
+    // built by render_context()
+    if (segments[0] == "site") {
+      demand.site = true;
+    } else if (segments[0] == "version") {
+      demand.version = true;
+    } else if (segments[0] == "page") {
+      if (segments.size() < 2 || segments[1] == "html_content" ||
+          segments[1] == "*") {
+        demand.page_html_content = true;
+      }
+    } else if (segments[0] == "collections") {
+      std::string name = segments.size() < 2 ? "*" : std::string(segments[1]);
+      // `[#]` only needs the elements to exist; anything short of a named
+      // field other than html_content may reach it
+      bool html_content =
+          segments.size() < 3 ||
+          (segments[2] != "[#]" &&
+           (segments.size() < 4 || segments[3] == "html_content" ||
+            segments[3] == "*"));
+      demand.collections[name] |= html_content;
+    }
+  }
+
+  return demand;
+}
+
+std::optional<bool>
+RenderDemand::collection_html_content(const std::string &name) const {
+  auto it = collections.find(name);
+  auto all = collections.find("*");
+  if (it == collections.end() && all == collections.end()) {
+    return std::nullopt;
+  }
+
+  return (it != collections.end() && it->second) ||
+         (all != collections.end() && all->second);
+}
@@ -0,0 +1,109 @@
+#ifndef TEMPLATE_ANALYSIS_HPP
+#define TEMPLATE_ANALYSIS_HPP
+
+#include <functional>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <vendor/inja/inja.hpp>
+
+// Works out which render context paths a parsed template reads, in the
+// form DependencyGraph compares them (`page.title`, `collections.blog[#]`,
+// `collections.blog[*].date`). inja offers no hook into data lookups while
+// rendering, so this walks the template's syntax tree instead: loop and
+// set variables are traced back to the data they stand for, and included
+// templates are walked in place so they see the includer's variables.
+//
+// The result over-approximates what a render touches: both branches of an
+// if count, and a value passed to anything other than limit() or slice()
+// counts as read in full. `{% set x = page.author %}` reads nothing by
+// itself; reads of `x` afterwards are recorded as reads of `page.author`.
+// The cases that can't be traced that way fall back to coarser reads:
+//  - a name that branches or loops may leave bound to different data has
+//    each of them read in full where the paths meet
+//  - the value of a set into an object (`set a.b = ...`) is read in full
+//  - a set with no value to trace, or an include that can't be parsed,
+//    reads everything (the empty path)
+class ReadSetAnalyzer : public inja::NodeVisitor {
+public:
+  // Resolves an include or extends target. nullptr means it couldn't be
+  // parsed, which counts as reading everything.
+  using Loader = std::function<const inja::Template *(const std::string &)>;
+
+  explicit ReadSetAnalyzer(Loader loader) : loader_(std::move(loader)) {}
+
+  void analyze(const inja::Template &tmpl);
+
+  const std::set<std::string> &reads() const { return reads_; }
+
+  void visit(const inja::BlockNode &node) override;
+  void visit(const inja::TextNode &node) override;
+  void visit(const inja::ExpressionNode &node) override;
+  void visit(const inja::LiteralNode &node) override;
+  void visit(const inja::DataNode &node) override;
+  void visit(const inja::FunctionNode &node) override;
+  void visit(const inja::ExpressionListNode &node) override;
+  void visit(const inja::StatementNode &node) override;
+  void visit(const inja::ForStatementNode &node) override;
+  void visit(const inja::ForArrayStatementNode &node) override;
+  void visit(const inja::ForObjectStatementNode &node) override;
+  void visit(const inja::IfStatementNode &node) override;
+  void visit(const inja::IncludeStatementNode &node) override;
+  void visit(const inja::ExtendsStatementNode &node) override;
+  void visit(const inja::BlockStatementNode &node) override;
+  void visit(const inja::SetStatementNode &node) override;
+
+private:
+  static constexpr int max_include_depth = 16;
+
+  // The context path a variable name refers to; nullopt for variables that
+  // hold values computed inside the template, whose inputs were recorded
+  // when the value was computed
+  std::optional<std::string> resolve(const std::string &name) const;
+  // Same for an expression that passes data through unchanged. Anything
+  // else has its own reads recorded and yields nullopt.
+  std::optional<std::string> reference(const inja::ExpressionNode &expr);
+  std::optional<std::string> reference(const inja::FunctionNode &node);
+
+  // Name to the context path it stands for; nullopt marks a local value
+  using Binding = std::pair<std::string, std::optional<std::string>>;
+
+  // Walks a loop body as if it ran zero, one or more times
+  void walk_loop_body(const inja::BlockNode &body);
+  // Removes and returns the bindings made since `scope`
+  std::vector<Binding> take_bindings(size_t scope);
+  // Binds each name set by any of `alternatives`, one of which ran, on top
+  // of the bindings in place before them
+  void merge_bindings(const std::vector<std::vector<Binding>> &alternatives);
+
+  void record(const std::string &path);
+  void walk_file(const std::string &name);
+
+  Loader loader_;
+  std::set<std::string> reads_;
+  // Innermost last
+  std::vector<Binding> bindings_;
+  int loop_depth_ = 0;
+  std::vector<std::string> file_stack_;
+};
+
+// The parts of the render context a page's templates can reach, derived
+// from their reads. Defaults to everything, for pages nobody analyzed.
+struct RenderDemand {
+  bool site = true;
+  bool version = true;
+  bool page_html_content = true;
+  // Collection name to whether its elements need `html_content`; "*"
+  // covers every collection
+  std::unordered_map<std::string, bool> collections = {{"*", true}};
+
+  static RenderDemand from_reads(const std::vector<std::string> &reads);
+
+  // nullopt if the collection isn't read at all
+  std::optional<bool> collection_html_content(const std::string &name) const;
+};
+
+#endif
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <filesystem>
 #include <iomanip>
+#include <optional>
 #include <regex>
 #include <sstream>
 #include <string>
@@ -61,11 +62,13 @@ public:
   std::string render(const std::string &template_content, const json &data) {
 
     int max_attempts = 3;
-    json working_data = data;
+    // Only copied once a missing variable has to be patched in
+    std::optional<json> working_data;
 
     for (int attempt = 0; attempt < max_attempts; ++attempt) {
       try {
-        return env.render(template_content, working_data);
+        return env.render(template_content,
+                          working_data ? *working_data : data);
       } catch (const std::exception &e) {
         std::string error_msg = e.what();
 
@@ -81,7 +84,10 @@ public:
             std::cerr << "⚠️  Warning: Missing variable '" << var_path
                       << "'. Adding null value and retrying..." << std::endl;
 
-            add_missing_path(working_data, var_path);
+            if (!working_data) {
+              working_data = data;
+            }
+            add_missing_path(*working_data, var_path);
             continue;
           }
         }
@@ -94,6 +100,11 @@ public:
         "Template render failed after multiple recovery attempts");
   }
 
+  // Parsed with this engine's callbacks, so custom filters are known
+  inja::Template parse(const std::string &template_content) {
+    return env.parse(template_content);
+  }
+
   static void add_missing_path(json &data, const std::string &path) {
     std::vector<std::string> parts;
     std::istringstream iss(path);
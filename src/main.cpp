@@ -1,7 +1,13 @@
+#include "bench/bench.hpp"
+#include "bench/loadtest.hpp"
+#include "bench/stress.hpp"
 #include "core/site_builder.hpp"
 #include "server/dev_server.hpp"
 #include "server/preview_server.hpp"
 #include "utils/build_info.hpp"
+#include "utils/log.hpp"
+#include "utils/trace.hpp"
+#include "vendor/termcolor.hpp"
 #include <filesystem>
 #include <iostream>
 
@@ -12,9 +18,66 @@ void print_usage() {
   std::cout << "Commands:\n";
   std::cout << "  forge dev                 Start development server\n";
   std::cout << "  forge build               Build static site to ./dist\n";
+  std::cout << "    --incremental           Only rebuild pages whose inputs "
+               "changed\n";
+  std::cout << "    --trace <file>          Write a Chrome trace of the build "
+               "(Perfetto)\n";
+  std::cout << "    --report <file>         Write build timings and sizes as "
+               "JSON\n";
   std::cout
       << "  forge serve               Serve build static files in /dist\n";
-  std::cout << "  forge --help              Show this help\n";
+  std::cout << "    --watch                 Reload /dist when it is rebuilt\n";
+  std::cout << "  forge deps <url|path>     Show a page's inputs, or the pages "
+               "a file affects\n";
+  std::cout << "  forge bench               Time build phases on a generated "
+               "site\n";
+  std::cout << "    --pages N               Pages to generate (default 500)\n";
+  std::cout << "    --collections N         Collections (default 3)\n";
+  std::cout << "    --tags N                Distinct tags (default 20)\n";
+  std::cout << "    --words N               Words per page body (default "
+               "600)\n";
+  std::cout << "    --complexity 0-2        Template complexity (default 1)\n";
+  std::cout << "    --seed N                Corpus random seed (default 42)\n";
+  std::cout << "    --iterations N          Timed runs per phase (default 5)\n";
+  std::cout << "    --json <file>           Write results as JSON\n";
+  std::cout << "    --dir <path>            Keep the corpus in this empty "
+               "directory\n";
+  std::cout << "    --label <text>          Label stored with the results\n";
+  std::cout << "  forge stress              Run forge dev on a generated site "
+               "under many live\n"
+               "                            reload clients and bursts of "
+               "file changes\n";
+  std::cout << "    --clients N             WebSocket clients (default 100)\n";
+  std::cout << "    --bursts N              Bursts of file changes (default "
+               "10)\n";
+  std::cout << "    --files N               Files rewritten per burst "
+               "(default 200)\n";
+  std::cout << "    --settle MS             Quiet time that ends a burst "
+               "(default 1500)\n";
+  std::cout << "    --pause MS              Wait between bursts (default "
+               "500)\n";
+  std::cout << "    --pages N, --seed N     Generated site, as for bench\n";
+  std::cout << "    --json, --dir, --label  As for bench\n";
+  std::cout << "  forge loadtest            Replay the URLs of a built dist "
+               "against a server\n"
+               "                            over keep-alive connections\n";
+  std::cout << "    --dist <path>           Built site (default dist)\n";
+  std::cout << "    --host H, --port N      Server (default 127.0.0.1:8080)\n";
+  std::cout << "    --connections N         Keep-alive connections (default "
+               "64)\n";
+  std::cout << "    --threads N             Client threads (default: auto)\n";
+  std::cout << "    --duration S            Measured seconds (default 10)\n";
+  std::cout << "    --warmup S              Uncounted seconds first (default "
+               "1)\n";
+  std::cout << "    --serve                 Start forge serve for the run\n";
+  std::cout << "    --json, --label         As for bench\n";
+  std::cout << "  forge --help              Show this help\n\n";
+  std::cout << "Options for every command:\n";
+  std::cout << "  --quiet, -q               Print summaries and errors, not "
+               "every file,\n"
+               "                            page or request\n";
+  std::cout << "  --log-json <file>         Also write those lines to <file> "
+               "as JSON\n";
 }
 
 int main(int argc, char *argv[]) {
@@ -31,21 +94,219 @@ int main(int argc, char *argv[]) {
     return 0;
   }
 
+  // Taken out before the command reads its own arguments
+  int kept = 2;
+  for (int i = 2; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--quiet" || arg == "-q") {
+      Log::instance().set_level(LogLevel::Warn);
+    } else if (arg == "--log-json" && i + 1 < argc) {
+      fs::path log_path = argv[++i];
+      if (!Log::instance().open_json(log_path)) {
+        std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+                  << "Could not open " << log_path << "\n";
+        return 1;
+      }
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+
   try {
 
     if (command == "dev") {
       SiteBuilder builder(project_root);
 
-      builder.discover_content();
       BuildInfo::getInstance().generate_build_version();
+      builder.discover_content();
       builder.set_dev_mode(true);
       start_dev_server(builder, project_root);
     } else if (command == "build") {
+      bool incremental = false;
+      fs::path trace_path;
+      fs::path report_path;
+      for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--incremental") {
+          incremental = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+          trace_path = argv[++i];
+        } else if (arg == "--report" && i + 1 < argc) {
+          report_path = argv[++i];
+        }
+      }
+      if (!trace_path.empty()) {
+        Trace::instance().start();
+      }
+
       SiteBuilder builder(project_root);
       builder.discover_content();
-      builder.export_static_site();
+      builder.export_static_site(incremental);
+
+      if (!trace_path.empty()) {
+        size_t spans = Trace::instance().event_count();
+        if (!Trace::instance().write(trace_path)) {
+          std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+                    << "Could not write trace to " << trace_path << "\n";
+          return 1;
+        }
+        std::cout << termcolor::bright_green << "✓ " << termcolor::reset
+                  << "Trace of " << spans << " spans written to "
+                  << termcolor::bright_white << trace_path.string()
+                  << termcolor::reset << "\n";
+      }
+
+      const BuildReport &report = builder.report();
+      if (!report_path.empty()) {
+        if (!report.save(report_path)) {
+          std::cerr << termcolor::bright_red << "✗ Error: " << termcolor::reset
+                    << "Could not write report to " << report_path << "\n";
+          return 1;
+        }
+        std::cout << termcolor::bright_green << "✓ " << termcolor::reset
+                  << "Build report written to " << termcolor::bright_white
+                  << report_path.string() << termcolor::reset << "\n";
+      }
+
+      auto violations = report.over_budget(builder.get_config().budgets);
+      if (!violations.empty()) {
+        std::cerr << "\n"
+                  << termcolor::bright_red << "✗ Over budget"
+                  << termcolor::reset << "\n";
+        for (const auto &violation : violations) {
+          std::cerr << termcolor::bright_red << "  ✗ " << termcolor::reset
+                    << violation << "\n";
+        }
+        return 1;
+      }
+    } else if (command == "deps") {
+      if (argc < 3) {
+        std::cerr << "Usage: forge deps <url|path>" << std::endl;
+        return 1;
+      }
+      SiteBuilder builder(project_root);
+      builder.discover_content();
+      builder.print_dependencies(argv[2]);
     } else if (command == "serve") {
-      start_preview_server(project_root);
+      bool watch = false;
+      for (int i = 2; i < argc; ++i) {
+        if (std::string(argv[i]) == "--watch") {
+          watch = true;
+        }
+      }
+      start_preview_server(project_root, watch);
+    } else if (command == "bench") {
+      BenchOptions options;
+      for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+          std::cerr << "Missing value for " << arg << std::endl;
+          return 1;
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--pages") {
+          options.corpus.pages = std::stoul(value);
+        } else if (arg == "--collections") {
+          options.corpus.collections = std::stoul(value);
+        } else if (arg == "--tags") {
+          options.corpus.tags = std::stoul(value);
+        } else if (arg == "--words") {
+          options.corpus.body_words = std::stoul(value);
+        } else if (arg == "--complexity") {
+          options.corpus.template_complexity = std::stoi(value);
+        } else if (arg == "--seed") {
+          options.corpus.seed = static_cast<uint32_t>(std::stoul(value));
+        } else if (arg == "--iterations") {
+          options.iterations = std::stoi(value);
+        } else if (arg == "--json") {
+          options.json_path = value;
+        } else if (arg == "--dir") {
+          options.work_dir = value;
+        } else if (arg == "--label") {
+          options.label = value;
+        } else {
+          std::cerr << "Unknown bench option: " << arg << std::endl;
+          return 1;
+        }
+      }
+      return run_bench(options);
+    } else if (command == "stress") {
+      StressOptions options;
+      options.corpus.pages = 200;
+      for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+          std::cerr << "Missing value for " << arg << std::endl;
+          return 1;
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--clients") {
+          options.clients = std::stoul(value);
+        } else if (arg == "--bursts") {
+          options.bursts = std::stoul(value);
+        } else if (arg == "--files") {
+          options.burst_files = std::stoul(value);
+        } else if (arg == "--settle") {
+          options.settle_ms = std::stoi(value);
+        } else if (arg == "--pause") {
+          options.pause_ms = std::stoi(value);
+        } else if (arg == "--pages") {
+          options.corpus.pages = std::stoul(value);
+        } else if (arg == "--seed") {
+          options.corpus.seed = static_cast<uint32_t>(std::stoul(value));
+        } else if (arg == "--json") {
+          options.json_path = value;
+        } else if (arg == "--dir") {
+          options.work_dir = value;
+        } else if (arg == "--label") {
+          options.label = value;
+        } else {
+          std::cerr << "Unknown stress option: " << arg << std::endl;
+          return 1;
+        }
+      }
+      return run_stress(options);
+    } else if (command == "loadtest") {
+      LoadTestOptions options;
+      for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--serve") {
+          options.serve = true;
+          continue;
+        }
+        if (i + 1 >= argc) {
+          std::cerr << "Missing value for " << arg << std::endl;
+          return 1;
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--dist") {
+          options.dist = value;
+        } else if (arg == "--host") {
+          options.host = value;
+        } else if (arg == "--port") {
+          options.port = static_cast<unsigned short>(std::stoul(value));
+        } else if (arg == "--connections") {
+          options.connections = std::stoul(value);
+        } else if (arg == "--threads") {
+          options.threads = static_cast<unsigned>(std::stoul(value));
+        } else if (arg == "--duration") {
+          options.duration_s = std::stod(value);
+        } else if (arg == "--warmup") {
+          options.warmup_s = std::stod(value);
+        } else if (arg == "--json") {
+          options.json_path = value;
+        } else if (arg == "--label") {
+          options.label = value;
+        } else {
+          std::cerr << "Unknown loadtest option: " << arg << std::endl;
+          return 1;
+        }
+      }
+      return run_loadtest(options);
     } else {
       std::cerr << "Unknown command: " << command << std::endl;
       print_usage();
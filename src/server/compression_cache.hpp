@@ -0,0 +1,50 @@
+#pragma once
+
+#include "metrics.hpp"
+#include "utils/compression.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// gzip copies of rendered dev pages, one per URL. An entry is reused while
+// the build version (and rendered size) matches, so repeated loads between
+// edits only pay for compression once; a rebuild bumps the version and the
+// next request recompresses.
+class CompressionCache {
+public:
+  // Pages smaller than this are sent as-is; gzip framing would eat the gain.
+  static constexpr size_t min_size = 1024;
+
+  std::shared_ptr<const std::string> gzip(const std::string &url,
+                                          uint64_t version,
+                                          const std::string &body) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = entries_.find(url);
+      if (it != entries_.end() && it->second.version == version &&
+          it->second.source_size == body.size()) {
+        Metrics::instance().record_cache(Metrics::Cache::Compression, true);
+        return it->second.data;
+      }
+    }
+    Metrics::instance().record_cache(Metrics::Cache::Compression, false);
+
+    auto data = std::make_shared<const std::string>(gzip_compress(body, 6));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[url] = Entry{version, body.size(), data};
+    return data;
+  }
+
+private:
+  struct Entry {
+    uint64_t version;
+    size_t source_size;
+    std::shared_ptr<const std::string> data;
+  };
+
+  std::unordered_map<std::string, Entry> entries_;
+  std::mutex mutex_;
+};
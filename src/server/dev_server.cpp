@@ -1,17 +1,22 @@
 #include "dev_server.hpp"
+#include "compression_cache.hpp"
 #include "core/site_builder.hpp"
 #include "livereload.js.h"
+#include "reload_timings.hpp"
+#include "prerender_pool.hpp"
+#include "render_cache.hpp"
 #include "server.hpp"
 #include "utils/build_info.hpp"
 #include "utils/file_watcher_listener.hpp"
+#include "utils/log.hpp"
 #include "vendor/termcolor.hpp"
 #include "websocket_manager.hpp"
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
-#include <regex>
 #include <string>
 #include <thread>
 
@@ -47,105 +52,189 @@ void start_dev_server(SiteBuilder &builder, const fs::path &project_root) {
   WebSocketManager ws;
   ws_manager.store(&ws);
 
-  std::cout << termcolor::bright_cyan << "🔌 Starting WebSocket server..."
-            << termcolor::reset << "\n";
-
-  if (!ws.start(8081)) {
-    std::cerr << termcolor::bright_red << "✗ Failed to start WebSocket server"
-              << termcolor::reset << "\n";
-    return;
-  }
-
+  ws.start();
+  svr.Upgrade("/__livereload",
+              [&ws](tcp::socket socket,
+                    beast::http::request<beast::http::string_body> upgrade) {
+                ws.accept(std::move(socket), std::move(upgrade));
+              });
   std::cout << termcolor::bright_green << "✓ " << termcolor::reset
-            << "WebSocket server running on " << termcolor::bright_white
-            << "ws://localhost:8081" << termcolor::reset << "\n";
+            << "Live reload at " << termcolor::bright_white << "/__livereload"
+            << termcolor::reset << "\n";
 
-  svr.set_mount_point("/static", "./static");
+  svr.ServeMetrics();
   std::cout << termcolor::bright_green << "✓ " << termcolor::reset
-            << "Static files mounted at " << termcolor::bright_white
-            << "/static" << termcolor::reset << "\n";
+            << "Metrics at " << termcolor::bright_white << "/__forge/metrics"
+            << termcolor::reset << "\n";
 
-  svr.Get("/version", [](const Request &, Response &res) {
-    res.set_content(std::format("{{\"version\": {}}}",
-                                BuildInfo::getInstance().getVersion()),
+  // Percentiles of each stage between a save and the browser repainting
+  svr.Get("/__forge/reloads", [](const Request &, Response &res) {
+    res.set_content(ReloadTimings::instance().summary().dump(2),
                     "application/json");
+    res.headers["Cache-Control"] = "no-store";
   });
+  std::cout << termcolor::bright_green << "✓ " << termcolor::reset
+            << "Edit-to-paint timings at " << termcolor::bright_white
+            << "/__forge/reloads" << termcolor::reset << "\n";
 
-  svr.Get("/livereload.js", [](const Request &, Response &res) {
-    std::string script(
-        reinterpret_cast<const char *>(assets_livereload_script_min_js),
-        assets_livereload_script_min_js_len);
+  // The stylesheet hot swap builds its URLs from the same two values
+  const SiteConfig &config = builder.get_config();
+  svr.set_mount_point(SiteConfig::static_url,
+                      (project_root / config.static_dir).string());
+  std::cout << termcolor::bright_green << "✓ " << termcolor::reset
+            << "Static files mounted at " << termcolor::bright_white
+            << SiteConfig::static_url << termcolor::reset << "\n";
+
+  auto version_response = [](uint64_t version) {
+    return PreparedResponse::make(
+        200, std::format("{{\"version\": {}}}", version), "application/json",
+        {{"Cache-Control", "no-store"}});
+  };
+  svr.Prepared("/version",
+               version_response(BuildInfo::getInstance().getVersion()));
+
+  // The script connects back to whichever host served it
+  std::string script(
+      reinterpret_cast<const char *>(assets_livereload_script_min_js),
+      assets_livereload_script_min_js_len);
+  svr.Prepared("/livereload.js", PreparedResponse::make(200, std::move(script),
+                                                        "text/javascript"));
+
+  CompressionCache compression_cache;
+  RenderCache render_cache;
+
+  // Cached HTML is keyed by the version of the snapshot it was rendered
+  // from, so a request still holding the previous snapshot can't poison the
+  // cache for the new one.
+  auto render_cached = [&builder, &render_cache](const std::string &url,
+                                                 const SiteSnapshot &site,
+                                                 const PageInfo &page) {
+    if (auto html = render_cache.get(url, site.version)) {
+      return html;
+    }
 
-    script = std::regex_replace(
-        script, std::regex(R"(\{\{\s*livereload_ws_url\s*\}\})"),
-        "ws://localhost:8081");
-    res.set_content(script, "text/javascript");
-  });
+    auto html =
+        std::make_shared<const std::string>(builder.render_page(site, page));
+    render_cache.put(url, site.version, html);
+    return html;
+  };
+
+  auto send_html = [&compression_cache](const Request &req, Response &res,
+                                        const std::string &cache_key,
+                                        uint64_t version,
+                                        const std::string &html) {
+    if (html.size() >= CompressionCache::min_size &&
+        req.accepts_encoding("gzip")) {
+      auto compressed = compression_cache.gzip(cache_key, version, html);
+      res.set_content(*compressed, "text/html");
+      res.headers["Content-Encoding"] = "gzip";
+    } else {
+      res.set_content(html, "text/html");
+    }
+    res.headers["Vary"] = "Accept-Encoding";
+  };
 
   svr.Get(
       ".*",
-      [&builder](const Request &req, Response &res) {
+      [&builder, &send_html, &render_cached,
+       &render_cache](const Request &req, Response &res) {
         std::string url = req.path;
-        const auto &pages = builder.get_pages();
-        auto it = pages.find(url);
+        // Pinned for the whole request; a rebuild publishing meanwhile
+        // doesn't affect it
+        auto site = builder.snapshot();
 
-        if (it != pages.end()) {
+        if (const PageInfo *page = site->find(url)) {
+          render_cache.note_request(url);
           try {
-            std::string html = builder.render_page(it->second);
-            res.set_content(html, "text/html");
+            auto html = render_cached(url, *site, *page);
+            send_html(req, res, url, site->version, *html);
           } catch (const std::exception &e) {
             res.status = 500;
             res.set_content(std::format("Error rendering page: {}", e.what()),
                             "text/plain");
           }
         } else {
-          auto errorPage = pages.find("/404");
-          if (errorPage == pages.end()) {
+          const PageInfo *errorPage = site->find("/404");
+          if (!errorPage) {
             res.status = 404;
             res.set_content(
                 std::format("<h1>404 - Page Not Found</h1><p>URL: {}</p>", url),
                 "text/html");
           } else {
             res.status = 404;
-            std::string html = builder.render_page(errorPage->second);
-            res.set_content(html, "text/html");
+            auto html = render_cached("/404", *site, *errorPage);
+            send_html(req, res, "/404", site->version, *html);
           }
         }
       },
       true);
 
   svr.set_logger([](const Request &req, const Response &res) {
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    std::tm tm = *std::localtime(&time);
-
-    std::cout << termcolor::bright_blue << std::put_time(&tm, "%H:%M:%S")
-              << termcolor::reset << " " << termcolor::bright_cyan << req.method
-              << termcolor::reset << " " << termcolor::white << std::setw(30)
-              << std::left << req.path << termcolor::reset << " ";
-
-    if (res.status >= 200 && res.status < 300) {
-      std::cout << termcolor::bright_green;
-    } else if (res.status >= 300 && res.status < 400) {
-      std::cout << termcolor::bright_blue;
-    } else if (res.status >= 400 && res.status < 500) {
-      std::cout << termcolor::bright_yellow;
-    } else {
-      std::cout << termcolor::bright_red;
-    }
-
-    std::cout << res.status << termcolor::reset << " " << termcolor::bright_blue
-              << res.body.size() << "B" << termcolor::reset << "\n";
+    Log::instance().request(req.method, req.path, res.status,
+                            res.content_length());
   });
 
   std::cout << "\n"
             << termcolor::bright_cyan << "👁️  Setting up file watchers"
             << termcolor::reset << "\n";
 
+  // One thread per recent page at most; outlives the watcher that uses it
+  PrerenderPool prerender_pool(
+      std::clamp(std::thread::hardware_concurrency(), 1u, 8u));
   efsw::FileWatcher fileWatcher;
   DevServerListener listener(project_root, &builder);
+  // Runs on the watcher thread after each rebuild, before the reload is
+  // broadcast: the pages open in the browser are rendered again in parallel
+  // so the reload's fetch is answered from memory.
+  listener.set_rebuild_callback([&](uint64_t version) {
+    svr.Republish("/version", version_response(version));
+    render_cache.invalidate();
+
+    std::vector<std::string> urls = render_cache.recent_urls();
+    if (urls.empty()) {
+      return;
+    }
+
+    auto warm_start = std::chrono::high_resolution_clock::now();
+    auto site = builder.snapshot();
+    prerender_pool.run(urls.size(), [&](size_t i) {
+      const PageInfo *page = site->find(urls[i]);
+      if (!page) {
+        return;
+      }
+      try {
+        render_cached(urls[i], *site, *page);
+      } catch (const std::exception &) {
+        // Rendered (and reported) again when the browser asks for it
+      }
+    });
+
+    auto warm_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - warm_start);
+    std::cout << termcolor::bright_green << "  ✓ " << termcolor::reset
+              << "Pre-rendered " << termcolor::bright_white << urls.size()
+              << termcolor::reset << " recent pages in "
+              << warm_duration.count() << "ms\n";
+  });
+
+  // Reload messages carry the page itself; usually it was just pre-rendered
+  listener.set_page_renderer(
+      [&](const std::string &url) -> std::shared_ptr<const std::string> {
+        auto site = builder.snapshot();
+        const PageInfo *page = site->find(url);
+        if (!page) {
+          return nullptr;
+        }
+        try {
+          return render_cached(url, *site, *page);
+        } catch (const std::exception &) {
+          // The client fetches the page and gets the error from the server
+          return nullptr;
+        }
+      });
 
-  std::vector<std::string> folders = {"content", "templates", "static"};
+  std::vector<std::string> folders = {config.content_dir, config.templates_dir,
+                                     config.static_dir};
   int watch_count = 0;
 
   for (const auto &folder : folders) {
@@ -173,11 +262,12 @@ void start_dev_server(SiteBuilder &builder, const fs::path &project_root) {
             << termcolor::bright_cyan << "📄 Available routes"
             << termcolor::reset << "\n";
 
-  for (const auto &[url, page] : builder.get_pages()) {
+  auto initial_site = builder.snapshot();
+  for (const auto &[url, page] : initial_site->pages) {
     std::cout << termcolor::bright_blue << "  → " << termcolor::reset
               << termcolor::cyan << std::setw(30) << std::left << url
               << termcolor::reset << termcolor::bright_blue << "("
-              << page.content_type << ")" << termcolor::reset << "\n";
+              << page->content_type << ")" << termcolor::reset << "\n";
   }
 
   std::cout << "\n"
@@ -192,11 +282,11 @@ void start_dev_server(SiteBuilder &builder, const fs::path &project_root) {
             << termcolor::bright_green << "║" << termcolor::reset << "\n";
   std::cout << termcolor::bright_green << "║  " << termcolor::reset
             << "WebSocket:  " << termcolor::bright_white << std::setw(28)
-            << std::left << "ws://localhost:8081" << termcolor::reset
+            << std::left << "/__livereload (same port)" << termcolor::reset
             << termcolor::bright_green << "║" << termcolor::reset << "\n";
   std::cout << termcolor::bright_green << "║  " << termcolor::reset
             << "Pages:      " << termcolor::bright_white << std::setw(28)
-            << std::left << std::to_string(builder.get_pages().size())
+            << std::left << std::to_string(initial_site->pages.size())
             << termcolor::reset << termcolor::bright_green << "║"
             << termcolor::reset << "\n";
   std::cout << termcolor::bright_green << "║  " << termcolor::reset
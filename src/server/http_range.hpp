@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// An inclusive byte range, as written in Range and Content-Range headers.
+struct ByteRange {
+  size_t first;
+  size_t last;
+
+  size_t length() const { return last - first + 1; }
+};
+
+enum class RangeResult { Full, Partial, Unsatisfiable };
+
+// More ranges than this in one request is treated as abuse and answered
+// with the full entity instead.
+inline constexpr size_t max_byte_ranges = 16;
+
+inline std::optional<size_t> parse_range_number(const std::string &text) {
+  if (text.empty() || text.size() > 19 ||
+      text.find_first_not_of("0123456789") != std::string::npos) {
+    return std::nullopt;
+  }
+  return static_cast<size_t>(std::stoull(text));
+}
+
+// Resolves a `Range: bytes=...` header against an entity of `size` bytes.
+// Malformed headers, including one that lists no range at all, yield Full
+// (the header is ignored, per RFC 9110), and a well-formed header with no
+// satisfiable range yields Unsatisfiable.
+inline RangeResult parse_range_header(const std::string &header, size_t size,
+                                      std::vector<ByteRange> &ranges) {
+  ranges.clear();
+
+  const std::string unit = "bytes=";
+  if (header.compare(0, unit.size(), unit) != 0) {
+    return RangeResult::Full;
+  }
+
+  // Empty list elements are allowed, but at least one range is required
+  size_t specs = 0;
+  size_t pos = unit.size();
+  while (pos < header.size()) {
+    size_t comma = header.find(',', pos);
+    if (comma == std::string::npos) {
+      comma = header.size();
+    }
+
+    std::string spec = header.substr(pos, comma - pos);
+    pos = comma + 1;
+
+    size_t begin = spec.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+      continue;
+    }
+    spec = spec.substr(begin, spec.find_last_not_of(" \t") - begin + 1);
+    specs++;
+
+    size_t dash = spec.find('-');
+    if (dash == std::string::npos) {
+      ranges.clear();
+      return RangeResult::Full;
+    }
+
+    std::string first_text = spec.substr(0, dash);
+    std::string last_text = spec.substr(dash + 1);
+
+    if (first_text.empty()) {
+      // Suffix range: the final N bytes
+      auto suffix = parse_range_number(last_text);
+      if (!suffix) {
+        ranges.clear();
+        return RangeResult::Full;
+      }
+      if (*suffix == 0 || size == 0) {
+        continue;
+      }
+      ranges.push_back({*suffix >= size ? 0 : size - *suffix, size - 1});
+    } else {
+      auto first = parse_range_number(first_text);
+      auto last = last_text.empty() ? std::optional<size_t>(SIZE_MAX)
+                                    : parse_range_number(last_text);
+      if (!first || !last || *last < *first) {
+        ranges.clear();
+        return RangeResult::Full;
+      }
+      if (*first >= size) {
+        continue;
+      }
+      ranges.push_back({*first, std::min(*last, size - 1)});
+    }
+
+    if (ranges.size() > max_byte_ranges) {
+      ranges.clear();
+      return RangeResult::Full;
+    }
+  }
+
+  if (specs == 0) {
+    return RangeResult::Full;
+  }
+  return ranges.empty() ? RangeResult::Unsatisfiable : RangeResult::Partial;
+}
+
+inline std::string format_http_date(std::time_t time) {
+  std::tm tm{};
+  gmtime_r(&time, &tm);
+
+  char buffer[64];
+  std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+  return buffer;
+}
+
+inline std::string last_modified_header(const std::filesystem::path &path) {
+  auto file_time = std::filesystem::last_write_time(path);
+  auto system_time = std::chrono::file_clock::to_sys(file_time);
+  return format_http_date(std::chrono::system_clock::to_time_t(
+      std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+          system_time)));
+}
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// Counters kept as one slot per thread shard, each shard on its own cache
+// lines. A thread only ever adds to its own shard with a relaxed atomic, so
+// instrumenting the request path doesn't make the io_context threads
+// contend; reading sums the shards and is only done when scraped.
+inline constexpr size_t metrics_shard_count = 16;
+
+inline size_t metrics_shard() {
+  static std::atomic<size_t> next_shard{0};
+  static thread_local size_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) %
+      metrics_shard_count;
+  return shard;
+}
+
+// `N` counters sharing each shard. Values are signed so a gauge can be kept
+// as adds of +1 and -1 from different threads.
+template <size_t N> class ShardedCounters {
+public:
+  void add(size_t index, int64_t n = 1) {
+    shards_[metrics_shard()].values[index].fetch_add(
+        n, std::memory_order_relaxed);
+  }
+
+  int64_t value(size_t index) const {
+    int64_t total = 0;
+    for (const auto &shard : shards_) {
+      total += shard.values[index].load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+private:
+  struct alignas(64) Shard {
+    std::array<std::atomic<int64_t>, N> values{};
+  };
+
+  std::array<Shard, metrics_shard_count> shards_;
+};
+
+class ShardedCounter {
+public:
+  void add(int64_t n = 1) { counters_.add(0, n); }
+  int64_t value() const { return counters_.value(0); }
+
+private:
+  ShardedCounters<1> counters_;
+};
+
+// Observations in seconds, counted into fixed buckets. The sum is kept in
+// microseconds so it can be an integer counter like the rest.
+class Histogram {
+public:
+  static constexpr size_t max_buckets = 16;
+
+  Histogram(std::initializer_list<double> bounds) : bounds_(bounds) {
+    bounds_.resize(std::min(bounds_.size(), max_buckets));
+  }
+
+  void observe(double seconds) {
+    size_t bucket =
+        std::lower_bound(bounds_.begin(), bounds_.end(), seconds) -
+        bounds_.begin();
+    counts_.add(bucket);
+    counts_.add(sum_slot, static_cast<int64_t>(seconds * 1e6));
+  }
+
+  void observe(std::chrono::steady_clock::duration elapsed) {
+    observe(std::chrono::duration<double>(elapsed).count());
+  }
+
+  // Appends the _bucket, _sum and _count series in the Prometheus text format
+  void render(std::string &out, const std::string &name,
+              const std::string &help) const {
+    out += std::format("# HELP {} {}\n# TYPE {} histogram\n", name, help, name);
+    int64_t cumulative = 0;
+    for (size_t i = 0; i < bounds_.size(); ++i) {
+      cumulative += counts_.value(i);
+      out += std::format("{}_bucket{{le=\"{}\"}} {}\n", name, bounds_[i],
+                         cumulative);
+    }
+    cumulative += counts_.value(bounds_.size());
+    out += std::format("{}_bucket{{le=\"+Inf\"}} {}\n", name, cumulative);
+    out += std::format("{}_sum {}\n", name,
+                       static_cast<double>(counts_.value(sum_slot)) / 1e6);
+    out += std::format("{}_count {}\n", name, cumulative);
+  }
+
+private:
+  // Slots 0..max_buckets hold the buckets and the overflow (+Inf) bucket
+  static constexpr size_t sum_slot = max_buckets + 1;
+
+  std::vector<double> bounds_;
+  ShardedCounters<max_buckets + 2> counts_;
+};
+
+// Everything `/__forge/metrics` reports, shared by whichever server runs in
+// this process. Always on: recording is a relaxed add to a per-thread slot.
+class Metrics {
+public:
+  enum class Cache { Render, Compression };
+
+  static Metrics &instance() {
+    static Metrics metrics;
+    return metrics;
+  }
+
+  void record_response(int status, size_t bytes,
+                       std::chrono::steady_clock::duration elapsed) {
+    responses_.add(std::clamp(status, 0, max_status));
+    response_bytes_.add(static_cast<int64_t>(bytes));
+    request_duration_.observe(elapsed);
+  }
+
+  void connection_opened() { open_connections_.add(1); }
+  void connection_closed() { open_connections_.add(-1); }
+
+  void record_cache(Cache cache, bool hit) {
+    cache_lookups_.add(static_cast<size_t>(cache) * 2 + (hit ? 0 : 1));
+  }
+
+  void record_rebuild(std::chrono::steady_clock::duration elapsed) {
+    rebuild_duration_.observe(elapsed);
+  }
+  void record_rebuild_failure() { rebuild_failures_.add(); }
+
+  // Negative when clients leave
+  void add_websocket_clients(int64_t n) { websocket_clients_.add(n); }
+
+  // Time from a broadcast starting until one client's copy was written
+  void record_broadcast(std::chrono::steady_clock::duration elapsed) {
+    broadcast_latency_.observe(elapsed);
+  }
+
+  // Time from a file change being seen until a client had patched its page
+  void record_edit_to_paint(double seconds) {
+    edit_to_paint_.observe(seconds);
+  }
+
+  // The Prometheus text exposition format (version 0.0.4)
+  std::string render() const {
+    std::string out;
+
+    out += "# HELP forge_http_requests_total HTTP responses sent, by status."
+           "\n# TYPE forge_http_requests_total counter\n";
+    for (int status = 0; status <= max_status; ++status) {
+      if (int64_t count = responses_.value(status)) {
+        out += std::format("forge_http_requests_total{{status=\"{}\"}} {}\n",
+                           status, count);
+      }
+    }
+
+    request_duration_.render(out, "forge_http_request_duration_seconds",
+                             "Time from a request being read until its "
+                             "response was written.");
+    counter(out, "forge_http_response_bytes_total",
+            "Bytes written in HTTP responses, heads included.",
+            response_bytes_.value());
+    gauge(out, "forge_http_open_connections",
+          "HTTP connections currently open.", open_connections_.value());
+
+    constexpr Cache caches[] = {Cache::Render, Cache::Compression};
+    auto cache_name = [](Cache cache) {
+      return cache == Cache::Render ? "render" : "compression";
+    };
+    auto lookups = [this](Cache cache, bool hit) {
+      return cache_lookups_.value(static_cast<size_t>(cache) * 2 +
+                                  (hit ? 0 : 1));
+    };
+
+    out += "# HELP forge_cache_lookups_total Lookups in the dev server's "
+           "caches, by result.\n# TYPE forge_cache_lookups_total counter\n";
+    for (Cache cache : caches) {
+      out += std::format(
+          "forge_cache_lookups_total{{cache=\"{}\",result=\"hit\"}} {}\n"
+          "forge_cache_lookups_total{{cache=\"{}\",result=\"miss\"}} {}\n",
+          cache_name(cache), lookups(cache, true), cache_name(cache),
+          lookups(cache, false));
+    }
+
+    out += "# HELP forge_cache_hit_ratio Share of cache lookups that hit.\n"
+           "# TYPE forge_cache_hit_ratio gauge\n";
+    for (Cache cache : caches) {
+      int64_t hits = lookups(cache, true);
+      int64_t total = hits + lookups(cache, false);
+      double ratio = total == 0 ? 0.0
+                                : static_cast<double>(hits) /
+                                      static_cast<double>(total);
+      out += std::format("forge_cache_hit_ratio{{cache=\"{}\"}} {}\n",
+                         cache_name(cache), ratio);
+    }
+
+    rebuild_duration_.render(out, "forge_rebuild_duration_seconds",
+                             "Dev server rebuilds after file changes.");
+    counter(out, "forge_rebuild_failures_total",
+            "Dev server rebuilds that failed.", rebuild_failures_.value());
+
+    gauge(out, "forge_websocket_clients",
+          "Live reload clients currently connected.",
+          websocket_clients_.value());
+    broadcast_latency_.render(out, "forge_websocket_broadcast_latency_seconds",
+                              "Time from a live reload broadcast until a "
+                              "client's copy was written.");
+    edit_to_paint_.render(out, "forge_edit_to_paint_seconds",
+                          "Time from a file change being seen until a live "
+                          "reload client had patched its page.");
+
+    return out;
+  }
+
+private:
+  static constexpr int max_status = 599;
+
+  Metrics() = default;
+
+  static void counter(std::string &out, const char *name, const char *help,
+                      int64_t value) {
+    out += std::format("# HELP {} {}\n# TYPE {} counter\n{} {}\n", name, help,
+                       name, name, value);
+  }
+
+  static void gauge(std::string &out, const char *name, const char *help,
+                    int64_t value) {
+    out += std::format("# HELP {} {}\n# TYPE {} gauge\n{} {}\n", name, help,
+                       name, name, value);
+  }
+
+  ShardedCounters<max_status + 1> responses_;
+  ShardedCounter response_bytes_;
+  ShardedCounter open_connections_;
+  Histogram request_duration_{0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+                              0.05,   0.1,   0.25,   0.5,   1,    2.5};
+
+  // Hit, then miss, for each Cache
+  ShardedCounters<4> cache_lookups_;
+
+  Histogram rebuild_duration_{0.01, 0.025, 0.05, 0.1, 0.25,
+                              0.5,  1,     2.5,  5,   10};
+  ShardedCounter rebuild_failures_;
+
+  ShardedCounter websocket_clients_;
+  Histogram broadcast_latency_{0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+                               0.05,   0.1,   0.25,   0.5,   1};
+  Histogram edit_to_paint_{0.025, 0.05, 0.1, 0.15, 0.25, 0.5,
+                           1,     2.5,  5,   10};
+};
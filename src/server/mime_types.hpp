@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// MIME type lookup by file extension through a perfect hash table that is
+// built entirely at compile time: each known extension lands in its own
+// slot, so a lookup is one hash, one probe and one string compare.
+namespace mime {
+
+struct Entry {
+  std::string_view extension;
+  std::string_view type;
+};
+
+inline constexpr Entry entries[] = {
+    {"html", "text/html"},
+    {"htm", "text/html"},
+    {"css", "text/css"},
+    {"js", "application/javascript"},
+    {"mjs", "application/javascript"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"webmanifest", "application/manifest+json"},
+    {"xml", "application/xml"},
+    {"txt", "text/plain"},
+    {"md", "text/plain"},
+    {"pdf", "application/pdf"},
+    {"wasm", "application/wasm"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"avif", "image/avif"},
+    {"svg", "image/svg+xml"},
+    {"ico", "image/x-icon"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"otf", "font/otf"},
+    {"mp4", "video/mp4"},
+    {"webm", "video/webm"},
+    {"mp3", "audio/mpeg"},
+    {"ogg", "audio/ogg"},
+    {"wav", "audio/wav"},
+    {"m4a", "audio/mp4"},
+};
+
+inline constexpr std::string_view default_type = "application/octet-stream";
+
+inline constexpr size_t entry_count = sizeof(entries) / sizeof(entries[0]);
+inline constexpr size_t table_size = 128;
+inline constexpr size_t max_extension_length = 16;
+
+static_assert((table_size & (table_size - 1)) == 0,
+              "table_size must be a power of two");
+static_assert(entry_count < table_size);
+
+constexpr uint32_t hash(std::string_view text, uint32_t seed) {
+  uint32_t h = 2166136261u ^ seed;
+  for (char c : text) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 16777619u;
+  }
+  return h ^ (h >> 15);
+}
+
+// Tries seeds until every extension hashes to a distinct slot.
+consteval uint32_t find_seed() {
+  for (uint32_t seed = 1; seed < 100000; ++seed) {
+    std::array<bool, table_size> used{};
+    bool collision = false;
+
+    for (const auto &entry : entries) {
+      size_t slot = hash(entry.extension, seed) & (table_size - 1);
+      if (used[slot]) {
+        collision = true;
+        break;
+      }
+      used[slot] = true;
+    }
+
+    if (!collision) {
+      return seed;
+    }
+  }
+  return 0;
+}
+
+inline constexpr uint32_t seed = find_seed();
+static_assert(seed != 0, "no perfect hash seed found for the MIME table");
+
+consteval std::array<int8_t, table_size> build_slots() {
+  std::array<int8_t, table_size> slots{};
+  for (auto &slot : slots) {
+    slot = -1;
+  }
+  for (size_t i = 0; i < entry_count; ++i) {
+    slots[hash(entries[i].extension, seed) & (table_size - 1)] =
+        static_cast<int8_t>(i);
+  }
+  return slots;
+}
+
+inline constexpr std::array<int8_t, table_size> slots = build_slots();
+
+// Returns the MIME type for `path` based on its extension (case-insensitive).
+inline std::string_view lookup(std::string_view path) {
+  size_t dot = path.rfind('.');
+  size_t slash = path.rfind('/');
+  if (dot == std::string_view::npos ||
+      (slash != std::string_view::npos && slash > dot)) {
+    return default_type;
+  }
+
+  std::string_view extension = path.substr(dot + 1);
+  if (extension.empty() || extension.size() > max_extension_length) {
+    return default_type;
+  }
+
+  char lower[max_extension_length];
+  for (size_t i = 0; i < extension.size(); ++i) {
+    char c = extension[i];
+    lower[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+  }
+  std::string_view key(lower, extension.size());
+
+  int8_t index = slots[hash(key, seed) & (table_size - 1)];
+  if (index < 0 || entries[index].extension != key) {
+    return default_type;
+  }
+  return entries[index].type;
+}
+
+} // namespace mime
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads kept for re-rendering the recent pages after each rebuild. They
+// live as long as the dev server, so a save costs neither thread creation
+// nor a fresh thread_local TemplateEngine per page.
+class PrerenderPool {
+public:
+  explicit PrerenderPool(size_t threads) {
+    for (size_t i = 0; i < threads; ++i) {
+      threads_.emplace_back([this]() { work(); });
+    }
+  }
+
+  ~PrerenderPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto &thread : threads_) {
+      thread.join();
+    }
+  }
+
+  PrerenderPool(const PrerenderPool &) = delete;
+  PrerenderPool &operator=(const PrerenderPool &) = delete;
+
+  // Calls `job(i)` for every i below `count` on the pool's threads and
+  // returns once all have finished. `job` must not throw; one caller at a
+  // time.
+  void run(size_t count, const std::function<void(size_t)> &job) {
+    if (count == 0) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_ = &job;
+    count_ = count;
+    next_ = 0;
+    finished_ = 0;
+    wake_.notify_all();
+    done_.wait(lock, [this]() { return finished_ == count_; });
+    job_ = nullptr;
+    count_ = 0;
+  }
+
+private:
+  void work() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      wake_.wait(lock, [this]() { return stopping_ || next_ < count_; });
+      if (stopping_) {
+        return;
+      }
+
+      size_t index = next_++;
+      const auto &job = *job_;
+      lock.unlock();
+      job(index);
+      lock.lock();
+
+      if (++finished_ == count_) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(size_t)> *job_ = nullptr;
+  size_t count_ = 0;
+  size_t next_ = 0;
+  size_t finished_ = 0;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
@@ -1,31 +1,38 @@
 #include "preview_server.hpp"
 #include "server.hpp"
+#include "site_image.hpp"
+#include "utils/log.hpp"
 #include "vendor/termcolor.hpp"
+#include <atomic>
 #include <chrono>
+#include <efsw/efsw.hpp>
 #include <filesystem>
 #include <iomanip>
 #include <iostream>
-#include <optional>
+#include <memory>
 #include <print>
 #include <thread>
 
-static bool ends_with(const std::string &str, const std::string &suffix) {
-  if (suffix.length() > str.length())
-    return false;
-  return str.compare(str.length() - suffix.length(), suffix.length(), suffix) ==
-         0;
-}
-
-static std::optional<std::string> read_file(const std::string &filename) {
-  std::ifstream file(filename);
+// Records when `dist` last changed. A build rewrites many files in a burst,
+// so the image is only reloaded once the directory has been quiet for a bit.
+class DistWatchListener : public efsw::FileWatchListener {
+public:
+  void handleFileAction(efsw::WatchID, const std::string &,
+                        const std::string &, efsw::Action,
+                        std::string = "") override {
+    last_change_ms.store(now_ms());
+    dirty.store(true);
+  }
 
-  if (!file.is_open()) {
-    return std::nullopt;
+  static int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
   }
 
-  return std::string((std::istreambuf_iterator<char>(file)),
-                     std::istreambuf_iterator<char>());
-}
+  std::atomic<bool> dirty{false};
+  std::atomic<int64_t> last_change_ms{0};
+};
 
 static std::string get_timestamp() {
   auto now = std::chrono::system_clock::now();
@@ -40,39 +47,6 @@ static std::string get_timestamp() {
   return ss.str();
 }
 
-static void log_request(const std::string &method, const std::string &path,
-                        int status) {
-
-  std::cout << termcolor::bright_blue << "[" << get_timestamp() << "]"
-            << termcolor::reset << " ";
-
-  if (method == "GET") {
-    std::cout << termcolor::bright_cyan;
-  } else if (method == "POST") {
-    std::cout << termcolor::bright_yellow;
-  } else if (method == "PUT") {
-    std::cout << termcolor::bright_magenta;
-  } else if (method == "DELETE") {
-    std::cout << termcolor::bright_red;
-  }
-  std::cout << method << termcolor::reset << " ";
-
-  std::cout << termcolor::white << path << termcolor::reset << " ";
-
-  if (status >= 200 && status < 300) {
-    std::cout << termcolor::bright_green;
-  } else if (status >= 300 && status < 400) {
-    std::cout << termcolor::bright_yellow;
-  } else if (status >= 400 && status < 500) {
-    std::cout << termcolor::bright_red;
-  } else if (status >= 500) {
-    std::cout << termcolor::red << termcolor::bold;
-  }
-  std::cout << status << termcolor::reset;
-
-  std::cout << std::endl;
-}
-
 static std::string format_size(size_t bytes) {
   const char *units[] = {"B", "KB", "MB", "GB"};
   int unit = 0;
@@ -88,11 +62,10 @@ static std::string format_size(size_t bytes) {
   return ss.str();
 }
 
-void start_preview_server(const fs::path &project_root) {
+void start_preview_server(const fs::path &project_root, bool watch) {
   Server svr;
 
   std::filesystem::path dist_path{project_root / "dist"};
-  std::filesystem::path static_path{project_root / "dist" / "static"};
 
   if (!std::filesystem::exists(dist_path)) {
     std::cout << "\n"
@@ -105,67 +78,28 @@ void start_preview_server(const fs::path &project_root) {
     exit(1);
   }
 
-  size_t total_size = 0;
-  size_t file_count = 0;
-  for (const auto &entry :
-       std::filesystem::recursive_directory_iterator(dist_path)) {
-    if (entry.is_regular_file()) {
-      total_size += entry.file_size();
-      file_count++;
-    }
-  }
-
-  svr.set_mount_point("/static", "./dist/static");
+  std::atomic<std::shared_ptr<const SiteImage>> image{
+      SiteImage::load(dist_path)};
 
   svr.set_logger([](const Request &req, const Response &res) {
-    log_request(req.method, req.path, res.status);
+    Log::instance().request(req.method, req.path, res.status,
+                            res.content_length());
   });
 
+  svr.ServeMetrics();
+
   svr.Get(
       ".*",
-      [](const Request &req, Response &res) {
-        std::string url = req.path;
-
-        if (url == "/") {
-          auto html = read_file("./dist/index.html");
-          if (html) {
-            res.set_content(html->c_str(), "text/html");
-          } else {
-            res.status = 500;
-            res.set_content("<h1>500 - Error loading page</h1>", "text/html");
-          }
-          return;
-        }
-
-        if (url.length() > 1 && url.back() == '/') {
-          url.pop_back();
-        }
-
-        std::string file_path;
-        if (ends_with(url, ".html")) {
-          file_path = "./dist" + url;
-        } else {
-          file_path = "./dist" + url + "/index.html";
-        }
+      [&image](const Request &req, Response &res) {
+        std::shared_ptr<const SiteImage> current = image.load();
 
-        auto html = read_file(file_path);
-        if (html) {
-          res.set_content(html->c_str(), "text/html");
-        } else {
-
-          auto error_page = read_file("./dist/404/index.html");
-          res.status = 404;
-          if (!error_page) {
-            res.set_content("<h1>404 - Page Not Found</h1><p>The page you're "
-                            "looking for doesn't exist.</p>",
-                            "text/html");
-          } else {
-            res.set_content(error_page->c_str(), "text/html");
-          }
-        }
+        const ImageEntry *entry = current->find(req.path);
+        serve_image_entry(entry ? *entry : current->not_found(), req, res);
       },
       true);
 
+  std::shared_ptr<const SiteImage> loaded = image.load();
+
   std::cout << "\n"
             << termcolor::bright_cyan
             << "╔════════════════════════════════════════╗\n"
@@ -179,8 +113,70 @@ void start_preview_server(const fs::path &project_root) {
             << "Directory: " << termcolor::white << dist_path
             << termcolor::reset << "\n";
   std::cout << termcolor::bright_blue << "    " << termcolor::reset
-            << "Files: " << termcolor::white << file_count << termcolor::reset
-            << " (" << format_size(total_size) << ")\n\n";
+            << "Files: " << termcolor::white << loaded->file_count()
+            << termcolor::reset << " (" << format_size(loaded->total_bytes())
+            << " preloaded";
+  if (loaded->streamed_count() > 0) {
+    std::cout << ", " << loaded->streamed_count()
+              << " streamed from disk";
+  }
+  std::cout << ")\n\n";
+
+  efsw::FileWatcher file_watcher;
+  DistWatchListener listener;
+  efsw::WatchID watch_id = 0;
+  std::atomic<bool> watching{watch};
+  std::thread reload_thread;
+
+  if (watch) {
+    watch_id = file_watcher.addWatch(dist_path.string(), &listener, true);
+    file_watcher.watch();
+
+    reload_thread = std::thread([&]() {
+      while (watching.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        if (!listener.dirty.load() ||
+            DistWatchListener::now_ms() - listener.last_change_ms.load() <
+                250) {
+          continue;
+        }
+        listener.dirty.store(false);
+
+        if (!std::filesystem::exists(dist_path)) {
+          continue;
+        }
+
+        try {
+          auto start = std::chrono::high_resolution_clock::now();
+          std::shared_ptr<const SiteImage> rebuilt =
+              SiteImage::load(dist_path);
+          image.store(rebuilt);
+          auto duration =
+              std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::high_resolution_clock::now() - start);
+
+          std::cout << termcolor::bright_blue << "[" << get_timestamp() << "]"
+                    << termcolor::reset << " " << termcolor::bright_green
+                    << "↻ Reloaded " << termcolor::reset
+                    << rebuilt->file_count() << " files ("
+                    << format_size(rebuilt->total_bytes()) << ") in "
+                    << duration.count() << "ms\n";
+        } catch (const std::exception &e) {
+          std::cerr << termcolor::bright_red << "✗ Reload failed: "
+                    << termcolor::reset << e.what() << "\n";
+        }
+
+        // A rebuild deletes and recreates dist, which drops the old watch
+        file_watcher.removeWatch(watch_id);
+        watch_id = file_watcher.addWatch(dist_path.string(), &listener, true);
+      }
+    });
+
+    std::cout << termcolor::bright_green << "  ✓ " << termcolor::reset
+              << "Watching " << termcolor::white << dist_path
+              << termcolor::reset << " for rebuilds\n\n";
+  }
 
   std::cout << termcolor::bright_green << "  ✓ " << termcolor::reset
             << "Server started\n";
@@ -189,7 +185,11 @@ void start_preview_server(const fs::path &project_root) {
             << termcolor::reset << "\n";
   std::cout << termcolor::bright_blue << "    " << termcolor::reset
             << "Network: " << termcolor::bright_cyan << "http://0.0.0.0:8080"
-            << termcolor::reset << "\n\n";
+            << termcolor::reset << "\n";
+  std::cout << termcolor::bright_blue << "    " << termcolor::reset
+            << "Metrics: " << termcolor::bright_cyan
+            << "http://localhost:8080/__forge/metrics" << termcolor::reset
+            << "\n\n";
 
   std::cout << termcolor::bright_blue
             << "───────────────────────────────────────────\n"
@@ -207,6 +207,11 @@ void start_preview_server(const fs::path &project_root) {
   std::cout << termcolor::yellow << "\n⏳ Shutting down..." << termcolor::reset
             << "\n";
 
+  watching = false;
+  if (reload_thread.joinable()) {
+    reload_thread.join();
+  }
+
   svr.stop();
 
   if (server_thread.joinable()) {
@@ -215,4 +220,4 @@ void start_preview_server(const fs::path &project_root) {
 
   std::cout << termcolor::bright_green << "✓ Server stopped cleanly"
             << termcolor::reset << "\n\n";
-}
\ No newline at end of file
+}
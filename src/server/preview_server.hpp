@@ -8,7 +8,8 @@ class SiteBuilder;
 
 namespace fs = std::filesystem;
 
-// Start the preview server
-void start_preview_server(const fs::path &project_root);
+// Start the preview server. With `watch`, the in-memory copy of dist is
+// reloaded and swapped in whenever a new build lands.
+void start_preview_server(const fs::path &project_root, bool watch = false);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "metrics.hpp"
+#include "utils/log.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <vendor/nlohmann/json.hpp>
+
+// Where the time goes between saving a file and seeing it in the browser.
+// The rebuild stamps each stage of a change under its build version; every
+// live reload client then reports how long it spent fetching and patching
+// the page, which completes one sample. Only recent samples are kept, so
+// the percentiles describe the current session rather than its history.
+class ReloadTimings {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  enum Stage { Detect, Rebuild, Render, Notify, Fetch, Patch, stage_count };
+
+  static constexpr const char *stage_names[stage_count] = {
+      "detect", "rebuild", "render", "notify", "fetch", "patch"};
+
+  // One client's view of one change, in milliseconds per stage
+  struct Breakdown {
+    uint64_t version = 0;
+    std::array<double, stage_count> stages{};
+
+    double total() const {
+      double sum = 0;
+      for (double stage : stages) {
+        sum += stage;
+      }
+      return sum;
+    }
+  };
+
+  static ReloadTimings &instance() {
+    static ReloadTimings timings;
+    return timings;
+  }
+
+  // The rebuild for `version` began at `started`; the watcher saw its
+  // first event at `first_seen`
+  void begin(uint64_t version, Clock::time_point first_seen,
+             Clock::time_point started) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Change &change = changes_[version];
+    change.first_seen = std::min(first_seen, started);
+    change.started = change.rebuilt = change.rendered = change.notified =
+        started;
+    while (changes_.size() > max_changes) {
+      changes_.erase(changes_.begin());
+    }
+  }
+
+  // The new snapshot is published
+  void rebuilt(uint64_t version) { stamp(version, &Change::rebuilt); }
+  // The open pages have been rendered again
+  void rendered(uint64_t version) { stamp(version, &Change::rendered); }
+  // Clients are about to be told
+  void notifying(uint64_t version) { stamp(version, &Change::notified); }
+
+  // A client finished patching the page for `version`; its copy of the
+  // message was written at `delivered`. The first report of each change is
+  // printed with the running percentiles.
+  void painted(uint64_t version, Clock::time_point delivered, double fetch_ms,
+               double patch_ms) {
+    Breakdown breakdown{version, {}};
+    bool first = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = changes_.find(version);
+      if (it == changes_.end()) {
+        return;
+      }
+      Change &change = it->second;
+
+      breakdown.stages[Detect] = ms(change.started - change.first_seen);
+      breakdown.stages[Rebuild] = ms(change.rebuilt - change.started);
+      breakdown.stages[Render] = ms(change.rendered - change.rebuilt);
+      breakdown.stages[Notify] =
+          ms(std::max(delivered, change.notified) - change.notified);
+      breakdown.stages[Fetch] = std::max(fetch_ms, 0.0);
+      breakdown.stages[Patch] = std::max(patch_ms, 0.0);
+
+      first = change.reports++ == 0;
+      samples_.push_back(breakdown);
+      if (samples_.size() > max_samples) {
+        samples_.pop_front();
+      }
+    }
+
+    Metrics::instance().record_edit_to_paint(breakdown.total() / 1000);
+    if (first) {
+      print(breakdown);
+    }
+  }
+
+  // p50/p90/p99 of every stage and of the total, over the recent samples
+  nlohmann::ordered_json summary() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto percentiles = [this](auto value_of) {
+      std::vector<double> values;
+      values.reserve(samples_.size());
+      for (const auto &sample : samples_) {
+        values.push_back(value_of(sample));
+      }
+      std::sort(values.begin(), values.end());
+      return nlohmann::ordered_json{{"p50_ms", percentile(values, 50)},
+                                    {"p90_ms", percentile(values, 90)},
+                                    {"p99_ms", percentile(values, 99)}};
+    };
+
+    nlohmann::ordered_json result = {{"samples", samples_.size()}};
+    result["total"] =
+        percentiles([](const Breakdown &sample) { return sample.total(); });
+    for (size_t stage = 0; stage < stage_count; ++stage) {
+      result["stages"][stage_names[stage]] = percentiles(
+          [stage](const Breakdown &sample) { return sample.stages[stage]; });
+    }
+    return result;
+  }
+
+private:
+  // Enough to cover changes still being reported by slow tabs
+  static constexpr size_t max_changes = 32;
+  static constexpr size_t max_samples = 512;
+
+  struct Change {
+    Clock::time_point first_seen;
+    Clock::time_point started;
+    Clock::time_point rebuilt;
+    Clock::time_point rendered;
+    Clock::time_point notified;
+    size_t reports = 0;
+  };
+
+  ReloadTimings() = default;
+
+  static double ms(Clock::duration elapsed) {
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+  }
+
+  // Nearest rank of `p` in sorted `values`
+  static double percentile(const std::vector<double> &values, double p) {
+    if (values.empty()) {
+      return 0;
+    }
+    size_t rank = static_cast<size_t>(p / 100 * values.size() + 0.5);
+    return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+  }
+
+  // Stages after `stage` start from it, so one that is skipped (nothing to
+  // pre-render, say) takes no time
+  void stamp(uint64_t version, Clock::time_point Change::*stage) {
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = changes_.find(version);
+    if (it == changes_.end()) {
+      return;
+    }
+
+    constexpr Clock::time_point Change::*order[] = {
+        &Change::rebuilt, &Change::rendered, &Change::notified};
+    bool reached = false;
+    for (auto each : order) {
+      reached = reached || each == stage;
+      if (reached) {
+        it->second.*each = now;
+      }
+    }
+  }
+
+  // Queued on Log, so the io thread that got the report doesn't write to
+  // the terminal itself
+  void print(const Breakdown &breakdown) const {
+    nlohmann::ordered_json recent = summary();
+    const auto &total = recent["total"];
+
+    std::string line = std::format("{:.0f}ms (", breakdown.total());
+    for (size_t stage = 0; stage < stage_count; ++stage) {
+      line += std::format("{}{} {:.1f}", stage == 0 ? "" : " → ",
+                          stage_names[stage], breakdown.stages[stage]);
+    }
+    line += ")";
+
+    Log::instance().timing(
+        std::move(line),
+        std::format("p50 {:.0f}ms · p90 {:.0f}ms · p99 {:.0f}ms over the "
+                    "last {} reports",
+                    total["p50_ms"].get<double>(),
+                    total["p90_ms"].get<double>(),
+                    total["p99_ms"].get<double>(),
+                    recent["samples"].get<size_t>()));
+  }
+
+  mutable std::mutex mutex_;
+  std::map<uint64_t, Change> changes_;
+  std::deque<Breakdown> samples_;
+};
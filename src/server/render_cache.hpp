@@ -0,0 +1,74 @@
+#pragma once
+
+#include "metrics.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Rendered HTML for dev pages, keyed by URL and tagged with the build version
+// it was rendered from. A hit is only returned for the current version, and
+// the whole cache is dropped on rebuild. It also remembers which URLs were
+// requested most recently so they can be re-rendered ahead of the reload.
+class RenderCache {
+public:
+  explicit RenderCache(size_t recent_capacity = 8)
+      : recent_capacity_(recent_capacity) {}
+
+  std::shared_ptr<const std::string> get(const std::string &url,
+                                         uint64_t version) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(url);
+    bool hit = it != entries_.end() && it->second.version == version;
+    Metrics::instance().record_cache(Metrics::Cache::Render, hit);
+    return hit ? it->second.html : nullptr;
+  }
+
+  void put(const std::string &url, uint64_t version,
+           std::shared_ptr<const std::string> html) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[url] = Entry{version, std::move(html)};
+  }
+
+  void invalidate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+  }
+
+  // Moves `url` to the front of the recently-requested list.
+  void note_request(const std::string &url) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find(recent_.begin(), recent_.end(), url);
+    if (it == recent_.begin() && it != recent_.end()) {
+      return;
+    }
+    if (it != recent_.end()) {
+      recent_.erase(it);
+    }
+    recent_.push_front(url);
+    if (recent_.size() > recent_capacity_) {
+      recent_.pop_back();
+    }
+  }
+
+  std::vector<std::string> recent_urls() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {recent_.begin(), recent_.end()};
+  }
+
+private:
+  struct Entry {
+    uint64_t version;
+    std::shared_ptr<const std::string> html;
+  };
+
+  std::unordered_map<std::string, Entry> entries_;
+  std::deque<std::string> recent_;
+  size_t recent_capacity_;
+  mutable std::mutex mutex_;
+};
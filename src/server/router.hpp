@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct Request;
+struct Response;
+struct PreparedResponse;
+
+using Handler = std::function<void(const Request &, Response &)>;
+
+// A registered path: either a handler run per request or a response that was
+// built ahead of time. Prepared responses can be republished at any time
+// (e.g. /version after a rebuild) without locking out readers.
+struct Route {
+  Handler handler;
+  std::atomic<std::shared_ptr<const PreparedResponse>> prepared;
+};
+
+struct Mount {
+  std::string url_prefix;
+  std::string directory;
+};
+
+// Exact routes live in a hash map; static mounts live in a trie keyed by path
+// segment so the longest matching mount is found in one walk of the URL.
+// Routes and mounts must be registered before the server starts listening;
+// after that the map is only read, so lookups need no lock.
+class Router {
+public:
+  void add(const std::string &path, Handler handler) {
+    route_for(path).handler = std::move(handler);
+  }
+
+  void prepare(const std::string &path,
+               std::shared_ptr<const PreparedResponse> response) {
+    route_for(path).prepared.store(std::move(response));
+  }
+
+  // Swaps the prepared response of a route registered with prepare().
+  // Safe while requests are being served, since the map isn't modified.
+  void publish(const std::string &path,
+               std::shared_ptr<const PreparedResponse> response) {
+    auto it = routes_.find(path);
+    if (it == routes_.end()) {
+      throw std::logic_error("Route " + path + " was never prepared");
+    }
+    it->second->prepared.store(std::move(response));
+  }
+
+  void mount(const std::string &url_prefix, const std::string &directory) {
+    MountNode *node = &mount_root_;
+    for_each_segment(url_prefix, [&node](std::string_view segment) {
+      auto &child = node->children[std::string(segment)];
+      if (!child) {
+        child = std::make_unique<MountNode>();
+      }
+      node = child.get();
+      return true;
+    });
+    node->mount = std::make_unique<Mount>(Mount{url_prefix, directory});
+  }
+
+  const Route *find(std::string_view path) const {
+    auto it = routes_.find(std::string(strip_query(path)));
+    return it != routes_.end() ? it->second.get() : nullptr;
+  }
+
+  const Mount *find_mount(std::string_view path) const {
+    const MountNode *node = &mount_root_;
+    const Mount *match = node->mount.get();
+
+    for_each_segment(strip_query(path),
+                     [&node, &match](std::string_view segment) {
+                       auto it = node->children.find(std::string(segment));
+                       if (it == node->children.end()) {
+                         return false;
+                       }
+                       node = it->second.get();
+                       if (node->mount) {
+                         match = node->mount.get();
+                       }
+                       return true;
+                     });
+
+    return match;
+  }
+
+  static std::string_view strip_query(std::string_view path) {
+    size_t query = path.find('?');
+    return query == std::string_view::npos ? path : path.substr(0, query);
+  }
+
+private:
+  struct MountNode {
+    std::unordered_map<std::string, std::unique_ptr<MountNode>> children;
+    std::unique_ptr<Mount> mount;
+  };
+
+  Route &route_for(const std::string &path) {
+    auto &route = routes_[path];
+    if (!route) {
+      route = std::make_unique<Route>();
+    }
+    return *route;
+  }
+
+  // Calls `visit` for each non-empty '/'-separated segment until it
+  // returns false.
+  template <typename Visit>
+  static void for_each_segment(std::string_view path, Visit visit) {
+    size_t start = 0;
+    while (start < path.size()) {
+      size_t end = path.find('/', start);
+      if (end == std::string_view::npos) {
+        end = path.size();
+      }
+      if (end > start && !visit(path.substr(start, end - start))) {
+        return;
+      }
+      start = end + 1;
+    }
+  }
+
+  std::unordered_map<std::string, std::unique_ptr<Route>> routes_;
+  MountNode mount_root_;
+};
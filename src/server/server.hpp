@@ -1,55 +1,192 @@
 #pragma once
 
-#include <arpa/inet.h>
+#include "http_range.hpp"
+#include "metrics.hpp"
+#include "mime_types.hpp"
+#include "router.hpp"
+#include <algorithm>
+#include <atomic>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket/rfc6455.hpp>
 #include <cerrno>
+#include <chrono>
+#include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
+#include <format>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <iostream>
-#include <netinet/in.h>
+#include <memory>
+#include <optional>
 #include <sstream>
 #include <string>
-#include <sys/socket.h>
+#include <strings.h>
+#include <sys/sendfile.h>
+#include <thread>
 #include <unistd.h>
 #include <unordered_map>
 #include <vector>
 
+namespace beast = boost::beast;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
 struct Request {
   std::string method;
   std::string path;
   std::string version;
   std::unordered_map<std::string, std::string> headers;
   std::string body;
+
+  // Header names are case-insensitive; returns an empty string when absent.
+  std::string header(const std::string &name) const {
+    for (const auto &[key, value] : headers) {
+      if (strcasecmp(key.c_str(), name.c_str()) == 0) {
+        return value;
+      }
+    }
+    return "";
+  }
+
+  // True when Accept-Encoding lists `coding` (or `*`) without q=0.
+  bool accepts_encoding(const std::string &coding) const {
+    std::string accept = header("Accept-Encoding");
+    size_t start = 0;
+
+    while (start < accept.size()) {
+      size_t end = accept.find(',', start);
+      if (end == std::string::npos) {
+        end = accept.size();
+      }
+
+      std::string token = accept.substr(start, end - start);
+      start = end + 1;
+
+      size_t first = token.find_first_not_of(" \t");
+      if (first == std::string::npos) {
+        continue;
+      }
+      token = token.substr(first);
+
+      size_t params = token.find(';');
+      std::string name = token.substr(0, params);
+      while (!name.empty() && (name.back() == ' ' || name.back() == '\t')) {
+        name.pop_back();
+      }
+
+      if (strcasecmp(name.c_str(), coding.c_str()) != 0 && name != "*") {
+        continue;
+      }
+
+      if (params != std::string::npos) {
+        size_t q = token.find("q=", params);
+        if (q != std::string::npos &&
+            std::strtod(token.c_str() + q + 2, nullptr) == 0.0) {
+          continue;
+        }
+      }
+      return true;
+    }
+    return false;
+  }
 };
 
+// Owns the descriptor of a file body until it has been sent.
+class FileDescriptor {
+public:
+  FileDescriptor() = default;
+  FileDescriptor(const FileDescriptor &) = delete;
+  FileDescriptor &operator=(const FileDescriptor &) = delete;
+  ~FileDescriptor() { reset(); }
+
+  bool open(const std::filesystem::path &path) {
+    reset();
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    return fd_ >= 0;
+  }
+
+  void reset() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  int get() const { return fd_; }
+
+private:
+  int fd_ = -1;
+};
+
+struct PreparedResponse;
+
 struct Response {
   int status = 200;
   std::unordered_map<std::string, std::string> headers;
   std::string body;
 
+  // When set, the server writes this pre-formatted response as-is and ignores
+  // status, headers and body above.
+  std::shared_ptr<const PreparedResponse> prepared;
+
+  // When set, the body is streamed from this file with sendfile instead of
+  // being held in memory. A handler that already opened it (to measure what
+  // it sends) passes the descriptor along, and the path isn't reopened.
+  std::filesystem::path file;
+  size_t file_size = 0;
+  std::shared_ptr<FileDescriptor> file_descriptor;
+
+  // Slices of the body selected by a Range header (status 206).
+  std::vector<ByteRange> ranges;
+
   void set_content(const std::string &content, const std::string &type) {
     body = content;
     headers["Content-Type"] = type;
   }
 
-  std::string to_http() const {
+  void set_file(const std::filesystem::path &path, size_t size,
+                const std::string &type) {
+    file = path;
+    file_size = size;
+    headers["Content-Type"] = type;
+  }
+
+  void set_file(std::shared_ptr<FileDescriptor> descriptor,
+                const std::filesystem::path &path, size_t size,
+                const std::string &type) {
+    set_file(path, size, type);
+    file_descriptor = std::move(descriptor);
+  }
+
+  // Size of the full entity, before any Range is applied.
+  size_t entity_size() const;
+
+  size_t content_length() const;
+
+  std::string to_http_head(size_t length) const {
     std::ostringstream oss;
     std::string status_text = get_status_text(status);
 
     oss << "HTTP/1.1 " << status << " " << status_text << "\r\n";
-    oss << "Content-Length: " << body.size() << "\r\n";
+    oss << "Content-Length: " << length << "\r\n";
 
     for (const auto &[key, value] : headers) {
       oss << key << ": " << value << "\r\n";
     }
 
-    oss << "\r\n" << body;
+    oss << "\r\n";
     return oss.str();
   }
 
-private:
-  std::string get_status_text(int code) const {
+  std::string to_http() const { return to_http_head(body.size()) + body; }
+
+  static std::string get_status_text(int code) {
     switch (code) {
     case 200:
       return "OK";
@@ -61,6 +198,8 @@ private:
       return "Moved Permanently";
     case 302:
       return "Found";
+    case 206:
+      return "Partial Content";
     case 304:
       return "Not Modified";
     case 400:
@@ -71,6 +210,8 @@ private:
       return "Forbidden";
     case 404:
       return "Not Found";
+    case 416:
+      return "Range Not Satisfiable";
     case 500:
       return "Internal Server Error";
     case 502:
@@ -83,115 +224,131 @@ private:
   }
 };
 
-using Handler = std::function<void(const Request &, Response &)>;
+// A response whose wire format is built once up front, for content that does
+// not change between requests. Serving it is a single gather write of the
+// head and body with no per-request formatting or copying.
+struct PreparedResponse {
+  int status = 200;
+  std::string head;
+  std::string body;
+  std::string etag;
+
+  // What `head` was built from, for responses that must be re-framed (e.g.
+  // 206 slices of `body`).
+  std::string content_type;
+  std::vector<std::pair<std::string, std::string>> headers;
+
+  static std::shared_ptr<const PreparedResponse>
+  make(int status, std::string body, const std::string &type,
+       const std::vector<std::pair<std::string, std::string>> &headers = {}) {
+    auto prepared = std::make_shared<PreparedResponse>();
+    prepared->status = status;
+    prepared->body = std::move(body);
+    prepared->content_type = type;
+    prepared->headers = headers;
+
+    std::string head = "HTTP/1.1 " + std::to_string(status) + " " +
+                       Response::get_status_text(status) + "\r\n";
+    head += "Content-Length: " + std::to_string(prepared->body.size()) +
+            "\r\n";
+    head += "Content-Type: " + type + "\r\n";
+    for (const auto &[key, value] : headers) {
+      head += key + ": " + value + "\r\n";
+      if (key == "ETag") {
+        prepared->etag = value;
+      }
+    }
+    head += "\r\n";
+    prepared->head = std::move(head);
+
+    return prepared;
+  }
+};
+
+inline size_t Response::entity_size() const {
+  if (prepared)
+    return prepared->body.size();
+  if (!file.empty())
+    return file_size;
+  return body.size();
+}
+
+inline size_t Response::content_length() const {
+  if (ranges.empty())
+    return entity_size();
+
+  size_t length = 0;
+  for (const auto &range : ranges) {
+    length += range.length();
+  }
+  return length;
+}
+
+// Called from every io_context thread at once, so it must not block (see
+// Log, which only queues the line)
 using Logger = std::function<void(const Request &, const Response &)>;
 
+// Takes over a connection whose request asked to switch protocols (a
+// WebSocket handshake), along with that request.
+using UpgradeHandler = std::function<void(
+    tcp::socket, beast::http::request<beast::http::string_body>)>;
+
 class Server {
 private:
-  int server_fd = -1;
-  bool running = false;
-  std::string mount_point_url;
-  std::string mount_point_path;
-  std::vector<std::pair<std::string, Handler>> routes;
+  net::io_context ioc;
+  std::atomic<bool> running{false};
+  Router router;
   Handler default_handler;
+  std::unordered_map<std::string, UpgradeHandler> upgrade_handlers;
   Logger logger;
   bool verbose_logging = false;
 
-  static Request parse_request(const std::string &raw) {
-    Request req;
-    std::istringstream iss(raw);
-    std::string line;
-
-    if (std::getline(iss, line)) {
-      line.pop_back();
-      std::istringstream line_stream(line);
-      line_stream >> req.method >> req.path >> req.version;
-    }
-
-    while (std::getline(iss, line) && line != "\r") {
-      line.pop_back();
-      size_t colon = line.find(':');
-      if (colon != std::string::npos) {
-        std::string key = line.substr(0, colon);
-        std::string value = line.substr(colon + 2);
-        req.headers[key] = value;
-      }
-    }
+  // File bodies are sent this many bytes per turn on a connection's strand.
+  static constexpr size_t file_chunk = 256 << 10;
+  // Connections kept alive are closed after sitting idle this long.
+  static constexpr std::chrono::seconds keep_alive_timeout{30};
+  static constexpr size_t max_body_size = 1 << 20;
 
-    std::string body_content;
-    while (std::getline(iss, line)) {
-      body_content += line + "\n";
+  static Request
+  to_request(const beast::http::request<beast::http::string_body> &message) {
+    Request req;
+    req.method = std::string(message.method_string());
+    req.path = std::string(message.target());
+    req.version = message.version() == 10 ? "HTTP/1.0" : "HTTP/1.1";
+    for (const auto &field : message) {
+      req.headers[std::string(field.name_string())] =
+          std::string(field.value());
     }
-    req.body = body_content;
-
+    req.body = message.body();
     return req;
   }
 
-  bool ends_with(const std::string &str, const std::string &suffix) {
-    if (suffix.size() > str.size())
-      return false;
-    return str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
-  }
-
-  std::string get_mime_type(const std::string &path) {
-    if (ends_with(path, ".html"))
-      return "text/html";
-    if (ends_with(path, ".css"))
-      return "text/css";
-    if (ends_with(path, ".js"))
-      return "application/javascript";
-    if (ends_with(path, ".json"))
-      return "application/json";
-    if (ends_with(path, ".png"))
-      return "image/png";
-    if (ends_with(path, ".jpg") || ends_with(path, ".jpeg"))
-      return "image/jpeg";
-    if (ends_with(path, ".gif"))
-      return "image/gif";
-    if (ends_with(path, ".webp"))
-      return "image/webp";
-    if (ends_with(path, ".svg"))
-      return "image/svg+xml";
-    if (ends_with(path, ".ico"))
-      return "image/x-icon";
-    if (ends_with(path, ".woff"))
-      return "font/woff";
-    if (ends_with(path, ".woff2"))
-      return "font/woff2";
-    if (ends_with(path, ".ttf"))
-      return "font/ttf";
-    if (ends_with(path, ".pdf"))
-      return "application/pdf";
-    if (ends_with(path, ".xml"))
-      return "application/xml";
-    if (ends_with(path, ".txt"))
-      return "text/plain";
-    return "application/octet-stream";
-  }
-
-  bool starts_with(const std::string &str, const std::string &prefix) {
-    if (prefix.size() > str.size())
-      return false;
-    return str.compare(0, prefix.size(), prefix) == 0;
+public:
+  static std::string get_mime_type(const std::string &path) {
+    return std::string(mime::lookup(path));
   }
 
-  bool serve_static_file(const std::string &url_path, Response &res) {
-    if (!mount_point_url.empty() && starts_with(url_path, mount_point_url)) {
-
-      std::string clean_path = url_path;
-      size_t query_pos = clean_path.find('?');
-      if (query_pos != std::string::npos) {
-        clean_path = clean_path.substr(0, query_pos);
-      }
-
-      std::string relative = clean_path.substr(mount_point_url.length());
+private:
+  bool serve_static_file(const Request &req, Response &res) {
+    const std::string &url_path = req.path;
+    const Mount *mount = router.find_mount(url_path);
+    if (mount) {
+      std::string relative(
+          Router::strip_query(url_path).substr(mount->url_prefix.length()));
 
       if (!relative.empty() && relative[0] == '/') {
         relative = relative.substr(1);
       }
 
+      // Names like a..b.css are fine; a ".." segment would leave the mount
+      for (const auto &segment : std::filesystem::path(relative)) {
+        if (segment == "..") {
+          return false;
+        }
+      }
+
       std::filesystem::path file_path =
-          std::filesystem::path(mount_point_path) / relative;
+          std::filesystem::path(mount->directory) / relative;
 
       if (verbose_logging) {
         std::cout << "[STATIC] " << url_path << " → " << file_path.string()
@@ -200,15 +357,37 @@ private:
 
       if (std::filesystem::exists(file_path) &&
           std::filesystem::is_regular_file(file_path)) {
-        std::ifstream file(file_path, std::ios::binary);
-        if (file) {
-          std::string content((std::istreambuf_iterator<char>(file)),
-                              std::istreambuf_iterator<char>());
-          res.set_content(content, get_mime_type(file_path.string()));
+        // Prefer a precompressed sibling when the client can take it
+        std::filesystem::path gz_path = file_path;
+        gz_path += ".gz";
+        bool has_gzip = std::filesystem::is_regular_file(gz_path);
+        bool use_gzip = has_gzip && req.accepts_encoding("gzip");
+
+        const std::filesystem::path &body_path = use_gzip ? gz_path : file_path;
+        std::error_code ec;
+        size_t size = std::filesystem::file_size(body_path, ec);
+        if (!ec) {
+          // Streamed from disk at send time, so large media is never
+          // loaded into memory
+          res.set_file(body_path, size, get_mime_type(file_path.string()));
+          res.headers["Accept-Ranges"] = "bytes";
+          res.headers["Last-Modified"] = last_modified_header(body_path);
+          res.headers["ETag"] = std::format(
+              "\"{:x}-{:x}\"", size,
+              static_cast<uint64_t>(std::filesystem::last_write_time(body_path)
+                                        .time_since_epoch()
+                                        .count()));
+
+          if (has_gzip) {
+            res.headers["Vary"] = "Accept-Encoding";
+          }
+          if (use_gzip) {
+            res.headers["Content-Encoding"] = "gzip";
+          }
 
           if (verbose_logging) {
-            std::cout << "[STATIC] ✓ " << content.size() << " bytes"
-                      << std::endl;
+            std::cout << "[STATIC] ✓ " << size << " bytes"
+                      << (use_gzip ? " (gzip)" : "") << std::endl;
           }
           return true;
         }
@@ -221,57 +400,444 @@ private:
     return false;
   }
 
-  void handle_client(int client_fd) {
-    char buffer[8192];
-    ssize_t bytes = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
-
-    if (bytes <= 0) {
-      close(client_fd);
+  // Narrows a 200 response with a file or prepared body to the byte ranges
+  // requested by Range, honouring If-Range.
+  static void apply_range(const Request &req, Response &res) {
+    if (res.status != 200 || (res.file.empty() && !res.prepared)) {
       return;
     }
 
-    buffer[bytes] = '\0';
-    Request req = parse_request(std::string(buffer));
-    Response res;
+    std::string range = req.header("Range");
+    if (range.empty()) {
+      return;
+    }
 
-    if (serve_static_file(req.path, res)) {
-      if (logger) {
-        logger(req, res);
+    // If-Range: only send a partial response if the client's copy is current
+    std::string if_range = req.header("If-Range");
+    if (!if_range.empty()) {
+      std::string etag =
+          res.prepared ? res.prepared->etag : res.headers["ETag"];
+      bool current = (if_range.starts_with("\"") && if_range == etag) ||
+                     (!res.file.empty() &&
+                      if_range == res.headers["Last-Modified"]);
+      if (!current) {
+        return;
       }
-      std::string response = res.to_http();
-      send(client_fd, response.c_str(), response.size(), 0);
-      close(client_fd);
+    }
+
+    size_t size = res.entity_size();
+    switch (parse_range_header(range, size, res.ranges)) {
+    case RangeResult::Full:
+      return;
+    case RangeResult::Unsatisfiable:
+      res.prepared.reset();
+      res.file.clear();
+      res.file_descriptor.reset();
+      res.body.clear();
+      res.status = 416;
+      res.headers["Content-Range"] = "bytes */" + std::to_string(size);
       return;
+    case RangeResult::Partial:
+      break;
+    }
+
+    // The prepared head says 200 with the full length; re-frame it
+    if (res.prepared) {
+      res.headers["Content-Type"] = res.prepared->content_type;
+      for (const auto &[key, value] : res.prepared->headers) {
+        res.headers[key] = value;
+      }
+    }
+    res.status = 206;
+  }
+
+  // One slice of the entity, preceded by a multipart part header if any.
+  struct BodyPart {
+    std::string prefix;
+    size_t offset;
+    size_t length;
+  };
+
+  // The wire layout of a response that isn't sent as one prepared block:
+  // its head, each slice of the entity (with multipart framing when several
+  // ranges were asked for), then the closing boundary if any.
+  struct Framing {
+    std::string head;
+    std::vector<BodyPart> parts;
+    std::string trailer;
+
+    size_t wire_size(bool head_only) const {
+      size_t size = head.size();
+      if (!head_only) {
+        for (const auto &part : parts) {
+          size += part.prefix.size() + part.length;
+        }
+        size += trailer.size();
+      }
+      return size;
     }
+  };
+
+  static Framing frame(Response &res) {
+    Framing framing;
+    size_t size = res.entity_size();
+    size_t length = 0;
+
+    if (res.ranges.empty()) {
+      framing.parts.push_back({"", 0, size});
+      length = size;
+    } else if (res.ranges.size() == 1) {
+      const ByteRange &range = res.ranges.front();
+      res.headers["Content-Range"] = "bytes " + std::to_string(range.first) +
+                                     "-" + std::to_string(range.last) + "/" +
+                                     std::to_string(size);
+      framing.parts.push_back({"", range.first, range.length()});
+      length = range.length();
+    } else {
+      const std::string boundary = "forge-byteranges-7d1c";
+      std::string part_type = res.headers["Content-Type"];
+
+      for (const auto &range : res.ranges) {
+        std::string prefix = "\r\n--" + boundary + "\r\n";
+        prefix += "Content-Type: " + part_type + "\r\n";
+        prefix += "Content-Range: bytes " + std::to_string(range.first) + "-" +
+                  std::to_string(range.last) + "/" + std::to_string(size) +
+                  "\r\n\r\n";
+        length += prefix.size() + range.length();
+        framing.parts.push_back(
+            {std::move(prefix), range.first, range.length()});
+      }
+      framing.trailer = "\r\n--" + boundary + "--\r\n";
+      length += framing.trailer.size();
+
+      res.headers["Content-Type"] =
+          "multipart/byteranges; boundary=" + boundary;
+    }
+
+    framing.head = res.to_http_head(length);
+    return framing;
+  }
 
-    bool handled = false;
-    for (const auto &[pattern, handler] : routes) {
-      if (pattern == req.path) {
-        handler(req, res);
-        handled = true;
-        break;
+  // Runs a request through the static mounts, the routes and the default
+  // handler. Called from any of the io_context threads at once.
+  Response respond(const Request &req) {
+    Response res;
+
+    if (!serve_static_file(req, res)) {
+      const Route *route = router.find(req.path);
+      std::shared_ptr<const PreparedResponse> prepared =
+          route ? route->prepared.load() : nullptr;
+
+      if (prepared) {
+        res.prepared = std::move(prepared);
+      } else if (route && route->handler) {
+        route->handler(req, res);
+      } else if (default_handler) {
+        default_handler(req, res);
       }
     }
 
-    if (!handled && default_handler) {
-      default_handler(req, res);
+    if (res.prepared) {
+      res.status = res.prepared->status;
     }
 
+    apply_range(req, res);
+
     if (logger) {
       logger(req, res);
     }
 
-    std::string response = res.to_http();
-    send(client_fd, response.c_str(), response.size(), 0);
-    close(client_fd);
+    return res;
+  }
+
+  const UpgradeHandler *find_upgrade(std::string_view target) const {
+    auto it = upgrade_handlers.find(std::string(Router::strip_query(target)));
+    return it != upgrade_handlers.end() ? &it->second : nullptr;
+  }
+
+  // One client connection, served on its own strand. Requests are answered
+  // in turn for as long as the client keeps the connection alive, unless
+  // one asks to upgrade and the connection is handed over.
+  class Connection : public std::enable_shared_from_this<Connection> {
+  public:
+    Connection(tcp::socket socket, Server &server)
+        : stream_(std::move(socket)), stall_timer_(stream_.get_executor()),
+          server_(server) {
+      Metrics::instance().connection_opened();
+    }
+
+    ~Connection() { Metrics::instance().connection_closed(); }
+
+    void run() { do_read(); }
+
+  private:
+    void do_read() {
+      response_ = Response();
+      parser_.emplace();
+      parser_->body_limit(max_body_size);
+      stream_.expires_after(keep_alive_timeout);
+      beast::http::async_read(
+          stream_, buffer_, *parser_,
+          beast::bind_front_handler(&Connection::on_read, shared_from_this()));
+    }
+
+    void on_read(beast::error_code ec, std::size_t) {
+      // The client hung up, sat idle too long or sent something unreadable
+      if (ec) {
+        close();
+        return;
+      }
+
+      auto message = parser_->release();
+      if (beast::websocket::is_upgrade(message)) {
+        auto target = message.target();
+        if (const UpgradeHandler *upgrade = server_.find_upgrade(
+                std::string_view(target.data(), target.size()))) {
+          stream_.expires_never();
+          (*upgrade)(stream_.release_socket(), std::move(message));
+          return;
+        }
+      }
+
+      started_ = std::chrono::steady_clock::now();
+      request_ = to_request(message);
+      keep_alive_ = message.keep_alive();
+      response_ = server_.respond(request_);
+      send();
+    }
+
+    void send() {
+      Response &res = response_;
+      bool head_only = request_.method == "HEAD";
+
+      if (res.prepared && res.ranges.empty()) {
+        buffers_ = {net::buffer(res.prepared->head)};
+        if (!head_only) {
+          buffers_.push_back(net::buffer(res.prepared->body));
+        }
+        write();
+        return;
+      }
+
+      if (!keep_alive_) {
+        res.headers["Connection"] = "close";
+      }
+      framing_ = frame(res);
+
+      if (!res.file.empty()) {
+        send_file(head_only);
+        return;
+      }
+
+      std::string_view memory = res.prepared
+                                    ? std::string_view(res.prepared->body)
+                                    : std::string_view(res.body);
+      buffers_ = {net::buffer(framing_.head)};
+      if (!head_only) {
+        for (const auto &part : framing_.parts) {
+          if (!part.prefix.empty()) {
+            buffers_.push_back(net::buffer(part.prefix));
+          }
+          buffers_.push_back(
+              net::buffer(memory.data() + part.offset, part.length));
+        }
+        if (!framing_.trailer.empty()) {
+          buffers_.push_back(net::buffer(framing_.trailer));
+        }
+      }
+      write();
+    }
+
+    void write() {
+      net::async_write(
+          stream_, buffers_,
+          beast::bind_front_handler(&Connection::on_write, shared_from_this()));
+    }
+
+    void on_write(beast::error_code ec, std::size_t bytes) {
+      if (!ec) {
+        finished(bytes);
+      }
+      if (ec || !keep_alive_) {
+        close();
+        return;
+      }
+      do_read();
+    }
+
+    // File bodies go out with sendfile on the non-blocking socket, a chunk
+    // per turn on the strand, waiting for the socket to drain when it is
+    // full. No io_context thread ever blocks on a slow client, a long
+    // download holds no thread, and stopping the io_context stops it.
+    void send_file(bool head_only) {
+      if (head_only) {
+        // Only the head goes out, which write_framing sends first
+        next_part_ = framing_.parts.size();
+        head_only_ = true;
+      } else {
+        file_ = std::move(response_.file_descriptor);
+        if (!file_) {
+          file_ = std::make_shared<FileDescriptor>();
+          if (!file_->open(response_.file)) {
+            close();
+            return;
+          }
+        }
+        next_part_ = 0;
+        head_only_ = false;
+      }
+      beast::error_code ec;
+      stream_.socket().native_non_blocking(true, ec);
+      write_framing();
+    }
+
+    // Writes what precedes part `next_part_`: the head for the first, a
+    // multipart header if any, and the trailer once every part is sent.
+    void write_framing() {
+      buffers_.clear();
+      if (next_part_ == 0 || head_only_) {
+        buffers_.push_back(net::buffer(framing_.head));
+      }
+      if (!head_only_) {
+        if (next_part_ < framing_.parts.size()) {
+          const std::string &prefix = framing_.parts[next_part_].prefix;
+          if (!prefix.empty()) {
+            buffers_.push_back(net::buffer(prefix));
+          }
+        } else if (!framing_.trailer.empty()) {
+          buffers_.push_back(net::buffer(framing_.trailer));
+        }
+      }
+
+      if (buffers_.empty()) {
+        on_framing({}, 0);
+        return;
+      }
+      stream_.expires_after(keep_alive_timeout);
+      net::async_write(stream_, buffers_,
+                       beast::bind_front_handler(&Connection::on_framing,
+                                                 shared_from_this()));
+    }
+
+    void on_framing(beast::error_code ec, std::size_t) {
+      if (ec) {
+        close();
+        return;
+      }
+      if (next_part_ == framing_.parts.size()) {
+        file_.reset();
+        finished(framing_.wire_size(head_only_));
+        if (!keep_alive_) {
+          close();
+          return;
+        }
+        do_read();
+        return;
+      }
+      part_sent_ = 0;
+      send_chunk();
+    }
+
+    void send_chunk() {
+      const BodyPart &part = framing_.parts[next_part_];
+      if (part_sent_ == part.length) {
+        next_part_++;
+        write_framing();
+        return;
+      }
+
+      off_t offset = static_cast<off_t>(part.offset + part_sent_);
+      ssize_t sent =
+          ::sendfile(stream_.socket().native_handle(), file_->get(), &offset,
+                     std::min(part.length - part_sent_, file_chunk));
+      if (sent > 0) {
+        part_sent_ += static_cast<size_t>(sent);
+      } else if (sent == 0 || (errno != EAGAIN && errno != EWOULDBLOCK &&
+                               errno != EINTR)) {
+        // The client went away, or the file shrank under us
+        close();
+        return;
+      }
+
+      // Resumes once the socket can take more, letting other connections
+      // on this thread run in between
+      stall_timer_.expires_after(keep_alive_timeout);
+      stall_timer_.async_wait(
+          [self = shared_from_this()](beast::error_code ec) {
+            if (ec != net::error::operation_aborted) {
+              self->close();
+            }
+          });
+      stream_.socket().async_wait(
+          tcp::socket::wait_write,
+          [self = shared_from_this()](beast::error_code ec) {
+            self->stall_timer_.cancel();
+            if (ec) {
+              self->close();
+              return;
+            }
+            self->send_chunk();
+          });
+    }
+
+    void finished(size_t bytes) {
+      Metrics::instance().record_response(
+          response_.status, bytes, std::chrono::steady_clock::now() - started_);
+    }
+
+    void close() {
+      file_.reset();
+      beast::error_code ec;
+      stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+      stream_.close();
+    }
+
+    beast::tcp_stream stream_;
+    net::steady_timer stall_timer_;
+    Server &server_;
+    beast::flat_buffer buffer_;
+    std::optional<beast::http::request_parser<beast::http::string_body>>
+        parser_;
+    Request request_;
+    Response response_;
+    Framing framing_;
+    std::vector<net::const_buffer> buffers_;
+    std::chrono::steady_clock::time_point started_;
+    bool keep_alive_ = false;
+
+    // Progress through a file body
+    std::shared_ptr<FileDescriptor> file_;
+    size_t next_part_ = 0;
+    size_t part_sent_ = 0;
+    bool head_only_ = false;
+  };
+
+  void do_accept(tcp::acceptor &acceptor) {
+    acceptor.async_accept(
+        net::make_strand(ioc),
+        [this, &acceptor](beast::error_code ec, tcp::socket socket) {
+          if (ec == net::error::operation_aborted) {
+            return;
+          }
+          if (!ec) {
+            std::make_shared<Connection>(std::move(socket), *this)->run();
+          } else if (running) {
+            std::cerr << "Accept failed: " << ec.message() << "\n";
+          }
+
+          if (running) {
+            do_accept(acceptor);
+          }
+        });
   }
 
 public:
   ~Server() { stop(); }
 
+  // Serves files under `path` for URLs starting with `url`. Several mounts
+  // may be registered; the longest matching prefix wins.
   void set_mount_point(const std::string &url, const std::string &path) {
-    mount_point_url = url;
-    mount_point_path = path;
+    router.mount(url, path);
   }
 
   void set_logger(Logger log_handler) { logger = log_handler; }
@@ -279,79 +845,107 @@ public:
   void set_verbose(bool verbose) { verbose_logging = verbose; }
 
   void Get(const std::string &pattern, Handler handler) {
-    routes.push_back({pattern, handler});
+    router.add(pattern, handler);
   }
 
   void Get(const std::string &pattern, Handler handler, bool is_catch_all) {
     if (is_catch_all) {
       default_handler = handler;
     } else {
-      routes.push_back({pattern, handler});
+      router.add(pattern, handler);
     }
   }
 
-  bool listen(const std::string &host, int port) {
-    server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd == -1) {
-      std::cerr << "Failed to create socket: " << strerror(errno) << "\n";
+  // Serves a response built once up front. Like other routes, it must be
+  // registered before the server starts listening.
+  void Prepared(const std::string &pattern,
+                std::shared_ptr<const PreparedResponse> response) {
+    router.prepare(pattern, std::move(response));
+  }
+
+  // Atomically replaces the response of a path registered with Prepared(),
+  // even while the server is running.
+  void Republish(const std::string &pattern,
+                 std::shared_ptr<const PreparedResponse> response) {
+    router.publish(pattern, std::move(response));
+  }
+
+  // Reports the process's Metrics at `path` in the Prometheus text format
+  void ServeMetrics(const std::string &path = "/__forge/metrics") {
+    router.add(path, [](const Request &, Response &res) {
+      res.set_content(Metrics::instance().render(),
+                      "text/plain; version=0.0.4; charset=utf-8");
+      res.headers["Cache-Control"] = "no-store";
+    });
+  }
+
+  // Hands requests for `path` that ask to upgrade the connection to
+  // `handler` instead of answering them. The handler runs on the
+  // connection's strand of the server's io_context.
+  void Upgrade(const std::string &path, UpgradeHandler handler) {
+    upgrade_handlers[path] = std::move(handler);
+  }
+
+  // Serves connections from `threads` threads sharing one io_context, each
+  // connection on its own strand. Blocks until stop() is called.
+  bool listen(const std::string &host, int port,
+              unsigned threads = std::max(
+                  1u, std::thread::hardware_concurrency())) {
+    beast::error_code ec;
+    auto address = net::ip::make_address(host, ec);
+    if (ec) {
+      std::cerr << "Invalid address " << host << ": " << ec.message() << "\n";
       return false;
     }
+    tcp::endpoint endpoint(address, static_cast<unsigned short>(port));
 
-    int opt = 1;
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) <
-        0) {
-      std::cerr << "Failed to set SO_REUSEADDR: " << strerror(errno) << "\n";
+    tcp::acceptor acceptor(ioc);
+    acceptor.open(endpoint.protocol(), ec);
+    if (ec) {
+      std::cerr << "Failed to create socket: " << ec.message() << "\n";
+      return false;
     }
 
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) <
-        0) {
-      std::cerr << "Failed to set SO_REUSEPORT: " << strerror(errno) << "\n";
+    acceptor.set_option(net::socket_base::reuse_address(true), ec);
+    if (ec) {
+      std::cerr << "Failed to set SO_REUSEADDR: " << ec.message() << "\n";
     }
 
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(port);
-    addr.sin_addr.s_addr = INADDR_ANY;
-
-    if (bind(server_fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
-      std::cerr << "Bind failed on port " << port << ": " << strerror(errno)
+    acceptor.bind(endpoint, ec);
+    if (ec) {
+      std::cerr << "Bind failed on port " << port << ": " << ec.message()
                 << "\n";
       std::cerr << "Port may already be in use. Try: lsof -i :" << port << "\n";
-      close(server_fd);
       return false;
     }
 
-    if (::listen(server_fd, 10) < 0) {
-      std::cerr << "Listen failed: " << strerror(errno) << "\n";
-      close(server_fd);
+    acceptor.listen(net::socket_base::max_listen_connections, ec);
+    if (ec) {
+      std::cerr << "Listen failed: " << ec.message() << "\n";
       return false;
     }
 
+    ioc.restart();
     running = true;
+    do_accept(acceptor);
 
-    while (running) {
-      sockaddr_in client_addr{};
-      socklen_t client_len = sizeof(client_addr);
-      int client_fd = accept(server_fd, (sockaddr *)&client_addr, &client_len);
-
-      if (client_fd < 0) {
-        if (running) {
-          std::cerr << "Accept failed\n";
-        }
-        continue;
-      }
-
-      handle_client(client_fd);
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i) {
+      pool.emplace_back([this]() { ioc.run(); });
+    }
+    ioc.run();
+    for (auto &thread : pool) {
+      thread.join();
     }
 
     return true;
   }
 
+  // Every connection, file bodies still being streamed included, runs on
+  // the io_context, so stopping it halts them all; nothing outlives the
+  // threads listen() joins.
   void stop() {
     running = false;
-    if (server_fd != -1) {
-      close(server_fd);
-      server_fd = -1;
-    }
+    ioc.stop();
   }
-};
\ No newline at end of file
+};
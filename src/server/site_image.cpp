@@ -0,0 +1,209 @@
+#include "site_image.hpp"
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <sys/stat.h>
+
+static std::string read_binary(const fs::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+}
+
+// FNV-1a is plenty for ETags: they only need to change when the bytes do.
+static std::string make_etag(const std::string &content) {
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : content) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return std::format("\"{:016x}\"", hash);
+}
+
+// Large files can't be hashed without reading them, so their ETag comes
+// from the size and modification time, as for static mounts.
+static std::string file_etag(const struct stat &info) {
+  return std::format("\"{:x}-{:x}\"", static_cast<uint64_t>(info.st_size),
+                     static_cast<uint64_t>(info.st_mtim.tv_sec) *
+                             1000000000ull +
+                         static_cast<uint64_t>(info.st_mtim.tv_nsec));
+}
+
+static std::shared_ptr<const ImageFile>
+make_file(const fs::path &path, int status, const std::string &type,
+          std::vector<std::pair<std::string, std::string>> headers) {
+  auto file = std::make_shared<ImageFile>();
+  file->status = status;
+  file->path = path;
+  file->content_type = type;
+  file->headers = std::move(headers);
+  return file;
+}
+
+static ImageEntry make_entry(const fs::path &file_path, int status) {
+  ImageEntry entry;
+  std::string type = Server::get_mime_type(file_path.string());
+
+  fs::path gz_path = file_path;
+  gz_path += ".gz";
+  bool has_gzip = fs::is_regular_file(gz_path);
+
+  std::vector<std::pair<std::string, std::string>> headers = {
+      {"Cache-Control", "no-cache"}, {"Accept-Ranges", "bytes"}};
+  if (has_gzip) {
+    headers.push_back({"Vary", "Accept-Encoding"});
+  }
+
+  std::string etag;
+  size_t size = fs::file_size(file_path);
+  if (size > SiteImage::preload_limit) {
+    entry.identity_file = make_file(file_path, status, type, headers);
+    // Only names the preloaded gzip variant below
+    struct stat info {};
+    ::stat(file_path.c_str(), &info);
+    etag = file_etag(info);
+  } else {
+    std::string body = read_binary(file_path);
+    etag = make_etag(body);
+    headers.insert(headers.begin(), {"ETag", etag});
+    entry.identity =
+        PreparedResponse::make(status, std::move(body), type, headers);
+  }
+
+  if (has_gzip) {
+    std::vector<std::pair<std::string, std::string>> gz_headers = {
+        {"Cache-Control", "no-cache"},
+        {"Accept-Ranges", "bytes"},
+        {"Content-Encoding", "gzip"},
+        {"Vary", "Accept-Encoding"}};
+
+    size_t gz_size = fs::file_size(gz_path);
+    if (gz_size > SiteImage::preload_limit) {
+      entry.gzip_file =
+          make_file(gz_path, status, type, std::move(gz_headers));
+    } else {
+      std::string gz_etag = etag;
+      gz_etag.insert(gz_etag.size() - 1, "-gz");
+      gz_headers.insert(gz_headers.begin(), {"ETag", gz_etag});
+      entry.gzip = PreparedResponse::make(status, read_binary(gz_path), type,
+                                          gz_headers);
+    }
+  }
+
+  return entry;
+}
+
+std::shared_ptr<const SiteImage> SiteImage::load(const fs::path &dist_path) {
+  auto image = std::make_shared<SiteImage>();
+
+  for (const auto &dir_entry : fs::recursive_directory_iterator(dist_path)) {
+    if (!dir_entry.is_regular_file()) {
+      continue;
+    }
+
+    const fs::path &path = dir_entry.path();
+
+    // Precompressed siblings are attached to their source file below.
+    if (path.extension() == ".gz" &&
+        fs::is_regular_file(fs::path(path).replace_extension())) {
+      continue;
+    }
+
+    ImageEntry entry = make_entry(path, 200);
+    image->file_count_++;
+    if (entry.identity) {
+      image->total_bytes_ += entry.identity->body.size();
+    } else {
+      image->streamed_count_++;
+    }
+
+    std::string url = "/" + fs::relative(path, dist_path).generic_string();
+    image->entries_[url] = entry;
+
+    // Pretty URLs: /about/index.html is also served as /about
+    if (path.filename() == "index.html") {
+      std::string dir_url = url.substr(0, url.size() - 11);
+      image->entries_[dir_url.empty() ? "/" : dir_url] = entry;
+    }
+  }
+
+  fs::path error_page = dist_path / "404" / "index.html";
+  if (fs::is_regular_file(error_page)) {
+    image->not_found_ = make_entry(error_page, 404);
+  } else {
+    image->not_found_.identity =
+        PreparedResponse::make(404,
+                               "<h1>404 - Page Not Found</h1><p>The page "
+                               "you're looking for doesn't exist.</p>",
+                               "text/html");
+  }
+
+  return image;
+}
+
+const ImageEntry *SiteImage::find(std::string_view url) const {
+  size_t query_pos = url.find('?');
+  if (query_pos != std::string_view::npos) {
+    url = url.substr(0, query_pos);
+  }
+
+  if (url.size() > 1 && url.back() == '/') {
+    url.remove_suffix(1);
+  }
+
+  auto it = entries_.find(std::string(url));
+  return it != entries_.end() ? &it->second : nullptr;
+}
+
+void serve_image_entry(const ImageEntry &entry, const Request &req,
+                       Response &res) {
+  bool use_gzip =
+      (entry.gzip || entry.gzip_file) && req.accepts_encoding("gzip");
+  const auto &variant = use_gzip ? entry.gzip : entry.identity;
+  const auto &file = use_gzip ? entry.gzip_file : entry.identity_file;
+
+  std::string if_none_match = req.header("If-None-Match");
+  auto not_modified = [&](int status, const std::string &etag) {
+    if (if_none_match.empty() || status != 200 ||
+        if_none_match.find(etag) == std::string::npos) {
+      return false;
+    }
+    res.status = 304;
+    res.headers["ETag"] = etag;
+    return true;
+  };
+
+  if (variant) {
+    if (!not_modified(variant->status, variant->etag)) {
+      res.prepared = variant;
+    }
+    return;
+  }
+
+  // The headers describe the descriptor that is sent, whatever a rebuild
+  // has done to the file since the image was loaded
+  auto descriptor = std::make_shared<FileDescriptor>();
+  struct stat info {};
+  if (!descriptor->open(file->path) || ::fstat(descriptor->get(), &info) != 0 ||
+      !S_ISREG(info.st_mode)) {
+    // Removed by a rebuild whose image isn't swapped in yet
+    res.status = 404;
+    res.set_content("Not Found", "text/plain");
+    return;
+  }
+
+  std::string etag = file_etag(info);
+  if (not_modified(file->status, etag)) {
+    return;
+  }
+
+  res.status = file->status;
+  res.set_file(std::move(descriptor), file->path,
+               static_cast<size_t>(info.st_size), file->content_type);
+  for (const auto &[key, value] : file->headers) {
+    res.headers[key] = value;
+  }
+  res.headers["ETag"] = etag;
+  res.headers["Last-Modified"] = format_http_date(info.st_mtim.tv_sec);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "server.hpp"
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// A file too large to preload, left on disk and streamed when requested.
+// Its length, ETag and Last-Modified are taken from the file each time it
+// is sent, so a rebuild writing it in place can't mislabel the new bytes.
+struct ImageFile {
+  int status = 200;
+  fs::path path;
+  std::string content_type;
+  std::vector<std::pair<std::string, std::string>> headers;
+};
+
+// Every response for one URL, prepared once when the image is loaded. Each
+// variant is either preloaded or, above SiteImage::preload_limit, a file.
+struct ImageEntry {
+  std::shared_ptr<const PreparedResponse> identity;
+  std::shared_ptr<const PreparedResponse> gzip;
+  std::shared_ptr<const ImageFile> identity_file;
+  std::shared_ptr<const ImageFile> gzip_file;
+};
+
+// An immutable copy of a built `dist` tree. Each file is mapped to its URL(s)
+// with headers, ETag and MIME type already formatted, and its bytes are held
+// in memory so the preview server doesn't touch the disk for pages and
+// assets. Large media is the exception and is streamed with sendfile. A
+// rebuilt image is swapped in as a whole; a loaded image is never modified.
+class SiteImage {
+public:
+  // Files above this many bytes are served from disk rather than preloaded
+  static constexpr size_t preload_limit = 1 << 20;
+
+  static std::shared_ptr<const SiteImage> load(const fs::path &dist_path);
+
+  // Looks up a request path, ignoring the query string and a trailing slash.
+  const ImageEntry *find(std::string_view url) const;
+
+  const ImageEntry &not_found() const { return not_found_; }
+
+  size_t file_count() const { return file_count_; }
+  // Bytes held in memory, and the files served from disk instead
+  size_t total_bytes() const { return total_bytes_; }
+  size_t streamed_count() const { return streamed_count_; }
+
+private:
+  std::unordered_map<std::string, ImageEntry> entries_;
+  ImageEntry not_found_;
+  size_t file_count_ = 0;
+  size_t total_bytes_ = 0;
+  size_t streamed_count_ = 0;
+};
+
+// Picks the variant of `entry` to send for `req`, honouring If-None-Match and
+// Accept-Encoding.
+void serve_image_entry(const ImageEntry &entry, const Request &req,
+                       Response &res);
@@ -1,20 +1,33 @@
 #pragma once
 
+#include "metrics.hpp"
+#include "reload_timings.hpp"
+#include "utils/log.hpp"
 #include "vendor/termcolor.hpp"
+#include <algorithm>
 #include <atomic>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
 #include <boost/beast/websocket.hpp>
 #include <chrono>
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <string>
-#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
+#include <vendor/nlohmann/json.hpp>
 
 namespace beast = boost::beast;
 namespace websocket = beast::websocket;
@@ -26,31 +39,54 @@ class WebSocketManager;
 class WebSocketSession : public std::enable_shared_from_this<WebSocketSession> {
 public:
   explicit WebSocketSession(tcp::socket socket, WebSocketManager *manager)
-      : ws_(std::move(socket)), manager_(manager) {}
+      : ws_(std::move(socket)), write_timer_(ws_.get_executor()),
+        manager_(manager) {}
 
-  void run() {
+  // Completes the handshake the client started with `upgrade`
+  void run(beast::http::request<beast::http::string_body> upgrade) {
+    upgrade_ = std::move(upgrade);
     ws_.set_option(
         websocket::stream_base::timeout::suggested(beast::role_type::server));
+    // Pushed pages are mostly repetitive markup, so they deflate well
+    websocket::permessage_deflate deflate;
+    deflate.server_enable = true;
+    ws_.set_option(deflate);
     ws_.set_option(
         websocket::stream_base::decorator([](websocket::response_type &res) {
           res.set(beast::http::field::server, "Forge-DevServer");
         }));
 
-    ws_.async_accept(beast::bind_front_handler(&WebSocketSession::on_accept,
+    ws_.async_accept(upgrade_,
+                     beast::bind_front_handler(&WebSocketSession::on_accept,
                                                shared_from_this()));
   }
 
-  void send(const std::string &message) {
-    net::post(ws_.get_executor(), [self = shared_from_this(), message]() {
-      self->queue_.push_back(message);
-      if (self->queue_.size() == 1) {
-        self->do_write();
-      }
-    });
+  // Queues a message shared with other sessions. A `supersedable` one
+  // replaces any such message still waiting, since only the newest reload
+  // matters; the one being written is left alone. `broadcast_at` is when
+  // the broadcast began, for the latency metric, and `version` the build a
+  // reload carries, so the client's paint report can be timed against it.
+  void send(std::shared_ptr<const std::string> message,
+            bool supersedable = false,
+            std::chrono::steady_clock::time_point broadcast_at =
+                std::chrono::steady_clock::now(),
+            uint64_t version = 0) {
+    net::post(ws_.get_executor(),
+              [self = shared_from_this(), message = std::move(message),
+               supersedable, broadcast_at, version]() mutable {
+                self->enqueue(
+                    {std::move(message), supersedable, broadcast_at, version});
+              });
   }
 
   bool is_open() const { return ws_.is_open(); }
 
+  // The page the client is showing, once it has said so
+  std::optional<std::string> page_url() const {
+    std::lock_guard<std::mutex> lock(page_url_mutex_);
+    return page_url_;
+  }
+
   std::string get_remote_address() const {
     try {
       return ws_.next_layer().remote_endpoint().address().to_string();
@@ -62,23 +98,13 @@ public:
 private:
   void on_accept(beast::error_code ec) {
     if (ec) {
-      std::cerr << termcolor::bright_red
-                << "✗ WebSocket accept error: " << termcolor::reset
-                << termcolor::bright_white << ec.message() << termcolor::reset
-                << "\n";
+      Log::instance().websocket(LogLevel::Error, get_remote_address(),
+                                "accept error: " + ec.message());
       return;
     }
 
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    std::tm tm = *std::localtime(&time);
-
-    std::cout << termcolor::bright_blue << std::put_time(&tm, "%H:%M:%S")
-              << termcolor::reset << " " << termcolor::bright_green
-              << "🔌 WebSocket" << termcolor::reset << " Client connected from "
-              << termcolor::bright_white << get_remote_address()
-              << termcolor::reset << "\n";
-
+    Log::instance().websocket(LogLevel::Info, get_remote_address(),
+                              "connected");
     do_read();
   }
 
@@ -90,140 +116,296 @@ private:
 
   void on_read(beast::error_code ec, std::size_t bytes) {
     if (ec == websocket::error::closed) {
-      auto now = std::chrono::system_clock::now();
-      auto time = std::chrono::system_clock::to_time_t(now);
-      std::tm tm = *std::localtime(&time);
-
-      std::cout << termcolor::bright_blue << std::put_time(&tm, "%H:%M:%S")
-                << termcolor::reset << " " << termcolor::bright_blue
-                << "🔌 WebSocket" << termcolor::reset
-                << " Connection closed by " << termcolor::bright_white
-                << get_remote_address() << termcolor::reset << "\n";
+      Log::instance().websocket(LogLevel::Info, get_remote_address(),
+                                "closed the connection");
+      forget();
       return;
     }
 
     if (ec) {
-      std::cerr << termcolor::bright_red
-                << "✗ WebSocket read error: " << termcolor::reset
-                << termcolor::bright_white << ec.message() << termcolor::reset
-                << "\n";
+      if (!closing_) {
+        Log::instance().websocket(LogLevel::Error, get_remote_address(),
+                                  "read error: " + ec.message());
+      }
+      forget();
       return;
     }
 
     std::string msg = beast::buffers_to_string(buffer_.data());
+    buffer_.clear();
 
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    std::tm tm = *std::localtime(&time);
+    // Reported by ReloadTimings once per change rather than per client
+    if (record_painted(msg)) {
+      do_read();
+      return;
+    }
 
-    std::cout << termcolor::bright_blue << std::put_time(&tm, "%H:%M:%S")
-              << termcolor::reset << " " << termcolor::bright_cyan
-              << "📩 WebSocket" << termcolor::reset << " Received "
-              << termcolor::bright_white << bytes << "B" << termcolor::reset
-              << " from " << termcolor::bright_white << get_remote_address()
-              << termcolor::reset << "\n";
+    if (auto url = registered_url(msg)) {
+      Log::instance().websocket(LogLevel::Info, get_remote_address(),
+                                "is viewing " + *url);
+
+      std::lock_guard<std::mutex> lock(page_url_mutex_);
+      page_url_ = std::move(url);
+    } else {
+      Log::instance().websocket(LogLevel::Info, get_remote_address(),
+                                std::format("sent {}B", bytes));
+    }
 
-    buffer_.clear();
     do_read();
   }
 
+  // The client sends {"type":"hello","url":"/path"} once the socket opens.
+  // Navigating loads a new page, which opens a new socket and says hello
+  // again, so a session's URL never changes after that.
+  static std::optional<std::string> registered_url(const std::string &msg) {
+    auto data = nlohmann::json::parse(msg, nullptr, false);
+    if (!data.is_object() || data.value("type", "") != "hello") {
+      return std::nullopt;
+    }
+    auto url = data.find("url");
+    if (url == data.end() || !url->is_string()) {
+      return std::nullopt;
+    }
+    return url->get<std::string>();
+  }
+
+  // After applying a reload the client sends {"type":"painted","version":
+  // V,"fetch":ms,"patch":ms}, timed from when the message arrived. A
+  // report for a version this session no longer remembers delivering is
+  // dropped rather than charged against a later delivery.
+  bool record_painted(const std::string &msg) {
+    auto data = nlohmann::json::parse(msg, nullptr, false);
+    if (!data.is_object() || data.value("type", "") != "painted") {
+      return false;
+    }
+    try {
+      auto version = data.at("version").get<uint64_t>();
+      auto delivered = std::find_if(
+          delivered_.begin(), delivered_.end(),
+          [version](const auto &entry) { return entry.first == version; });
+      if (delivered != delivered_.end()) {
+        ReloadTimings::instance().painted(version, delivered->second,
+                                          data.value("fetch", 0.0),
+                                          data.value("patch", 0.0));
+      }
+    } catch (const nlohmann::json::exception &) {
+      // A malformed report is dropped
+    }
+    return true;
+  }
+
+  struct Outgoing {
+    std::shared_ptr<const std::string> data;
+    bool supersedable;
+    std::chrono::steady_clock::time_point broadcast_at;
+    uint64_t version;
+  };
+
+  // A client counts as stalled once it falls this many messages behind, or
+  // hasn't taken a message for this long
+  static constexpr size_t max_queued = 16;
+  static constexpr std::chrono::seconds max_write_time{10};
+  // Reloads whose delivery time is kept for late paint reports
+  static constexpr size_t max_delivered = 8;
+
+  void enqueue(Outgoing message) {
+    if (closing_) {
+      return;
+    }
+
+    if (message.supersedable && queue_.size() > 1) {
+      // Index 0 is in flight
+      queue_.erase(std::remove_if(queue_.begin() + 1, queue_.end(),
+                                  [](const Outgoing &queued) {
+                                    return queued.supersedable;
+                                  }),
+                   queue_.end());
+    }
+
+    // A write that takes too long is caught by write_timer_
+    if (queue_.size() >= max_queued) {
+      close_slow_client();
+      return;
+    }
+
+    queue_.push_back(std::move(message));
+    if (queue_.size() == 1) {
+      do_write();
+    }
+  }
+
+  // A stalled client would never complete a close handshake either, so
+  // the socket is dropped; the pending write then fails and cleans up
+  void close_slow_client() {
+    if (closing_) {
+      return;
+    }
+    closing_ = true;
+    // The front message is still being written from
+    if (!queue_.empty()) {
+      queue_.erase(queue_.begin() + 1, queue_.end());
+    }
+
+    Log::instance().websocket(
+        LogLevel::Warn, get_remote_address(),
+        "stopped keeping up with messages and was disconnected");
+
+    forget();
+    beast::error_code ignored;
+    ws_.next_layer().shutdown(tcp::socket::shutdown_both, ignored);
+    ws_.next_layer().close(ignored);
+  }
+
   void do_write() {
-    ws_.async_write(net::buffer(queue_.front()),
+    // Fires even if nothing else is queued behind a hung write
+    write_timer_.expires_after(max_write_time);
+    write_timer_.async_wait(
+        [self = shared_from_this()](beast::error_code ec) {
+          if (ec != net::error::operation_aborted) {
+            self->close_slow_client();
+          }
+        });
+    ws_.async_write(net::buffer(*queue_.front().data),
                     beast::bind_front_handler(&WebSocketSession::on_write,
                                               shared_from_this()));
   }
 
-  void on_write(beast::error_code ec, std::size_t bytes) {
+  void on_write(beast::error_code ec, std::size_t) {
+    write_timer_.cancel();
     if (ec) {
-      std::cerr << termcolor::bright_red
-                << "✗ WebSocket write error: " << termcolor::reset
-                << termcolor::bright_white << ec.message() << termcolor::reset
-                << "\n";
+      if (!closing_) {
+        Log::instance().websocket(LogLevel::Error, get_remote_address(),
+                                  "write error: " + ec.message());
+      }
+      queue_.clear();
+      forget();
       return;
     }
 
-    queue_.erase(queue_.begin());
+    if (!queue_.empty()) {
+      auto now = std::chrono::steady_clock::now();
+      Metrics::instance().record_broadcast(now - queue_.front().broadcast_at);
+      if (queue_.front().supersedable) {
+        delivered_.emplace_back(queue_.front().version, now);
+        if (delivered_.size() > max_delivered) {
+          delivered_.pop_front();
+        }
+      }
+      queue_.pop_front();
+    }
     if (!queue_.empty()) {
       do_write();
     }
   }
 
+  // Drops the manager's reference; defined after WebSocketManager
+  void forget();
+
   websocket::stream<tcp::socket> ws_;
+  beast::http::request<beast::http::string_body> upgrade_;
   beast::flat_buffer buffer_;
-  std::vector<std::string> queue_;
+  std::deque<Outgoing> queue_;
+  net::steady_timer write_timer_;
+  // When each of the last few reload messages finished writing, by version
+  std::deque<std::pair<uint64_t, std::chrono::steady_clock::time_point>>
+      delivered_;
+  bool closing_ = false;
+  bool forgotten_ = false;
   WebSocketManager *manager_;
+  std::optional<std::string> page_url_;
+  mutable std::mutex page_url_mutex_;
 };
 
 class WebSocketManager {
 public:
-  WebSocketManager() = default;
-
-  bool start(int port = 8081) {
-    try {
-      running_ = true;
-
-      ws_thread_ = std::thread([this, port]() {
-        try {
-          ioc_ = std::make_unique<net::io_context>();
-          tcp::acceptor acceptor{*ioc_, tcp::endpoint(tcp::v4(), port)};
-          acceptor.set_option(net::socket_base::reuse_address(true));
-
-          std::cout << termcolor::bright_green << "✓ " << termcolor::reset
-                    << "WebSocket server listening on "
-                    << termcolor::bright_white << "ws://localhost:" << port
-                    << termcolor::reset << "\n";
+  // Renders the current HTML of a page URL; nullptr if it can't
+  using PageRenderer =
+      std::function<std::shared_ptr<const std::string>(const std::string &)>;
 
-          do_accept(acceptor);
+  WebSocketManager() = default;
 
-          ioc_->run();
+  void start() { running_ = true; }
 
-        } catch (const std::exception &e) {
-          if (running_.load()) {
-            std::cerr << termcolor::bright_red
-                      << "✗ WebSocket server error: " << termcolor::reset
-                      << termcolor::bright_white << e.what() << termcolor::reset
-                      << "\n";
-          }
-        }
-      });
-
-      return true;
-    } catch (const std::exception &e) {
-      std::cerr << termcolor::bright_red
-                << "✗ Failed to start WebSocket server: " << termcolor::reset
-                << termcolor::bright_white << e.what() << termcolor::reset
-                << "\n";
-      return false;
+  // Takes over a connection the HTTP server was asked to upgrade. Sessions
+  // run on that connection's strand, in the same io_context as the pages.
+  void accept(tcp::socket socket,
+              beast::http::request<beast::http::string_body> upgrade) {
+    if (!running_.load()) {
+      return;
     }
+
+    auto session = std::make_shared<WebSocketSession>(std::move(socket), this);
+    add_session(session);
+    session->run(std::move(upgrade));
   }
 
   void add_session(std::shared_ptr<WebSocketSession> session) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    sessions_.insert(session);
+    size_t total;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (sessions_.insert(session).second) {
+        Metrics::instance().add_websocket_clients(1);
+      }
+      total = sessions_.size();
+    }
 
-    std::cout << termcolor::bright_green << "✓ " << termcolor::reset
-              << "WebSocket client connected " << termcolor::bright_blue
-              << "(total: " << sessions_.size() << ")" << termcolor::reset
-              << "\n";
+    Log::instance().websocket(LogLevel::Info, session->get_remote_address(),
+                              std::format("opened (total: {})", total));
   }
 
   void remove_session(std::shared_ptr<WebSocketSession> session) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    sessions_.erase(session);
+    size_t total;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (sessions_.erase(session)) {
+        Metrics::instance().add_websocket_clients(-1);
+      }
+      total = sessions_.size();
+    }
 
-    std::cout << termcolor::bright_blue << "→ " << termcolor::reset
-              << "WebSocket client disconnected " << termcolor::bright_blue
-              << "(total: " << sessions_.size() << ")" << termcolor::reset
-              << "\n";
+    Log::instance().websocket(LogLevel::Info, session->get_remote_address(),
+                              std::format("left (total: {})", total));
   }
 
-  void broadcast_reload(const std::string &change_type, uint64_t version) {
+  // Sends to every client, or with `shows_affected` only to clients whose
+  // page it accepts; clients that haven't said which page they show always
+  // get it. With `render`, clients that did are sent their page's new HTML
+  // in the message (rendered once per page) so they don't have to fetch
+  // it. Returns how many clients were sent the message.
+  size_t broadcast_reload(
+      const std::string &change_type, uint64_t version,
+      const std::function<bool(const std::string &)> &shows_affected = {},
+      const PageRenderer &render = {}) {
     if (shutting_down_.load() || !running_.load()) {
-      return;
+      return 0;
     }
-
-    std::string message =
-        std::format("{{\"type\":\"{}\",\"version\":{}}}", change_type, version);
+    auto started = std::chrono::steady_clock::now();
+
+    // Built once and shared by every session's queue
+    auto message = std::make_shared<const std::string>(std::format(
+        "{{\"type\":\"{}\",\"version\":{}}}", change_type, version));
+
+    // Null where the page couldn't be rendered
+    std::unordered_map<std::string, std::shared_ptr<const std::string>>
+        page_messages;
+    auto message_for = [&](const std::optional<std::string> &url) {
+      if (!render || !url) {
+        return message;
+      }
+      auto it = page_messages.find(*url);
+      if (it == page_messages.end()) {
+        std::shared_ptr<const std::string> pushed;
+        if (auto html = render(*url)) {
+          pushed = std::make_shared<const std::string>(
+              nlohmann::json{{"type", change_type},
+                             {"version", version},
+                             {"html", *html}}
+                  .dump());
+        }
+        it = page_messages.emplace(*url, std::move(pushed)).first;
+      }
+      return it->second ? it->second : message;
+    };
 
     std::vector<std::shared_ptr<WebSocketSession>> sessions_copy;
     {
@@ -236,11 +418,22 @@ public:
 
     size_t sent_count = 0;
     size_t failed_count = 0;
+    size_t skipped_count = 0;
+    size_t pushed_count = 0;
 
     for (const auto &session : sessions_copy) {
       if (session->is_open()) {
+        auto url = session->page_url();
+        if (shows_affected && url && !shows_affected(*url)) {
+          skipped_count++;
+          continue;
+        }
         try {
-          session->send(message);
+          auto payload = message_for(url);
+          if (payload != message) {
+            pushed_count++;
+          }
+          session->send(std::move(payload), true, started, version);
           sent_count++;
         } catch (const std::exception &e) {
           failed_count++;
@@ -253,6 +446,8 @@ public:
     }
 
     if (sent_count > 0) {
+      // After the client lines queued before it
+      Log::instance().flush();
       auto now = std::chrono::system_clock::now();
       auto time = std::chrono::system_clock::to_time_t(now);
       std::tm tm = *std::localtime(&time);
@@ -274,9 +469,66 @@ public:
         std::cout << termcolor::bright_red << " (" << failed_count << " failed)"
                   << termcolor::reset;
       }
+      if (pushed_count > 0) {
+        std::cout << termcolor::bright_blue << " (" << pushed_count
+                  << " with HTML)" << termcolor::reset;
+      }
+      if (skipped_count > 0) {
+        std::cout << termcolor::bright_blue << " (" << skipped_count
+                  << " unaffected)" << termcolor::reset;
+      }
 
       std::cout << "\n";
     }
+
+    return sent_count;
+  }
+
+  // Tells every client to swap the stylesheets served at `paths` (URL
+  // paths such as /static/styles.css) without touching the page
+  size_t broadcast_css(const std::vector<std::string> &paths,
+                       uint64_t version) {
+    if (shutting_down_.load() || !running_.load()) {
+      return 0;
+    }
+    auto started = std::chrono::steady_clock::now();
+
+    auto message = std::make_shared<const std::string>(
+        nlohmann::json{{"type", "css"}, {"version", version}, {"paths", paths}}
+            .dump());
+
+    std::vector<std::shared_ptr<WebSocketSession>> sessions_copy;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      sessions_copy.assign(sessions_.begin(), sessions_.end());
+    }
+
+    size_t sent_count = 0;
+    for (const auto &session : sessions_copy) {
+      if (session->is_open()) {
+        session->send(message, false, started);
+        sent_count++;
+      }
+    }
+
+    if (sent_count > 0) {
+      Log::instance().flush();
+      auto now = std::chrono::system_clock::now();
+      auto time = std::chrono::system_clock::to_time_t(now);
+      std::tm tm = *std::localtime(&time);
+
+      std::cout << termcolor::bright_blue << std::put_time(&tm, "%H:%M:%S")
+                << termcolor::reset << " " << termcolor::bright_magenta
+                << "📡 Broadcast" << termcolor::reset << " "
+                << termcolor::bright_cyan << "css" << termcolor::reset
+                << " (" << paths.size()
+                << (paths.size() == 1 ? " stylesheet" : " stylesheets")
+                << ") to " << termcolor::bright_white << sent_count
+                << termcolor::reset
+                << (sent_count == 1 ? " client" : " clients") << "\n";
+    }
+
+    return sent_count;
   }
 
   void stop() {
@@ -284,15 +536,12 @@ public:
       return;
     }
 
+    Log::instance().flush();
     std::cout << termcolor::bright_yellow << "⏳ Stopping WebSocket server..."
               << termcolor::reset << "\n";
 
     shutting_down_ = true;
 
-    if (ioc_) {
-      ioc_->stop();
-    }
-
     {
       std::lock_guard<std::mutex> lock(mutex_);
       if (!sessions_.empty()) {
@@ -300,13 +549,11 @@ public:
                   << "Closing " << termcolor::bright_white << sessions_.size()
                   << termcolor::reset << " active WebSocket connections\n";
       }
+      Metrics::instance().add_websocket_clients(
+          -static_cast<int64_t>(sessions_.size()));
       sessions_.clear();
     }
 
-    if (ws_thread_.joinable()) {
-      ws_thread_.join();
-    }
-
     shutting_down_ = false;
 
     std::cout << termcolor::bright_green << "✓ " << termcolor::reset
@@ -321,31 +568,16 @@ public:
   ~WebSocketManager() { stop(); }
 
 private:
-  void do_accept(tcp::acceptor &acceptor) {
-    acceptor.async_accept(
-        [this, &acceptor](beast::error_code ec, tcp::socket socket) {
-          if (!ec) {
-            auto session =
-                std::make_shared<WebSocketSession>(std::move(socket), this);
-            add_session(session);
-            session->run();
-          } else if (ec != net::error::operation_aborted) {
-            std::cerr << termcolor::bright_red
-                      << "✗ WebSocket accept error: " << termcolor::reset
-                      << termcolor::bright_white << ec.message()
-                      << termcolor::reset << "\n";
-          }
-
-          if (running_.load()) {
-            do_accept(acceptor);
-          }
-        });
-  }
-
   std::set<std::shared_ptr<WebSocketSession>> sessions_;
   mutable std::mutex mutex_;
-  std::thread ws_thread_;
-  std::unique_ptr<net::io_context> ioc_;
   std::atomic<bool> running_{false};
   std::atomic<bool> shutting_down_{false};
-};
\ No newline at end of file
+};
+
+inline void WebSocketSession::forget() {
+  if (forgotten_) {
+    return;
+  }
+  forgotten_ = true;
+  manager_->remove_session(shared_from_this());
+}
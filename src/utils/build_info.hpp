@@ -1,9 +1,14 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 
 class BuildInfo {
 private:
-  uint64_t BUILD_VERSION_;
+  // Read by request threads while the watcher thread bumps it
+  std::atomic<uint64_t> BUILD_VERSION_{0};
 
   BuildInfo() {}
 
@@ -16,14 +21,26 @@ public:
     return instance;
   }
 
-  const uint64_t &getVersion() const { return BUILD_VERSION_; }
+  uint64_t getVersion() const { return BUILD_VERSION_.load(); }
 
-  void setVersion(const uint64_t &new_version) { BUILD_VERSION_ = new_version; }
+  void setVersion(const uint64_t &new_version) {
+    BUILD_VERSION_.store(new_version);
+  }
 
-  void generate_build_version() {
+  // The current time in milliseconds, bumped past the previous version if
+  // two rebuilds land in the same millisecond, so a version names exactly
+  // one rebuild (reload timings are keyed by it)
+  uint64_t generate_build_version() {
     auto now = std::chrono::system_clock::now();
     auto duration = now.time_since_epoch();
-    setVersion(std::chrono::duration_cast<std::chrono::milliseconds>(duration)
-                   .count());
+    uint64_t version =
+        std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+
+    uint64_t previous = BUILD_VERSION_.load();
+    uint64_t next;
+    do {
+      next = std::max(version, previous + 1);
+    } while (!BUILD_VERSION_.compare_exchange_weak(previous, next));
+    return next;
   }
 };
@@ -0,0 +1,40 @@
+#include "compression.hpp"
+#include <stdexcept>
+#include <unordered_set>
+#include <zlib.h>
+
+std::string gzip_compress(const std::string &data, int level) {
+  z_stream stream{};
+
+  // windowBits 15 + 16 asks zlib for a gzip header instead of a zlib one
+  if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 9,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("gzip: deflateInit2 failed");
+  }
+
+  std::string output;
+  output.resize(deflateBound(&stream, data.size()));
+
+  stream.next_in =
+      reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef *>(output.data());
+  stream.avail_out = static_cast<uInt>(output.size());
+
+  int result = deflate(&stream, Z_FINISH);
+  deflateEnd(&stream);
+
+  if (result != Z_STREAM_END) {
+    throw std::runtime_error("gzip: deflate did not finish");
+  }
+
+  output.resize(stream.total_out);
+  return output;
+}
+
+bool is_compressible(const std::filesystem::path &path) {
+  static const std::unordered_set<std::string> extensions = {
+      ".html", ".css", ".js",  ".mjs", ".json", ".svg",
+      ".xml",  ".txt", ".map", ".ico", ".webmanifest"};
+  return extensions.count(path.extension().string()) > 0;
+}
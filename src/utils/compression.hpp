@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+
+// gzip-encodes `data`. `level` follows zlib: 1 (fastest) to 9 (smallest),
+// or -1 for zlib's default trade-off.
+std::string gzip_compress(const std::string &data, int level = 9);
+
+// Text formats worth compressing; images, fonts and archives are already
+// compressed and only get bigger.
+bool is_compressible(const std::filesystem::path &path);
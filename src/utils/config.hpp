@@ -4,6 +4,7 @@
 #include <any>
 #include <filesystem>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -26,6 +27,31 @@ struct MinifyConfig {
   bool js = true;
 };
 
+struct PrecompressConfig {
+  bool gzip = false;
+  size_t min_size = 1024;
+};
+
+struct DevConfig {
+  // Quiet period before a burst of file events triggers a rebuild
+  unsigned debounce_ms = 100;
+  // Globs for files the watcher ignores (see IgnoreRules)
+  std::vector<std::string> ignore = {"node_modules", ".git", ".DS_Store",
+                                     "*.swp", "*.swo", "*.swx", "*~",
+                                     ".#*", "#*#", "4913"};
+};
+
+// Limits `forge build` checks once it's done; unset ones aren't checked
+struct BudgetConfig {
+  std::optional<double> max_build_ms;
+  // Any one page's HTML, after minification
+  std::optional<double> max_page_kb;
+  // A page plus every asset it loads, gzipped where that applies
+  std::optional<double> max_page_weight_kb;
+  // The whole output directory, not counting precompressed copies
+  std::optional<double> max_total_kb;
+};
+
 struct ConfigValue {
   enum Type { STRING, LIST, MAP };
 
@@ -81,12 +107,18 @@ public:
 
   bool minify_output = false;
   MinifyConfig minify;
+  PrecompressConfig precompress;
+  DevConfig dev;
+  BudgetConfig budgets;
 
   std::string github_url;
   std::string x_twitter_url;
 
   std::string output_dir;
   std::string static_dir;
+  // Where static_dir is served: a build copies it to output_dir/static,
+  // and the dev server mounts it there
+  static constexpr const char *static_url = "/static";
   std::string content_dir;
   std::string templates_dir;
 
@@ -186,6 +218,45 @@ public:
       }
     }
 
+    if (yaml["precompress"]) {
+      if (yaml["precompress"]["gzip"]) {
+        config.precompress.gzip = yaml["precompress"]["gzip"].as<bool>();
+      }
+      if (yaml["precompress"]["min_size"]) {
+        config.precompress.min_size =
+            yaml["precompress"]["min_size"].as<size_t>();
+      }
+    }
+
+    if (yaml["dev"]) {
+      if (yaml["dev"]["debounce_ms"]) {
+        config.dev.debounce_ms = yaml["dev"]["debounce_ms"].as<unsigned>();
+      }
+      if (yaml["dev"]["ignore"]) {
+        // Extends the defaults rather than replacing them
+        for (const auto &pattern : yaml["dev"]["ignore"]) {
+          config.dev.ignore.push_back(pattern.as<std::string>());
+        }
+      }
+    }
+
+    if (yaml["budgets"]) {
+      YAML::Node budgets = yaml["budgets"];
+      if (budgets["max_build_ms"]) {
+        config.budgets.max_build_ms = budgets["max_build_ms"].as<double>();
+      }
+      if (budgets["max_page_kb"]) {
+        config.budgets.max_page_kb = budgets["max_page_kb"].as<double>();
+      }
+      if (budgets["max_page_weight_kb"]) {
+        config.budgets.max_page_weight_kb =
+            budgets["max_page_weight_kb"].as<double>();
+      }
+      if (budgets["max_total_kb"]) {
+        config.budgets.max_total_kb = budgets["max_total_kb"].as<double>();
+      }
+    }
+
     return config;
   }
 
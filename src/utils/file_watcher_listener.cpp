@@ -1,9 +1,13 @@
 #include "file_watcher_listener.hpp"
 #include "build_info.hpp"
 #include "core/site_builder.hpp"
+#include "server/metrics.hpp"
+#include "server/reload_timings.hpp"
 #include "server/websocket_manager.hpp"
 #include "vendor/termcolor.hpp"
+#include <algorithm>
 #include <chrono>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 
@@ -13,7 +17,29 @@ extern std::atomic<WebSocketManager *> ws_manager;
 
 DevServerListener::DevServerListener(const fs::path &root, SiteBuilder *b)
     : project_root(root), builder(b),
-      watched_extensions({".md", ".yaml", ".yml", ".html", ".css", ".js"}) {}
+      watched_extensions({".md", ".yaml", ".yml", ".html", ".css", ".js"}),
+      ignore_rules(b->get_config().dev.ignore) {
+  queue = std::make_unique<RebuildQueue>(
+      std::chrono::milliseconds(b->get_config().dev.debounce_ms),
+      [this](const ChangeSet &changes) { rebuild(changes); });
+}
+
+bool DevServerListener::should_watch(const fs::path &path,
+                                     bool allow_directories) const {
+  std::string filename = path.filename().string();
+  if (filename.empty() || filename[0] == '.' || filename[0] == '~') {
+    return false;
+  }
+
+  std::string ext = path.extension().string();
+  bool maybe_directory = allow_directories && ext.empty();
+  if (!maybe_directory &&
+      watched_extensions.find(ext) == watched_extensions.end()) {
+    return false;
+  }
+
+  return !ignore_rules.matches(fs::relative(path, project_root));
+}
 
 void DevServerListener::handleFileAction(efsw::WatchID watchid,
                                          const std::string &dir,
@@ -21,84 +47,157 @@ void DevServerListener::handleFileAction(efsw::WatchID watchid,
                                          efsw::Action action,
                                          std::string oldFilename) {
   (void)watchid;
-  (void)oldFilename;
 
-  if (filename.empty() || filename[0] == '.' || filename[0] == '~') {
-    return;
+  fs::path changed = fs::path(dir) / filename;
+
+  switch (action) {
+  case efsw::Actions::Add:
+    if (should_watch(changed)) {
+      queue->push({changed, ChangeKind::Added});
+    }
+    break;
+  case efsw::Actions::Modified:
+    if (should_watch(changed)) {
+      queue->push({changed, ChangeKind::Modified});
+    }
+    break;
+  case efsw::Actions::Delete:
+    // Removed directories are only reported once, by their own name
+    if (should_watch(changed, true)) {
+      queue->push({changed, ChangeKind::Removed});
+    }
+    break;
+  case efsw::Actions::Moved: {
+    // A rename is the old path going away and the new one appearing;
+    // editors that save via a temp file land here too
+    fs::path old_path = fs::path(dir) / oldFilename;
+    if (!oldFilename.empty() && should_watch(old_path, true)) {
+      queue->push({old_path, ChangeKind::Removed});
+    }
+    if (should_watch(changed, true)) {
+      queue->push({changed, ChangeKind::Added});
+    }
+    break;
   }
+  }
+}
 
-  fs::path modified = fs::path(dir) / filename;
-  std::string ext = modified.extension().string();
+// Whether the project-relative `path` lies in the project folder `dir`,
+// compared by whole path components
+static bool in_folder(const fs::path &path, const std::string &dir) {
+  fs::path rest = path.lexically_relative(fs::path(dir).lexically_normal());
+  return !rest.empty() && *rest.begin() != "..";
+}
 
-  if (watched_extensions.find(ext) == watched_extensions.end()) {
-    return;
-  }
+// What kind of refresh the clients need for one changed file
+static std::string classify_change(const fs::path &relative,
+                                   const SiteConfig &config) {
+  std::string ext = relative.extension().string();
 
-  if (action != efsw::Actions::Modified && action != efsw::Actions::Add) {
-    return;
+  // Stylesheets in the templates folder aren't served; they only reach a
+  // page through an include, so they need a rebuild like any template
+  if (in_folder(relative, config.templates_dir)) {
+    return "template";
+  } else if (ext == ".css") {
+    return "css";
+  } else if (ext == ".js") {
+    return "js";
+  } else if (ext == ".yaml" || ext == ".yml") {
+    return "config";
+  } else if (in_folder(relative, config.content_dir)) {
+    return "content";
   }
+  return "reload";
+}
 
+void DevServerListener::rebuild(const ChangeSet &changes) {
   auto rebuild_start = std::chrono::high_resolution_clock::now();
-
-  fs::path relative = fs::relative(modified, project_root);
-  std::string change_type = "reload";
+  auto started = std::chrono::steady_clock::now();
 
   auto now = std::chrono::system_clock::now();
   auto time = std::chrono::system_clock::to_time_t(now);
   std::tm tm = *std::localtime(&time);
 
-  std::cout << "\n"
-            << termcolor::bright_blue << std::put_time(&tm, "%H:%M:%S")
-            << termcolor::reset << " ";
+  std::cout << "\n";
 
-  if (action == efsw::Actions::Add) {
-    std::cout << termcolor::bright_green << "➕ Added" << termcolor::reset;
-  } else {
-    std::cout << termcolor::bright_cyan << "📝 Modified" << termcolor::reset;
-  }
+  std::unordered_set<std::string> change_types;
 
-  std::cout << " " << termcolor::bright_white << relative.string()
-            << termcolor::reset;
+  for (const auto &change : changes.changes()) {
+    fs::path relative = fs::relative(change.path, project_root);
+    std::string ext = relative.extension().string();
 
-  if (ext == ".md") {
-    std::cout << termcolor::bright_blue << " [markdown]" << termcolor::reset;
-  } else if (ext == ".html") {
-    std::cout << termcolor::bright_magenta << " [html]" << termcolor::reset;
-  } else if (ext == ".css") {
-    std::cout << termcolor::bright_yellow << " [css]" << termcolor::reset;
-  } else if (ext == ".js") {
-    std::cout << termcolor::bright_green << " [javascript]" << termcolor::reset;
-  } else if (ext == ".yaml" || ext == ".yml") {
-    std::cout << termcolor::bright_cyan << " [config]" << termcolor::reset;
+    std::cout << termcolor::bright_blue << std::put_time(&tm, "%H:%M:%S")
+              << termcolor::reset << " ";
+
+    if (change.kind == ChangeKind::Added) {
+      std::cout << termcolor::bright_green << "➕ Added" << termcolor::reset;
+    } else if (change.kind == ChangeKind::Removed) {
+      std::cout << termcolor::bright_red << "➖ Removed" << termcolor::reset;
+    } else {
+      std::cout << termcolor::bright_cyan << "📝 Modified" << termcolor::reset;
+    }
+
+    std::cout << " " << termcolor::bright_white << relative.string()
+              << termcolor::reset;
+
+    if (ext == ".md") {
+      std::cout << termcolor::bright_blue << " [markdown]" << termcolor::reset;
+    } else if (ext == ".html") {
+      std::cout << termcolor::bright_magenta << " [html]" << termcolor::reset;
+    } else if (ext == ".css") {
+      std::cout << termcolor::bright_yellow << " [css]" << termcolor::reset;
+    } else if (ext == ".js") {
+      std::cout << termcolor::bright_green << " [javascript]"
+                << termcolor::reset;
+    } else if (ext == ".yaml" || ext == ".yml") {
+      std::cout << termcolor::bright_cyan << " [config]" << termcolor::reset;
+    }
+
+    std::cout << "\n";
+
+    change_types.insert(classify_change(relative, builder->get_config()));
   }
 
-  std::cout << "\n";
+  // Stylesheets need no rebuild: clients swap the changed <link>s in place
+  if (change_types.size() == 1 && change_types.count("css")) {
+    hot_swap_stylesheets(changes, rebuild_start);
+    return;
+  }
+
+  // One message for the whole batch. Template and content changes are both
+  // handled by re-fetching the page; any other mix needs a full reload.
+  std::string change_type = "reload";
+  if (change_types.size() == 1) {
+    change_type = *change_types.begin();
+  } else if (std::all_of(change_types.begin(), change_types.end(),
+                         [](const std::string &type) {
+                           return type == "template" || type == "content" ||
+                                  type == "reload";
+                         })) {
+    change_type = change_types.count("template") ? "template" : "content";
+  } else {
+    change_type = "full";
+  }
 
   try {
 
-    if (relative.string().find("templates") == 0) {
-      change_type = "template";
+    if (change_types.count("template")) {
       std::cout << termcolor::bright_blue << "  🔄 Reloading templates..."
                 << termcolor::reset << "\n";
-
-      fs::path base_path = project_root / "templates" / "base.html";
-      if (fs::exists(base_path)) {
-        builder->reload_base_template(base_path);
-      }
-    } else if (ext == ".css") {
-      change_type = "css";
+    }
+    if (change_types.count("css")) {
       std::cout << termcolor::bright_yellow << "  🎨 CSS update detected"
                 << termcolor::reset << "\n";
-    } else if (ext == ".js") {
-      change_type = "js";
+    }
+    if (change_types.count("js")) {
       std::cout << termcolor::bright_green << "  ⚡ JavaScript update detected"
                 << termcolor::reset << "\n";
-    } else if (ext == ".yaml" || ext == ".yml") {
-      change_type = "config";
+    }
+    if (change_types.count("config")) {
       std::cout << termcolor::bright_cyan << "  ⚙️  Configuration changed"
                 << termcolor::reset << "\n";
-    } else if (relative.string().find("content") == 0) {
-      change_type = "content";
+    }
+    if (change_types.count("content")) {
       std::cout << termcolor::bright_magenta << "  📄 Content updated"
                 << termcolor::reset << "\n";
     }
@@ -106,35 +205,82 @@ void DevServerListener::handleFileAction(efsw::WatchID watchid,
     std::cout << termcolor::bright_cyan << "  🔨 Rebuilding site..."
               << termcolor::reset << "\n";
 
-    builder->discover_content();
-    BuildInfo::getInstance().generate_build_version();
+    // The new snapshot carries the version it was discovered under, and
+    // the reload timings follow the change under the same version
+    uint64_t version = BuildInfo::getInstance().generate_build_version();
+    ReloadTimings &timings = ReloadTimings::instance();
+    timings.begin(version, changes.first_seen(), started);
+    ContentUpdate update = builder->update_content(changes);
+    timings.rebuilt(version);
 
     auto rebuild_end = std::chrono::high_resolution_clock::now();
     auto rebuild_duration =
         std::chrono::duration_cast<std::chrono::milliseconds>(rebuild_end -
                                                               rebuild_start);
+    Metrics::instance().record_rebuild(rebuild_end - rebuild_start);
 
     std::cout << termcolor::bright_green << "  ✓ " << termcolor::reset
               << "Rebuild complete in " << termcolor::bright_white
               << rebuild_duration.count() << "ms" << termcolor::reset
               << termcolor::bright_blue << " (v"
-              << BuildInfo::getInstance().getVersion() << ")"
-              << termcolor::reset << "\n";
+              << BuildInfo::getInstance().getVersion();
+    if (changes.size() > 1) {
+      std::cout << ", " << changes.size() << " files";
+    }
+    std::cout << (update.incremental ? ", incremental" : ", full");
+    std::cout << ")" << termcolor::reset << "\n";
+
+    std::cout << termcolor::bright_blue << "  🔗 " << termcolor::reset
+              << termcolor::bright_white << update.affected_urls.size()
+              << termcolor::reset
+              << (update.affected_urls.size() == 1 ? " page" : " pages")
+              << " affected\n";
+
+    if (on_rebuild) {
+      on_rebuild(version);
+    }
+    timings.rendered(version);
 
     WebSocketManager *ws = ws_manager.load();
     if (ws) {
       size_t client_count = ws->client_count();
       if (client_count > 0) {
-        ws->broadcast_reload(change_type,
-                             BuildInfo::getInstance().getVersion());
+        // Content and template edits only reach tabs showing a page they
+        // affect. Anything else (stylesheets, scripts, config) may change
+        // every page.
+        std::function<bool(const std::string &)> shows_affected;
+        if (update.incremental &&
+            (change_type == "template" || change_type == "content")) {
+          auto site = builder->snapshot();
+          shows_affected = [&update, site](const std::string &url) {
+            if (update.affected_urls.count(url)) {
+              return true;
+            }
+            // Unknown URLs are showing the 404 page
+            return !site->find(url) && update.affected_urls.count("/404");
+          };
+        }
+
+        // Types the client applies by morphing the page; the others make
+        // it reload or only touch stylesheets
+        bool morphs = change_type == "reload" || change_type == "template" ||
+                      change_type == "content";
+
+        timings.notifying(version);
+        size_t notified = ws->broadcast_reload(
+            change_type, version, shows_affected,
+            morphs ? render_page : WebSocketManager::PageRenderer());
         std::cout << termcolor::bright_magenta << "  📡 Notified "
-                  << termcolor::bright_white << client_count
-                  << termcolor::reset;
-        if (client_count == 1) {
+                  << termcolor::bright_white << notified << termcolor::reset;
+        if (notified == 1) {
           std::cout << " client";
         } else {
           std::cout << " clients";
         }
+        if (notified < client_count) {
+          std::cout << termcolor::bright_blue << " of " << client_count
+                    << termcolor::reset;
+        }
         std::cout << "\n";
       } else {
         std::cout << termcolor::bright_blue << "  ℹ  No clients connected"
@@ -145,9 +291,49 @@ void DevServerListener::handleFileAction(efsw::WatchID watchid,
     std::cout << "\n";
 
   } catch (const std::exception &e) {
+    Metrics::instance().record_rebuild_failure();
     std::cerr << termcolor::bright_red
               << "  ✗ Rebuild failed: " << termcolor::reset
               << termcolor::bright_white << e.what() << termcolor::reset
               << "\n\n";
   }
-}
\ No newline at end of file
+}
+
+void DevServerListener::hot_swap_stylesheets(
+    const ChangeSet &changes,
+    std::chrono::high_resolution_clock::time_point start) {
+  std::cout << termcolor::bright_yellow << "  🎨 CSS update detected"
+            << termcolor::reset << "\n";
+
+  // The dev server mounts the static folder at SiteConfig::static_url;
+  // anything else is addressed relative to the project root
+  fs::path static_dir =
+      (project_root / builder->get_config().static_dir).lexically_normal();
+  std::vector<std::string> paths;
+  for (const auto &change : changes.changes()) {
+    fs::path path = change.path.lexically_normal();
+    fs::path in_static = path.lexically_relative(static_dir);
+    if (!in_static.empty() && *in_static.begin() != "..") {
+      paths.push_back(std::string(SiteConfig::static_url) + "/" +
+                      in_static.generic_string());
+    } else {
+      paths.push_back("/" + path.lexically_relative(project_root)
+                                .generic_string());
+    }
+  }
+
+  size_t notified = 0;
+  if (WebSocketManager *ws = ws_manager.load()) {
+    notified =
+        ws->broadcast_css(paths, BuildInfo::getInstance().getVersion());
+  }
+
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::high_resolution_clock::now() - start);
+  std::cout << termcolor::bright_green << "  ✓ " << termcolor::reset
+            << "Stylesheets swapped without a rebuild in "
+            << termcolor::bright_white << duration.count() << "µs"
+            << termcolor::reset << termcolor::bright_blue << " ("
+            << notified << (notified == 1 ? " client" : " clients") << ")"
+            << termcolor::reset << "\n\n";
+}
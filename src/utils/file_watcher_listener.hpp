@@ -1,7 +1,12 @@
 #pragma once
 
+#include "rebuild_queue.hpp"
+#include <chrono>
+#include <cstdint>
 #include <efsw/efsw.hpp>
 #include <filesystem>
+#include <functional>
+#include <memory>
 #include <string>
 #include <unordered_set>
 
@@ -12,10 +17,39 @@ private:
   std::filesystem::path project_root;
   SiteBuilder *builder;
   std::unordered_set<std::string> watched_extensions;
+  IgnoreRules ignore_rules;
+  std::function<void(uint64_t)> on_rebuild;
+  std::function<std::shared_ptr<const std::string>(const std::string &)>
+      render_page;
+  // Declared last so its worker is joined before the rest is torn down
+  std::unique_ptr<RebuildQueue> queue;
+
+  bool should_watch(const std::filesystem::path &path,
+                    bool allow_directories = false) const;
+  void rebuild(const ChangeSet &changes);
+  void hot_swap_stylesheets(
+      const ChangeSet &changes,
+      std::chrono::high_resolution_clock::time_point start);
 
 public:
   DevServerListener(const std::filesystem::path &root, SiteBuilder *b);
 
+  // Called with the new build version after every successful rebuild,
+  // before clients are told to reload.
+  void set_rebuild_callback(std::function<void(uint64_t)> callback) {
+    on_rebuild = std::move(callback);
+  }
+
+  // Renders a page URL from the current snapshot, so reload messages can
+  // carry the new HTML instead of making every tab fetch it
+  void set_page_renderer(
+      std::function<std::shared_ptr<const std::string>(const std::string &)>
+          renderer) {
+    render_page = std::move(renderer);
+  }
+
+  // Runs on the efsw thread: filters the event and queues it. Rebuilds
+  // happen on the queue's worker once the burst of events settles.
   void handleFileAction(efsw::WatchID watchid, const std::string &dir,
                         const std::string &filename, efsw::Action action,
                         std::string oldFilename = "") override;
@@ -0,0 +1,306 @@
+#include "log.hpp"
+#include "vendor/termcolor.hpp"
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <vendor/nlohmann/json.hpp>
+
+Log::Log() : slots_(std::make_unique<std::array<Slot, capacity>>()) {
+  for (size_t i = 0; i < capacity; ++i) {
+    (*slots_)[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  thread_ = std::thread([this]() { drain(); });
+}
+
+Log::~Log() {
+  stopping_ = true;
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+  }
+  wake_.notify_one();
+  thread_.join();
+}
+
+bool Log::open_json(const std::filesystem::path &path) {
+  // Nothing may be mid-write while the stream is opened
+  flush();
+  json_.open(path, std::ios::out | std::ios::trunc);
+  if (!json_.is_open()) {
+    return false;
+  }
+  json_enabled_.store(true, std::memory_order_release);
+  return true;
+}
+
+bool Log::wants(LogLevel level) const {
+  return level >= level_.load(std::memory_order_relaxed) ||
+         json_enabled_.load(std::memory_order_relaxed);
+}
+
+void Log::request(std::string method, std::string path, int status,
+                  size_t bytes) {
+  if (!wants(LogLevel::Info)) {
+    return;
+  }
+  push({Event::Request, LogLevel::Info, std::chrono::system_clock::now(),
+        std::move(path), std::move(method), status, bytes});
+}
+
+void Log::file(std::string path, std::string note) {
+  if (!wants(LogLevel::Info)) {
+    return;
+  }
+  push({Event::File, LogLevel::Info, std::chrono::system_clock::now(),
+        std::move(path), std::move(note)});
+}
+
+void Log::page(std::string url, std::string error) {
+  LogLevel level = error.empty() ? LogLevel::Info : LogLevel::Error;
+  if (!wants(level)) {
+    return;
+  }
+  push({Event::Page, level, std::chrono::system_clock::now(), std::move(url),
+        std::move(error)});
+}
+
+void Log::websocket(LogLevel level, std::string client,
+                    std::string message) {
+  if (!wants(level)) {
+    return;
+  }
+  push({Event::WebSocket, level, std::chrono::system_clock::now(),
+        std::move(client), std::move(message)});
+}
+
+void Log::timing(std::string breakdown, std::string recent) {
+  if (!wants(LogLevel::Info)) {
+    return;
+  }
+  push({Event::Timing, LogLevel::Info, std::chrono::system_clock::now(),
+        std::move(breakdown), std::move(recent)});
+}
+
+void Log::push(Record record) {
+  size_t pos = tail_.load(std::memory_order_relaxed);
+  for (;;) {
+    Slot &slot = (*slots_)[pos % capacity];
+    size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+    if (sequence == pos) {
+      if (tail_.compare_exchange_weak(pos, pos + 1,
+                                      std::memory_order_relaxed)) {
+        slot.record = std::move(record);
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        break;
+      }
+    } else if (sequence < pos) {
+      // Full: wait for the drain thread rather than lose the line
+      {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+      }
+      wake_.notify_one();
+      std::this_thread::yield();
+      pos = tail_.load(std::memory_order_relaxed);
+    } else {
+      // Another producer took this position first
+      pos = tail_.load(std::memory_order_relaxed);
+    }
+  }
+
+  if (sleeping_.load()) {
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    wake_.notify_one();
+  }
+}
+
+void Log::flush() {
+  size_t target = tail_.load(std::memory_order_acquire);
+  while (head_.load(std::memory_order_acquire) < target) {
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    wake_.notify_one();
+    std::this_thread::yield();
+  }
+  std::cout.flush();
+}
+
+void Log::drain() {
+  for (;;) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    Slot &slot = (*slots_)[head % capacity];
+
+    if (slot.sequence.load(std::memory_order_acquire) == head + 1) {
+      Record record = std::move(slot.record);
+      slot.sequence.store(head + capacity, std::memory_order_release);
+
+      if (record.level >= level_.load(std::memory_order_relaxed)) {
+        write_terminal(record);
+      }
+      if (json_enabled_.load(std::memory_order_acquire)) {
+        write_json(record);
+      }
+      head_.store(head + 1, std::memory_order_release);
+      continue;
+    }
+
+    // Caught up: one flush per burst instead of one per line
+    std::cout.flush();
+    if (json_enabled_.load(std::memory_order_acquire)) {
+      json_.flush();
+    }
+    if (stopping_) {
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    sleeping_.store(true);
+    if (slot.sequence.load(std::memory_order_acquire) != head + 1 &&
+        !stopping_) {
+      // The timeout covers a producer that checked before we slept
+      wake_.wait_for(lock, std::chrono::milliseconds(50));
+    }
+    sleeping_.store(false);
+  }
+}
+
+const std::string &
+Log::clock_time(std::chrono::system_clock::time_point time) {
+  auto second =
+      std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch())
+          .count();
+  if (second != cached_second_) {
+    cached_second_ = second;
+    std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+    std::tm tm{};
+    localtime_r(&seconds, &tm);
+    char buffer[16];
+    std::strftime(buffer, sizeof(buffer), "%H:%M:%S", &tm);
+    cached_time_ = buffer;
+  }
+  return cached_time_;
+}
+
+void Log::write_terminal(const Record &record) {
+  switch (record.event) {
+  case Event::Request:
+    std::cout << termcolor::bright_blue << clock_time(record.time)
+              << termcolor::reset << " " << termcolor::bright_cyan
+              << record.detail << termcolor::reset << " " << termcolor::white
+              << std::setw(30) << std::left << record.text << termcolor::reset
+              << " ";
+
+    if (record.status >= 200 && record.status < 300) {
+      std::cout << termcolor::bright_green;
+    } else if (record.status >= 300 && record.status < 400) {
+      std::cout << termcolor::bright_blue;
+    } else if (record.status >= 400 && record.status < 500) {
+      std::cout << termcolor::bright_yellow;
+    } else {
+      std::cout << termcolor::bright_red;
+    }
+
+    std::cout << record.status << termcolor::reset << " "
+              << termcolor::bright_blue << record.bytes << "B"
+              << termcolor::reset << "\n";
+    break;
+
+  case Event::File:
+    std::cout << termcolor::bright_green << "  ✓ " << termcolor::reset
+              << termcolor::white << record.text;
+    if (!record.detail.empty()) {
+      std::cout << termcolor::bright_blue << " (" << record.detail << ")";
+    }
+    std::cout << termcolor::reset << "\n";
+    break;
+
+  case Event::Page:
+    if (record.detail.empty()) {
+      std::cout << termcolor::bright_green << "  ✓ " << termcolor::reset
+                << termcolor::white << record.text << termcolor::reset << "\n";
+    } else {
+      std::cerr << termcolor::bright_red << "  ✗ " << termcolor::reset
+                << termcolor::white << record.text << termcolor::reset
+                << termcolor::bright_blue << ": " << record.detail
+                << termcolor::reset << "\n";
+    }
+    break;
+
+  case Event::WebSocket:
+    if (record.level == LogLevel::Error) {
+      std::cerr << termcolor::bright_red << "✗ WebSocket " << termcolor::reset
+                << termcolor::bright_white << record.text << termcolor::reset
+                << " " << record.detail << "\n";
+    } else if (record.level == LogLevel::Warn) {
+      std::cerr << termcolor::bright_yellow << "⚠ " << termcolor::reset
+                << "WebSocket " << termcolor::bright_white << record.text
+                << termcolor::reset << " " << record.detail << "\n";
+    } else {
+      std::cout << termcolor::bright_blue << clock_time(record.time)
+                << termcolor::reset << " " << termcolor::bright_green
+                << "🔌 WebSocket" << termcolor::reset << " "
+                << termcolor::bright_white << record.text << termcolor::reset
+                << " " << record.detail << "\n";
+    }
+    break;
+
+  case Event::Timing:
+    std::cout << termcolor::bright_blue << clock_time(record.time)
+              << termcolor::reset << " " << termcolor::bright_yellow
+              << "⏱  Edit to paint" << termcolor::reset << " "
+              << termcolor::bright_white << record.text << termcolor::reset
+              << "\n         " << termcolor::bright_blue << record.detail
+              << termcolor::reset << "\n";
+    break;
+  }
+}
+
+void Log::write_json(const Record &record) {
+  static constexpr const char *levels[] = {"debug", "info", "warn", "error"};
+
+  nlohmann::ordered_json line = {
+      {"time", std::chrono::duration_cast<std::chrono::milliseconds>(
+                   record.time.time_since_epoch())
+                   .count()},
+      {"level", levels[static_cast<int>(record.level)]}};
+
+  switch (record.event) {
+  case Event::Request:
+    line["event"] = "request";
+    line["method"] = record.detail;
+    line["path"] = record.text;
+    line["status"] = record.status;
+    line["bytes"] = record.bytes;
+    break;
+  case Event::File:
+    line["event"] = "file";
+    line["path"] = record.text;
+    if (!record.detail.empty()) {
+      line["note"] = record.detail;
+    }
+    break;
+  case Event::Page:
+    line["event"] = "page";
+    line["url"] = record.text;
+    if (!record.detail.empty()) {
+      line["error"] = record.detail;
+    }
+    break;
+  case Event::WebSocket:
+    line["event"] = "websocket";
+    line["client"] = record.text;
+    line["message"] = record.detail;
+    break;
+  case Event::Timing:
+    line["event"] = "timing";
+    line["breakdown"] = record.text;
+    line["recent"] = record.detail;
+    break;
+  }
+
+  // Invalid UTF-8 in a path is replaced rather than aborting the line
+  json_ << line.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace)
+        << "\n";
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+enum class LogLevel { Debug, Info, Warn, Error };
+
+// Per-item console output (requests, processed files, built pages) written
+// from a background thread. Callers only move a record into a bounded
+// lock-free ring; the drain thread formats timestamps (once per second),
+// applies colors and writes to the terminal and, if opened, a JSON-lines
+// file. Output printed straight to std::cout should call flush() first so
+// it lands after the lines queued before it.
+class Log {
+public:
+  static Log &instance() {
+    static Log log;
+    return log;
+  }
+
+  // Terminal lines below `level` are dropped; `--quiet` sets Warn so only
+  // problems and the summaries printed directly remain. The JSON sink
+  // always gets every record.
+  void set_level(LogLevel level) {
+    level_.store(level, std::memory_order_relaxed);
+  }
+
+  // Also writes every record as one JSON object per line to `path`; false
+  // if it can't be opened
+  bool open_json(const std::filesystem::path &path);
+
+  // One answered HTTP request
+  void request(std::string method, std::string path, int status,
+               size_t bytes);
+  // A static file copied or processed into the output
+  void file(std::string path, std::string note);
+  // A page built, or one that failed with `error`
+  void page(std::string url, std::string error = "");
+  // Something a live reload client at `client` did, or that went wrong
+  // with it, as `message` ("is viewing /about")
+  void websocket(LogLevel level, std::string client, std::string message);
+  // An edit-to-paint measurement: the change's stage breakdown and the
+  // running percentiles, each already formatted
+  void timing(std::string breakdown, std::string recent);
+
+  // Blocks until everything queued so far has been written
+  void flush();
+
+  ~Log();
+
+  Log(const Log &) = delete;
+  Log &operator=(const Log &) = delete;
+
+private:
+  enum class Event { Request, File, Page, WebSocket, Timing };
+
+  struct Record {
+    Event event;
+    LogLevel level;
+    std::chrono::system_clock::time_point time;
+    std::string text;
+    std::string detail;
+    int status = 0;
+    size_t bytes = 0;
+  };
+
+  // A slot is free for the producer claiming position `p` when its
+  // sequence is `p`, and holds a record for the consumer when it is `p + 1`
+  // (Vyukov's bounded queue, with one consumer)
+  struct alignas(64) Slot {
+    std::atomic<size_t> sequence;
+    Record record;
+  };
+
+  static constexpr size_t capacity = 4096;
+
+  Log();
+
+  bool wants(LogLevel level) const;
+  void push(Record record);
+  void drain();
+  void write_terminal(const Record &record);
+  void write_json(const Record &record);
+  const std::string &clock_time(std::chrono::system_clock::time_point time);
+
+  std::unique_ptr<std::array<Slot, capacity>> slots_;
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) std::atomic<size_t> head_{0};
+
+  std::atomic<LogLevel> level_{LogLevel::Info};
+  std::atomic<bool> json_enabled_{false};
+  std::ofstream json_;
+
+  // The drain thread sleeps when the ring is empty; producers only take
+  // the mutex to wake it if it says it is sleeping
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+  std::atomic<bool> sleeping_{false};
+  std::atomic<bool> stopping_{false};
+
+  // Only touched by the drain thread
+  std::chrono::system_clock::time_point::rep cached_second_ = -1;
+  std::string cached_time_;
+
+  std::thread thread_;
+};
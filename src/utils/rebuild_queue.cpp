@@ -0,0 +1,132 @@
+#include "rebuild_queue.hpp"
+#include <algorithm>
+#include <fnmatch.h>
+
+namespace fs = std::filesystem;
+
+void ChangeSet::merge(const FileChange &change) {
+  first_seen_ = std::min(first_seen_, change.seen);
+
+  std::string key = change.path.string();
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    index_[key] = changes_.size();
+    changes_.push_back(change);
+    return;
+  }
+
+  FileChange &existing = changes_[it->second];
+
+  if (existing.kind == ChangeKind::Added) {
+    if (change.kind == ChangeKind::Removed) {
+      // Created and deleted within the window: nothing happened
+      size_t slot = it->second;
+      index_.erase(it);
+      changes_.erase(changes_.begin() + slot);
+      for (auto &[path, position] : index_) {
+        if (position > slot) {
+          --position;
+        }
+      }
+    }
+    return;
+  }
+
+  if (existing.kind == ChangeKind::Removed &&
+      change.kind == ChangeKind::Added) {
+    existing.kind = ChangeKind::Modified;
+    return;
+  }
+
+  if (change.kind != ChangeKind::Added) {
+    existing.kind = change.kind;
+  }
+}
+
+bool IgnoreRules::matches(const fs::path &relative) const {
+  std::string whole = relative.generic_string();
+
+  for (const auto &pattern : patterns_) {
+    if (pattern.find('/') != std::string::npos) {
+      if (fnmatch(pattern.c_str(), whole.c_str(), FNM_PATHNAME) == 0) {
+        return true;
+      }
+      continue;
+    }
+
+    for (const auto &component : relative) {
+      if (fnmatch(pattern.c_str(), component.c_str(), 0) == 0) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+RebuildQueue::RebuildQueue(std::chrono::milliseconds debounce, Handler handler)
+    : debounce_(debounce), max_delay_(debounce * 20),
+      handler_(std::move(handler)) {
+  worker_ = std::thread([this]() { run(); });
+}
+
+RebuildQueue::~RebuildQueue() { stop(); }
+
+void RebuildQueue::push(const FileChange &change) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+    if (pending_.empty()) {
+      first_event_ = now;
+    }
+    last_event_ = now;
+    pending_.merge(change);
+  }
+  cv_.notify_one();
+}
+
+void RebuildQueue::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+      return;
+    }
+    stopping_ = true;
+  }
+  cv_.notify_one();
+
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+void RebuildQueue::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (true) {
+    cv_.wait(lock, [this]() { return stopping_ || !pending_.empty(); });
+    if (stopping_) {
+      return;
+    }
+
+    // Wait for the burst to settle
+    while (!stopping_) {
+      auto deadline =
+          std::min(last_event_ + debounce_, first_event_ + max_delay_);
+      if (std::chrono::steady_clock::now() >= deadline) {
+        break;
+      }
+      cv_.wait_until(lock, deadline);
+    }
+    if (stopping_) {
+      return;
+    }
+
+    ChangeSet batch = std::move(pending_);
+    pending_ = ChangeSet();
+
+    lock.unlock();
+    handler_(batch);
+    lock.lock();
+  }
+}
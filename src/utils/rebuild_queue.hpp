@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+enum class ChangeKind { Added, Modified, Removed };
+
+struct FileChange {
+  std::filesystem::path path;
+  ChangeKind kind;
+  // When the watcher reported it
+  std::chrono::steady_clock::time_point seen =
+      std::chrono::steady_clock::now();
+};
+
+// The net effect of a burst of file events, one entry per path in the order
+// each path was first touched.
+class ChangeSet {
+public:
+  // Folds `change` into the set: add then modify is still an add, add then
+  // remove cancels out, remove then add is a modify.
+  void merge(const FileChange &change);
+
+  const std::vector<FileChange> &changes() const { return changes_; }
+  bool empty() const { return changes_.empty(); }
+  size_t size() const { return changes_.size(); }
+
+  // When the earliest event folded into the set was seen, even if that
+  // change later cancelled out
+  std::chrono::steady_clock::time_point first_seen() const {
+    return first_seen_;
+  }
+
+private:
+  std::vector<FileChange> changes_;
+  std::unordered_map<std::string, size_t> index_;
+  std::chrono::steady_clock::time_point first_seen_ =
+      std::chrono::steady_clock::time_point::max();
+};
+
+// Glob patterns for paths the watcher should never react to. A pattern
+// without a '/' is tested against every component of the path, so
+// "node_modules" or "*.swp" match at any depth; a pattern with a '/' is
+// tested against the whole project-relative path.
+class IgnoreRules {
+public:
+  explicit IgnoreRules(std::vector<std::string> patterns)
+      : patterns_(std::move(patterns)) {}
+
+  bool matches(const std::filesystem::path &relative) const;
+
+private:
+  std::vector<std::string> patterns_;
+};
+
+// Collects file events from the watcher thread and hands them to `handler`
+// on a worker thread once no new event has arrived for `debounce`. Events
+// that arrive while a rebuild is running are batched into the next one, so
+// a checkout touching hundreds of files costs one or two rebuilds. A steady
+// stream of events is still flushed every `max_delay`.
+class RebuildQueue {
+public:
+  using Handler = std::function<void(const ChangeSet &)>;
+
+  RebuildQueue(std::chrono::milliseconds debounce, Handler handler);
+  ~RebuildQueue();
+
+  RebuildQueue(const RebuildQueue &) = delete;
+  RebuildQueue &operator=(const RebuildQueue &) = delete;
+
+  void push(const FileChange &change);
+  void stop();
+
+private:
+  void run();
+
+  std::chrono::milliseconds debounce_;
+  std::chrono::milliseconds max_delay_;
+  Handler handler_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  ChangeSet pending_;
+  std::chrono::steady_clock::time_point first_event_;
+  std::chrono::steady_clock::time_point last_event_;
+  bool stopping_ = false;
+
+  std::thread worker_;
+};
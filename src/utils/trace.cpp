@@ -0,0 +1,87 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <fstream>
+#include <vendor/nlohmann/json.hpp>
+
+void Trace::start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.clear();
+  epoch_ = Clock::now();
+  // The thread that starts the trace is shown as the main one
+  thread_id();
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+int Trace::thread_id() {
+  // Small sequential ids read better in the viewer than native ones
+  static std::atomic<int> next{1};
+  thread_local int id = next++;
+  return id;
+}
+
+void Trace::record(const char *name, Clock::time_point begin,
+                   Clock::time_point end, std::string detail) {
+  int thread = thread_id();
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.push_back({name, begin, end, thread, std::move(detail)});
+}
+
+size_t Trace::event_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return events_.size();
+}
+
+bool Trace::write(const std::filesystem::path &path) {
+  enabled_.store(false, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto micros = [this](Clock::time_point time) {
+    return std::chrono::duration<double, std::micro>(time - epoch_).count();
+  };
+
+  nlohmann::json events = nlohmann::json::array();
+  std::vector<int> threads;
+  for (const auto &event : events_) {
+    // "X" is a complete event: a start time and a duration
+    nlohmann::json entry = {{"name", event.name},
+                            {"cat", "build"},
+                            {"ph", "X"},
+                            {"ts", micros(event.begin)},
+                            {"dur", micros(event.end) - micros(event.begin)},
+                            {"pid", 1},
+                            {"tid", event.thread}};
+    if (!event.detail.empty()) {
+      entry["args"] = {{"detail", event.detail}};
+    }
+    events.push_back(std::move(entry));
+
+    if (std::find(threads.begin(), threads.end(), event.thread) ==
+        threads.end()) {
+      threads.push_back(event.thread);
+    }
+  }
+
+  for (int thread : threads) {
+    events.push_back(
+        {{"name", "thread_name"},
+         {"ph", "M"},
+         {"pid", 1},
+         {"tid", thread},
+         {"args",
+          {{"name", thread == 1 ? std::string("main")
+                                : "worker " + std::to_string(thread - 1)}}}});
+  }
+  events.push_back({{"name", "process_name"},
+                    {"ph", "M"},
+                    {"pid", 1},
+                    {"args", {{"name", "forge build"}}}});
+
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    return false;
+  }
+  file << nlohmann::json{{"traceEvents", std::move(events)},
+                         {"displayTimeUnit", "ms"}}
+              .dump();
+  return static_cast<bool>(file);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timed spans of a build, written as Chrome trace-event JSON for Perfetto or
+// chrome://tracing. Each thread gets its own track. Recording is off unless
+// start() was called; a disabled span costs one relaxed load and a branch.
+class Trace {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static Trace &instance() {
+    static Trace trace;
+    return trace;
+  }
+
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  void start();
+
+  // Stops recording and writes what was recorded; false if `path` can't be
+  // written
+  bool write(const std::filesystem::path &path);
+
+  void record(const char *name, Clock::time_point begin, Clock::time_point end,
+              std::string detail);
+
+  size_t event_count() const;
+
+private:
+  Trace() = default;
+
+  struct Event {
+    const char *name;
+    Clock::time_point begin;
+    Clock::time_point end;
+    int thread;
+    std::string detail;
+  };
+
+  static int thread_id();
+
+  static inline std::atomic<bool> enabled_{false};
+
+  Clock::time_point epoch_;
+  std::vector<Event> events_;
+  mutable std::mutex mutex_;
+};
+
+// Records the enclosing scope as one span. `name` must be a string literal
+// (or otherwise outlive the trace); `detail` is shown with the span, e.g.
+// the page or file it worked on.
+class TraceScope {
+public:
+  explicit TraceScope(const char *name)
+      : name_(Trace::enabled() ? name : nullptr) {
+    if (name_) {
+      begin_ = Trace::Clock::now();
+    }
+  }
+
+  TraceScope(const char *name, const std::string &detail) : TraceScope(name) {
+    if (name_) {
+      detail_ = detail;
+    }
+  }
+
+  TraceScope(const char *name, const std::filesystem::path &detail)
+      : TraceScope(name) {
+    if (name_) {
+      detail_ = detail.string();
+    }
+  }
+
+  ~TraceScope() {
+    if (name_) {
+      Trace::instance().record(name_, begin_, Trace::Clock::now(),
+                               std::move(detail_));
+    }
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+  const char *name_;
+  Trace::Clock::time_point begin_;
+  std::string detail_;
+};
+
+#define FORGE_TRACE_CONCAT_(a, b) a##b
+#define FORGE_TRACE_CONCAT(a, b) FORGE_TRACE_CONCAT_(a, b)
+// FORGE_TRACE_SCOPE("render_page") or FORGE_TRACE_SCOPE("write_file", path)
+#define FORGE_TRACE_SCOPE(...)                                                 \
+  TraceScope FORGE_TRACE_CONCAT(forge_trace_scope_, __LINE__)(__VA_ARGS__)